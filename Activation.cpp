@@ -1,104 +1,186 @@
-/**
-* @file   Activation.cpp
-* @brief a program that implements Activation.h. represents and creates an activation object,
- *       that has functions to perform on matrices
-* @section DESCRIPTION a program that implements Activation.h.
-*/
-
-// -------------------------------------- includes ------------------------------------------------
-
-#include "Activation.h"
-#include "MlpNetwork.h"
-#include <math.h>
-#define WRONG_SIZE_ERR "Error: Wrong matrix size for softmax"
-
-// ------------------------------------------- function declaration -------------------------------
-
-/**
- * @brief constructor for activation object
- * @param actType - activation type
- */
-Activation::Activation(ActivationType actType):_actType(actType)
-{
-}
-
-/**
- * @brief returns the activation type
- * @return activation type
- */
-ActivationType& Activation::getActivationType()
-{
-    return _actType;
-}
-
-/**
- * @brief performs relu function on a matrix
- * @param mat - the matrix
- * @return - the matrix after relu function
- */
-Matrix& Activation::reluFunction(Matrix& mat)
-{
-    // Goes over the array of float and changes it if needed
-    for (int i = 0; i < mat.getCols() * mat.getRows(); i++)
-    {
-        // Checks if the value in the current cell is smaller then zero
-        if (mat[i] < 0)
-        {
-            mat[i] = 0;
-        }
-    }
-    return mat;
-}
-
-/**
- * @brief performs softmax function on a matrix
- * @param mat - the matrix
- * @return - the matrix after softmax function
- */
-Matrix& Activation::softMaxFunction(Matrix& mat)
-{
-    if ((mat.getRows() != biasDims[MLP_SIZE - 1].rows) ||
-        (mat.getCols() != biasDims[MLP_SIZE - 1].cols))
-    {
-        std::cerr << WRONG_SIZE_ERR << std::endl;
-    }
-
-    Matrix e(mat.getRows(), mat.getCols()); // should be 10 * 1
-    int sizeOfE = e.getRows() * e.getCols();
-
-    for (int i = 0; i < sizeOfE; i++)
-    {
-        e[i] = std::exp(mat[i]); // e[i] = e^zi
-    }
-    float sum = 0;
-    for (int i = 0; i < sizeOfE; i++)
-    {
-        sum += e[i];
-    }
-
-    float division = 1 / sum;
-
-    mat = division * e;
-    return mat;
-}
-
-/**
- * @brief performs a function on the input matrix, according to the dense's activation type
- *        does not change the input matrix
- * @param input - the matrix to perform the function on
- * @return - a matrix after the function
- */
-Matrix Activation::operator()(Matrix& input)
-{
-    Matrix result = input;
-
-    if (getActivationType() == Relu)
-    {
-       result = reluFunction(result);
-    }
-    else if (getActivationType() == Softmax)
-    {
-        result = softMaxFunction(result);
-    }
-    return result;
+/**
+* @file   Activation.cpp
+* @brief a program that implements Activation.h. represents and creates an activation object,
+ *       that has functions to perform on matrices
+* @section DESCRIPTION a program that implements Activation.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+
+#include "Activation.h"
+#include "Profiler.h"
+#include "SimdKernels.h"
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief constructor for activation object
+ * @param actType - activation type
+ */
+Activation::Activation(ActivationType actType):_actType(actType), _fastExp(false)
+{
+}
+
+/**
+ * @brief returns the activation type
+ * @return activation type
+ */
+ActivationType& Activation::getActivationType()
+{
+    return _actType;
+}
+
+/**
+ * @brief returns the activation type
+ * @return activation type (const)
+ */
+const ActivationType& Activation::getActivationType() const
+{
+    return _actType;
+}
+
+/**
+ * @brief switches softmax to the fast exp (see simdExpFast), whose relative error is below
+ *        FAST_EXP_MAX_ERROR, or back to std::exp. relu does not use exp
+ * @param fastExp - true for the fast exp
+ */
+void Activation::setFastExp(bool fastExp)
+{
+    _fastExp = fastExp;
+}
+
+/**
+ * @brief returns true if softmax uses the fast exp
+ * @return true if softmax uses the fast exp
+ */
+bool Activation::isFastExp() const
+{
+    return _fastExp;
+}
+
+/**
+ * @brief performs relu function on an array of floats, in place
+ * @param values - the array
+ * @param size - the number of floats
+ */
+void Activation::_relu(float* values, int size)
+{
+    // Goes over the array of float and changes it if needed
+    for (int i = 0; i < size; i++)
+    {
+        // Checks if the value in the current cell is smaller then zero
+        if (values[i] < 0)
+        {
+            values[i] = 0;
+        }
+    }
+}
+
+/**
+ * @brief performs relu function on a matrix
+ * @param mat - the matrix
+ * @return - the matrix after relu function
+ */
+Matrix& Activation::reluFunction(Matrix& mat) const
+{
+    if (mat.isPacked())
+    {
+        _relu(mat.data(), mat.getRows() * mat.getCols());
+        return mat;
+    }
+
+    // Goes over the rows, the padding between them is left as it is
+    for (int i = 0; i < mat.getRows(); i++)
+    {
+        _relu(mat.row(i), mat.getCols());
+    }
+    return mat;
+}
+
+/**
+ * @brief performs softmax function on a matrix, each column separately, in place. the max
+ *        of a column is subtracted before exp and the columns are done in vector lanes
+ * @param mat - the matrix, one column per image
+ * @return - the matrix after softmax function
+ */
+Matrix& Activation::softMaxFunction(Matrix& mat) const
+{
+    simdSoftmax(mat.data(), mat.getRows(), mat.getCols(), mat.getStride(), _fastExp);
+    return mat;
+}
+
+/**
+ * @brief performs the function of the activation type on a matrix, in place
+ * @param mat - the matrix
+ * @return - the matrix after the function
+ */
+Matrix& Activation::apply(Matrix& mat) const
+{
+    PROFILE_SCOPE(ProfileActivation);
+    if (_actType == Relu)
+    {
+        return reluFunction(mat);
+    }
+    return softMaxFunction(mat);
+}
+
+/**
+ * @brief performs the function of the activation type on a row-major array of floats, in place
+ * @param values - the array
+ * @param rows - the number of rows
+ * @param cols - the number of cols, one per image
+ */
+void Activation::apply(float* values, int rows, int cols) const
+{
+    PROFILE_SCOPE(ProfileActivation);
+    if (_actType == Relu)
+    {
+        _relu(values, rows * cols);
+    }
+    else
+    {
+        simdSoftmax(values, rows, cols, _fastExp);
+    }
+}
+
+/**
+ * @brief performs the function of the activation type on a view of any stride, in place
+ * @param values - the view, one column per image
+ */
+void Activation::apply(MatrixView values) const
+{
+    if (values.isContiguous())
+    {
+        apply(values.data(), values.getRows(), values.getCols());
+        return;
+    }
+
+    PROFILE_SCOPE(ProfileActivation);
+    if (_actType == Relu)
+    {
+        // Goes over the rows, there are gaps between them
+        for (int i = 0; i < values.getRows(); i++)
+        {
+            _relu(values.row(i), values.getCols());
+        }
+    }
+    else
+    {
+        simdSoftmax(values.data(), values.getRows(), values.getCols(), values.getStride(),
+                    _fastExp);
+    }
+}
+
+/**
+ * @brief performs a function on the input matrix, according to the dense's activation type
+ *        does not change the input matrix
+ * @param input - the matrix to perform the function on
+ * @return - a matrix after the function
+ */
+Matrix Activation::operator()(Matrix& input)
+{
+    Matrix result = input;
+
+    apply(result);
+    return result;
 }
\ No newline at end of file
@@ -1,62 +1,106 @@
-
-//Activation.h
-#ifndef ACTIVATION_H
-#define ACTIVATION_H
-
-#include "Matrix.h"
-
-/**
- * @enum ActivationType
- * @brief Indicator of activation function.
- */
-enum ActivationType
-{
-    Relu,
-    Softmax
-};
-
-/**
- * @brief class that represents an activation
- */
-class Activation
-{
-public:
-
-    /**
-     * @brief constructor for activation object
-     * @param actType - activation type
-     */
-    explicit Activation(ActivationType actType);
-
-    /**
-     * @brief returns the activation typew
-     * @return activation type
-     */
-    ActivationType& getActivationType();
-
-    /**
-     * @brief performs relu function on a matrix
-     * @param mat - the matrix
-     * @return - the matrix after relu function
-     */
-    Matrix& reluFunction(Matrix& mat);
-
-    /**
-     * @brief performs softmax function on a matrix
-     * @param mat - the matrix
-     * @return - the matrix after softmax function
-     */
-    Matrix& softMaxFunction(Matrix& mat);
-
-    /**
-     * @brief performs a function on the input matrix, according to the dense's activation type
-     *        does not change the input matrix
-     * @param input - the matrix to perform the function on
-     * @return - a matrix after the function
-     */
-    Matrix operator()(Matrix& input);
-private:
-    ActivationType _actType;
-};
-
-#endif //ACTIVATION_H
+
+//Activation.h
+#ifndef ACTIVATION_H
+#define ACTIVATION_H
+
+#include "Matrix.h"
+
+/**
+ * @enum ActivationType
+ * @brief Indicator of activation function.
+ */
+enum ActivationType
+{
+    Relu,
+    Softmax
+};
+
+/**
+ * @brief class that represents an activation
+ */
+class Activation
+{
+public:
+
+    /**
+     * @brief constructor for activation object
+     * @param actType - activation type
+     */
+    explicit Activation(ActivationType actType);
+
+    /**
+     * @brief returns the activation typew
+     * @return activation type
+     */
+    ActivationType& getActivationType();
+
+    /**
+     * @brief returns the activation type
+     * @return activation type (const)
+     */
+    const ActivationType& getActivationType() const;
+
+    /**
+     * @brief switches softmax to the fast exp (see simdExpFast), whose relative error is below
+     *        FAST_EXP_MAX_ERROR, or back to std::exp. relu does not use exp
+     * @param fastExp - true for the fast exp
+     */
+    void setFastExp(bool fastExp);
+
+    /**
+     * @brief returns true if softmax uses the fast exp
+     * @return true if softmax uses the fast exp
+     */
+    bool isFastExp() const;
+
+    /**
+     * @brief performs relu function on a matrix
+     * @param mat - the matrix
+     * @return - the matrix after relu function
+     */
+    Matrix& reluFunction(Matrix& mat) const;
+
+    /**
+     * @brief performs softmax function on a matrix, each column separately, in place. the max
+     *        of a column is subtracted before exp and the columns are done in vector lanes
+     * @param mat - the matrix, one column per image
+     * @return - the matrix after softmax function
+     */
+    Matrix& softMaxFunction(Matrix& mat) const;
+
+    /**
+     * @brief performs the function of the activation type on a matrix, in place
+     * @param mat - the matrix
+     * @return - the matrix after the function
+     */
+    Matrix& apply(Matrix& mat) const;
+
+    /**
+     * @brief performs the function of the activation type on a row-major array of floats,
+     *        in place
+     * @param values - the array
+     * @param rows - the number of rows
+     * @param cols - the number of cols, one per image
+     */
+    void apply(float* values, int rows, int cols) const;
+
+    /**
+     * @brief performs the function of the activation type on a view of any stride, in place
+     * @param values - the view, one column per image
+     */
+    void apply(MatrixView values) const;
+
+    /**
+     * @brief performs a function on the input matrix, according to the dense's activation type
+     *        does not change the input matrix
+     * @param input - the matrix to perform the function on
+     * @return - a matrix after the function
+     */
+    Matrix operator()(Matrix& input);
+private:
+    static void _relu(float* values, int size);
+    ActivationType _actType;
+    bool _fastExp;       // true if softmax uses the fast exp
+};
+
+#endif //ACTIVATION_H
@@ -0,0 +1,266 @@
+/**
+* @file   AllocationCheck.cpp
+* @brief a program that checks that a warm inference does not allocate: it replaces the global
+ *       operator new and aligned_alloc with versions that count, runs every path of the network
+ *       once to warm it, and fails if running it again allocates anything.
+* @section DESCRIPTION usage: allocheck [iterations]
+ *          the network has the default sizes and random weights. the paths are the single image
+ *          (packed and padded), the batch in every output mode, the fp16, bf16 and int8 weights
+ *          and the fast exp, all on the calling thread (the tasks of the thread pool are
+ *          allocated by its queues).
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "MlpNetwork.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+#define ARGS_COUNT_MAX 2
+#define ITERATIONS_ARG 1
+#define DEFAULT_ITERATIONS 100
+#define BATCH_SIZE 32
+#define TOP_K 3
+#define RANDOM_SEED 12345u
+#define USAGE_MSG "Usage: allocheck [iterations]"
+#define STR_ALLOCATIONS_ERR "Error: a warm inference allocated"
+
+static std::atomic<long> allocations(0); // the allocations since the program started
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief allocates a block and counts it, the base of all the replaced allocation functions
+ * @param size - the number of bytes
+ * @param alignment - the alignment, a power of two
+ * @return the block, nullptr on failure
+ */
+static void* countedAllocate(size_t size, size_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size = (size == 0) ? 1 : size;
+    if (alignment <= alignof(std::max_align_t))
+    {
+        return std::malloc(size);
+    }
+    void* block = nullptr;
+    return (posix_memalign(&block, alignment, size) == 0) ? block : nullptr;
+}
+
+/**
+ * @brief the allocation function that throws, every new expression ends in one
+ * @param size - the number of bytes
+ * @param alignment - the alignment
+ * @return the block
+ */
+static void* countedNew(size_t size, size_t alignment)
+{
+    void* block = countedAllocate(size, alignment);
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void* operator new(size_t size)
+{
+    return countedNew(size, alignof(std::max_align_t));
+}
+
+void* operator new[](size_t size)
+{
+    return countedNew(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return countedNew(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return countedNew(size, (size_t)alignment);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size, alignof(std::max_align_t));
+}
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, size_t) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, std::align_val_t) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void* block, std::align_val_t) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, size_t, std::align_val_t) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void* block, size_t, std::align_val_t) noexcept
+{
+    std::free(block);
+}
+
+/**
+ * @brief the aligned allocation of the matrices, the slab and the workspace, replaced for the
+ *        whole program so their allocations are counted too
+ * @param alignment - the alignment, a power of two
+ * @param size - the number of bytes
+ * @return the block, nullptr on failure
+ */
+extern "C" void* aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    return countedAllocate(size, alignment);
+}
+
+/**
+ * @brief fills a matrix with deterministic pseudo random values in [-scale, scale)
+ * @param mat - the matrix
+ * @param scale - the largest absolute value
+ * @param seed - the state of the generator, advanced
+ */
+static void fillRandom(Matrix& mat, float scale, unsigned int& seed)
+{
+    for (float& cell : mat)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        cell = scale * (((float)(seed >> 8) / (float)(1u << 24)) * 2 - 1);
+    }
+}
+
+/**
+ * @brief runs a path of the network once to warm it, then counts the allocations of running it
+ *        iterations more times and prints them
+ * @param name - the name of the path
+ * @param iterations - the number of counted runs
+ * @param path - the path, one inference
+ * @return true if the counted runs did not allocate
+ */
+static bool checkPath(const char* name, int iterations, const std::function<void()>& path)
+{
+    path();
+    long before = allocations.load();
+    for (int i = 0; i < iterations; i++)
+    {
+        path();
+    }
+    long counted = allocations.load() - before;
+    std::printf("%-24s %8ld allocations in %d runs\n", name, counted, iterations);
+    return counted == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > ARGS_COUNT_MAX)
+    {
+        std::cerr << USAGE_MSG << std::endl;
+        return EXIT_FAILURE;
+    }
+    int iterations = (argc > ITERATIONS_ARG) ? std::atoi(argv[ITERATIONS_ARG]) :
+                     DEFAULT_ITERATIONS;
+    if (iterations <= 0)
+    {
+        std::cerr << USAGE_MSG << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    unsigned int seed = RANDOM_SEED;
+    Matrix weights[MLP_SIZE];
+    Matrix biases[MLP_SIZE];
+    for (int i = 0; i < MLP_SIZE; i++)
+    {
+        weights[i] = Matrix(weightsDims[i].rows, weightsDims[i].cols);
+        biases[i] = Matrix(biasDims[i].rows, biasDims[i].cols);
+        fillRandom(weights[i], 0.1f, seed);
+        fillRandom(biases[i], 0.1f, seed);
+    }
+    Matrix image(imgDims.rows, imgDims.cols);
+    Matrix batch(imgDims.rows * imgDims.cols, BATCH_SIZE);
+    fillRandom(image, 1, seed);
+    fillRandom(batch, 1, seed);
+    Matrix paddedImage(imgDims.rows, imgDims.cols, LayoutPadded);
+    for (int i = 0; i < imgDims.rows; i++)
+    {
+        for (int j = 0; j < imgDims.cols; j++)
+        {
+            paddedImage(i, j) = image(i, j);
+        }
+    }
+
+    MlpNetwork network(weights, biases);
+    Classification result;
+    Digit digit;
+    bool passed = true;
+
+    // Goes over the paths, every mode of the network is switched on before its path is warmed
+    passed &= checkPath("image", iterations, [&]() { digit = network(image); });
+    passed &= checkPath("image/padded", iterations, [&]() { digit = network(paddedImage); });
+    passed &= checkPath("batch/argmax", iterations, [&]()
+    {
+        network.classify(batch, OutputArgmax, 1, result);
+    });
+    passed &= checkPath("batch/topk", iterations, [&]()
+    {
+        network.classify(batch, OutputTopK, TOP_K, result);
+    });
+    passed &= checkPath("batch/distribution", iterations, [&]()
+    {
+        network.classify(batch, OutputDistribution, TOP_K, result);
+    });
+    network.setFastExp(true);
+    passed &= checkPath("image/fast_exp", iterations, [&]() { digit = network(image); });
+    network.setFastExp(false);
+    network.setWeightPrecision(PrecisionHalf);
+    passed &= checkPath("image/fp16", iterations, [&]() { digit = network(image); });
+    network.setWeightPrecision(PrecisionBfloat16);
+    passed &= checkPath("image/bf16", iterations, [&]() { digit = network(image); });
+    network.setWeightPrecision(PrecisionFloat);
+    network.setQuantized(true);
+    passed &= checkPath("image/int8", iterations, [&]() { digit = network(image); });
+    passed &= checkPath("batch/int8", iterations, [&]()
+    {
+        network.classify(batch, OutputTopK, TOP_K, result);
+    });
+
+    if (!passed)
+    {
+        std::cerr << STR_ALLOCATIONS_ERR << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,559 @@
+/**
+* @file   Benchmark.cpp
+* @brief a program that runs the micro benchmarks of the network on random weights: the matrix
+ *       product and addition at every layer shape, the accessors, the activations, a single
+ *       dense, the latency of one image (dynamic, static and int8) and the throughput of
+ *       batches.
+* @section DESCRIPTION usage: bench [--filter=text] [--min_time=seconds] [--repetitions=n]
+ *                                  [--json=file]
+ *          every benchmark is calibrated to run for min_time, then timed repetitions times.
+ *          the table goes to the standard output, and with --json the results also go into a
+ *          json file, to compare builds and releases.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "MlpNetwork.h"
+#include "SimdKernels.h"
+#include "StaticMlpNetwork.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#ifndef BUILD_CONFIG
+#define BUILD_CONFIG "unknown" // set by the Makefile to the name of the build configuration
+#endif
+
+#ifdef MLP_BOUNDS_CHECK
+#define BOUNDS_CHECKS "on"
+#else
+#define BOUNDS_CHECKS "off"
+#endif
+
+#define DEFAULT_MIN_TIME 0.1
+#define DEFAULT_REPETITIONS 5
+#define MAX_ITERATIONS (1L << 30)
+#define CALIBRATION_MARGIN 1.2 // aims a bit above min_time, so the runs do not fall short
+#define NANOS_PER_SECOND 1e9
+#define RANDOM_SEED 12345u
+#define SOFTMAX_BATCH 64 // the images of the batched softmax
+#define TOP_K 3          // the classes of the top-k benchmark
+#define FILTER_FLAG "--filter="
+#define MIN_TIME_FLAG "--min_time="
+#define REPETITIONS_FLAG "--repetitions="
+#define JSON_FLAG "--json="
+#define USAGE_MSG "Usage: bench [--filter=text] [--min_time=seconds] [--repetitions=n] " \
+                  "[--json=file]"
+#define STR_BENCH_ARGS_ERR "Error: min_time and repetitions must be positive"
+#define STR_WRITE_JSON_ERR "Error: cannot write file "
+#define STR_DIFFERENT_RESULTS_ERR "Error: the static and dynamic networks disagree"
+
+const int batchSizes[] = {1, 8, 32, 256};
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @struct BenchOptions
+ * @brief the options of a run, from the command line
+ */
+typedef struct BenchOptions
+{
+    std::string filter;                   // runs only the benchmarks whose name contains it
+    double minTime = DEFAULT_MIN_TIME;    // the time of one repetition, in seconds
+    int repetitions = DEFAULT_REPETITIONS;
+    std::string jsonPath;                 // the json file to write, empty for none
+} BenchOptions;
+
+/**
+ * @struct Benchmark
+ * @brief a benchmark: its body is one operation, that handles items items (images)
+ */
+typedef struct Benchmark
+{
+    std::string name;
+    int items;
+    std::function<void()> body;
+} Benchmark;
+
+/**
+ * @struct BenchResult
+ * @brief the time of one operation of a benchmark over its repetitions, in nanoseconds
+ */
+typedef struct BenchResult
+{
+    std::string name;
+    int items = 0;
+    long iterations = 0;  // the operations in every repetition
+    double median = 0;
+    double mean = 0;
+    double stddev = 0;
+    double min = 0;
+} BenchResult;
+
+/**
+ * @brief keeps the compiler from removing the computation of a value it sees is not used
+ *        (the optimized builds would otherwise drop whole benchmarks)
+ * @param value - the value
+ */
+template <typename T>
+static void keepValue(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+ * @brief fills a matrix with deterministic pseudo random values in [-scale, scale)
+ * @param mat - the matrix
+ * @param scale - the largest absolute value
+ * @param seed - the state of the generator, advanced
+ */
+static void fillRandom(Matrix& mat, float scale, unsigned int& seed)
+{
+    for (float& cell : mat)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        cell = scale * (((float)(seed >> 8) / (float)(1u << 24)) * 2 - 1);
+    }
+}
+
+/**
+ * @brief counts the positive cells of a matrix through the accessor that is checked in every
+ *        build
+ * @param mat - the matrix
+ * @return the number of positive cells
+ */
+static int countPositiveChecked(const Matrix& mat)
+{
+    int count = 0;
+    for (int i = 0; i < mat.getRows(); i++)
+    {
+        for (int j = 0; j < mat.getCols(); j++)
+        {
+            count += (mat.at(i, j) > 0);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief counts the positive cells of a matrix through operator(), which is checked only in the
+ *        builds with MLP_BOUNDS_CHECK. in a release build it runs as fast as the row pointers
+ * @param mat - the matrix
+ * @return the number of positive cells
+ */
+static int countPositive(const Matrix& mat)
+{
+    int count = 0;
+    for (int i = 0; i < mat.getRows(); i++)
+    {
+        for (int j = 0; j < mat.getCols(); j++)
+        {
+            count += (mat(i, j) > 0);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief counts the positive cells of a matrix through its row pointers
+ * @param mat - the matrix
+ * @return the number of positive cells
+ */
+static int countPositiveRows(const Matrix& mat)
+{
+    int count = 0;
+    for (int i = 0; i < mat.getRows(); i++)
+    {
+        const float* row = mat.row(i);
+        for (int j = 0; j < mat.getCols(); j++)
+        {
+            count += (row[j] > 0);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief returns a random matrix
+ * @param rows - the number of rows
+ * @param cols - the number of cols
+ * @param scale - the largest absolute value
+ * @param seed - the state of the generator, advanced
+ * @return the matrix
+ */
+static Matrix randomMatrix(int rows, int cols, float scale, unsigned int& seed)
+{
+    Matrix mat(rows, cols);
+    fillRandom(mat, scale, seed);
+    return mat;
+}
+
+/**
+ * @brief returns a copy of a matrix in the padded layout, every row starting on a cache line
+ * @param mat - the matrix
+ * @return the padded copy
+ */
+static Matrix paddedCopy(const Matrix& mat)
+{
+    Matrix padded(mat.getRows(), mat.getCols(), LayoutPadded);
+    for (int i = 0; i < mat.getRows(); i++)
+    {
+        simdCopy(mat.row(i), padded.row(i), mat.getCols());
+    }
+    return padded;
+}
+
+/**
+ * @brief runs the body of a benchmark a number of times
+ * @param body - the body
+ * @param iterations - the number of times
+ * @return the time it took, in seconds
+ */
+static double timeIterations(const std::function<void()>& body, long iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++)
+    {
+        body();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief runs a benchmark: finds the number of iterations that takes min_time (the first
+ *        runs also warm the caches and the buffers), then times it repetitions times
+ * @param benchmark - the benchmark
+ * @param options - the options of the run
+ * @return the result
+ */
+static BenchResult runBenchmark(const Benchmark& benchmark, const BenchOptions& options)
+{
+    long iterations = 1;
+    double seconds = timeIterations(benchmark.body, iterations);
+    while ((seconds < options.minTime) && (iterations < MAX_ITERATIONS))
+    {
+        // grows at most tenfold at a time, a run that was too short to time says little
+        double scale = (seconds > 0) ? (options.minTime * CALIBRATION_MARGIN / seconds) : 10;
+        long next = (long)(iterations * std::min(scale, 10.0));
+        iterations = std::min(MAX_ITERATIONS, std::max(iterations + 1, next));
+        seconds = timeIterations(benchmark.body, iterations);
+    }
+
+    std::vector<double> times(options.repetitions);
+    for (double& time : times)
+    {
+        time = timeIterations(benchmark.body, iterations) * NANOS_PER_SECOND / iterations;
+    }
+    std::sort(times.begin(), times.end());
+
+    BenchResult result;
+    result.name = benchmark.name;
+    result.items = benchmark.items;
+    result.iterations = iterations;
+    result.min = times.front();
+    result.median = (times[(times.size() - 1) / 2] + times[times.size() / 2]) / 2;
+    for (double time : times)
+    {
+        result.mean += time / times.size();
+    }
+    for (double time : times)
+    {
+        result.stddev += (time - result.mean) * (time - result.mean) / times.size();
+    }
+    result.stddev = std::sqrt(result.stddev);
+    return result;
+}
+
+/**
+ * @brief returns the items a benchmark handles in a second, at its median time
+ * @param result - the result of the benchmark
+ * @return the items per second
+ */
+static double itemsPerSecond(const BenchResult& result)
+{
+    return result.items * NANOS_PER_SECOND / result.median;
+}
+
+/**
+ * @brief writes the results into a json file, with the build and the host they come from
+ * @param path - the path of the file
+ * @param results - the results
+ * @param options - the options of the run
+ */
+static void writeJson(const std::string& path, const std::vector<BenchResult>& results,
+                      const BenchOptions& options)
+{
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        std::cerr << STR_WRITE_JSON_ERR << path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+    std::fprintf(file, "{\n  \"context\": {\n");
+    std::fprintf(file, "    \"date\": \"%s\",\n", date);
+    std::fprintf(file, "    \"build\": \"%s\",\n", BUILD_CONFIG);
+    std::fprintf(file, "    \"bounds_checks\": \"%s\",\n", BOUNDS_CHECKS);
+    std::fprintf(file, "    \"isa\": \"%s\",\n", isaLevelName(getIsaLevel()));
+    std::fprintf(file, "    \"cpus\": %u,\n", std::thread::hardware_concurrency());
+    std::fprintf(file, "    \"min_time\": %g,\n", options.minTime);
+    std::fprintf(file, "    \"repetitions\": %d\n  },\n", options.repetitions);
+
+    // the names are made of letters, digits and "/_x", so they need no escaping
+    std::fprintf(file, "  \"benchmarks\": [");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult& result = results[i];
+        std::fprintf(file, "%s\n    {\"name\": \"%s\", \"iterations\": %ld, \"median_ns\": %.2f, "
+                     "\"mean_ns\": %.2f, \"stddev_ns\": %.2f, \"min_ns\": %.2f, "
+                     "\"items_per_second\": %.1f}", (i == 0) ? "" : ",", result.name.c_str(),
+                     result.iterations, result.median, result.mean, result.stddev, result.min,
+                     itemsPerSecond(result));
+    }
+    std::fprintf(file, "\n  ]\n}\n");
+    std::fclose(file);
+}
+
+/**
+ * @brief reads the options from the command line
+ * @param argc - the number of arguments
+ * @param argv - the arguments
+ * @param options - the options to fill
+ * @return true if the arguments are valid
+ */
+static bool parseOptions(int argc, char* argv[], BenchOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, FILTER_FLAG, std::strlen(FILTER_FLAG)) == 0)
+        {
+            options.filter = arg + std::strlen(FILTER_FLAG);
+        }
+        else if (std::strncmp(arg, MIN_TIME_FLAG, std::strlen(MIN_TIME_FLAG)) == 0)
+        {
+            options.minTime = std::atof(arg + std::strlen(MIN_TIME_FLAG));
+        }
+        else if (std::strncmp(arg, REPETITIONS_FLAG, std::strlen(REPETITIONS_FLAG)) == 0)
+        {
+            options.repetitions = std::atoi(arg + std::strlen(REPETITIONS_FLAG));
+        }
+        else if (std::strncmp(arg, JSON_FLAG, std::strlen(JSON_FLAG)) == 0)
+        {
+            options.jsonPath = arg + std::strlen(JSON_FLAG);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << USAGE_MSG << std::endl;
+        return EXIT_FAILURE;
+    }
+    if ((options.minTime <= 0) || (options.repetitions <= 0))
+    {
+        std::cerr << STR_BENCH_ARGS_ERR << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    unsigned int seed = RANDOM_SEED;
+    Matrix weights[MLP_SIZE];
+    Matrix biases[MLP_SIZE];
+    Matrix inputs[MLP_SIZE]; // an input of the size of every dense
+    for (int i = 0; i < MLP_SIZE; i++)
+    {
+        weights[i] = randomMatrix(weightsDims[i].rows, weightsDims[i].cols,
+                                  1.0f / weightsDims[i].cols, seed);
+        biases[i] = randomMatrix(biasDims[i].rows, biasDims[i].cols, 0.1f, seed);
+        inputs[i] = randomMatrix(weightsDims[i].cols, 1, 1.0f, seed);
+    }
+    Matrix image = inputs[0];
+
+    MlpNetwork dynamicNetwork(weights, biases);
+    MlpNetwork quantizedNetwork(weights, biases);
+    quantizedNetwork.setQuantized(true);
+    std::unique_ptr<StaticMlpNetwork> staticNetwork(new StaticMlpNetwork(weights, biases));
+    std::vector<Dense> denses;
+    denses.reserve(MLP_SIZE);
+    for (int i = 0; i < MLP_SIZE; i++)
+    {
+        denses.emplace_back(weights[i], biases[i], (i == MLP_SIZE - 1) ? Softmax : Relu);
+    }
+    std::vector<Dense> halfDenses(denses);
+    std::vector<Dense> bfloat16Denses(denses);
+    for (int i = 0; i < MLP_SIZE; i++)
+    {
+        halfDenses[i].setWeightPrecision(PrecisionHalf);
+        bfloat16Denses[i].setWeightPrecision(PrecisionBfloat16);
+    }
+    Activation relu(Relu);
+    Activation softmax(Softmax);
+    Activation softmaxFastExp(Softmax);
+    softmaxFastExp.setFastExp(true);
+    Matrix logits = randomMatrix(biasDims[MLP_SIZE - 1].rows, SOFTMAX_BATCH, 10.0f, seed);
+    Classification classification; // the result of the output mode benchmarks
+    Matrix sums[MLP_SIZE]; // the matrices the additions add into
+    Matrix scaledSum;      // the matrix the expressions are evaluated into
+    Matrix paddedWeights[MLP_SIZE];
+    Matrix batches[sizeof(batchSizes) / sizeof(batchSizes[0])];
+
+    std::vector<Benchmark> benchmarks;
+    for (int i = 0; i < MLP_SIZE; i++)
+    {
+        std::string shape = std::to_string(weightsDims[i].rows) + "x" +
+                            std::to_string(weightsDims[i].cols);
+        benchmarks.push_back({"matrix_mul/" + shape, 1, [&, i]()
+        {
+            keepValue(weights[i] * inputs[i]);
+        }});
+        paddedWeights[i] = paddedCopy(weights[i]);
+        benchmarks.push_back({"matrix_mul_padded/" + shape, 1, [&, i]()
+        {
+            keepValue(paddedWeights[i] * inputs[i]);
+        }});
+        sums[i] = biases[i];
+        benchmarks.push_back({"matrix_add_assign/" + std::to_string(biasDims[i].rows), 1, [&, i]()
+        {
+            keepValue(sums[i] += biases[i]);
+        }});
+        benchmarks.push_back({"dense/" + std::to_string(i) + "_" + shape, 1, [&, i]()
+        {
+            keepValue(denses[i](inputs[i]));
+        }});
+        benchmarks.push_back({"dense_fp16/" + std::to_string(i) + "_" + shape, 1, [&, i]()
+        {
+            keepValue(halfDenses[i](inputs[i]));
+        }});
+        benchmarks.push_back({"dense_bf16/" + std::to_string(i) + "_" + shape, 1, [&, i]()
+        {
+            keepValue(bfloat16Denses[i](inputs[i]));
+        }});
+    }
+    // the three loops differ only in the accessor: in a release build the unchecked ones
+    // vectorize and run alike, and only the checked one pays for its branches
+    std::string accessShape = std::to_string(weightsDims[0].rows) + "x" +
+                              std::to_string(weightsDims[0].cols);
+    benchmarks.push_back({"matrix_access_checked/" + accessShape, 1, [&]()
+    {
+        keepValue(countPositiveChecked(weights[0]));
+    }});
+    benchmarks.push_back({"matrix_access/" + accessShape, 1, [&]()
+    {
+        keepValue(countPositive(weights[0]));
+    }});
+    benchmarks.push_back({"matrix_access_rows/" + accessShape, 1, [&]()
+    {
+        keepValue(countPositiveRows(weights[0]));
+    }});
+    scaledSum = weights[0];
+    benchmarks.push_back({"matrix_scale_add/" + accessShape, 1, [&]()
+    {
+        keepValue(scaledSum = 0.5f * weights[0] + scaledSum);
+    }});
+    benchmarks.push_back({"matrix_expr_chain/" + accessShape, 1, [&]()
+    {
+        keepValue(scaledSum = 0.5f * weights[0] + scaledSum + weights[0] * 0.25f);
+    }});
+    benchmarks.push_back({"activation_relu/" + std::to_string(biasDims[0].rows), 1, [&]()
+    {
+        keepValue(relu(inputs[1]));
+    }});
+    benchmarks.push_back({"activation_softmax/" + std::to_string(biasDims[MLP_SIZE - 1].rows), 1,
+                          [&]()
+    {
+        keepValue(softmax(biases[MLP_SIZE - 1]));
+    }});
+    benchmarks.push_back({"activation_softmax_fast/" +
+                          std::to_string(biasDims[MLP_SIZE - 1].rows), 1, [&]()
+    {
+        keepValue(softmaxFastExp(biases[MLP_SIZE - 1]));
+    }});
+    std::string batchShape = std::to_string(logits.getRows()) + "x" + std::to_string(SOFTMAX_BATCH);
+    benchmarks.push_back({"activation_softmax/" + batchShape, SOFTMAX_BATCH, [&]()
+    {
+        keepValue(softmax(logits));
+    }});
+    benchmarks.push_back({"activation_softmax_fast/" + batchShape, SOFTMAX_BATCH, [&]()
+    {
+        keepValue(softmaxFastExp(logits));
+    }});
+    benchmarks.push_back({"network/latency", 1, [&]()
+    {
+        keepValue(dynamicNetwork(image));
+    }});
+    benchmarks.push_back({"network/latency_argmax", 1, [&]()
+    {
+        dynamicNetwork.classify(image, OutputArgmax, 1, classification);
+        keepValue(classification);
+    }});
+    benchmarks.push_back({"network/latency_top" + std::to_string(TOP_K), 1, [&]()
+    {
+        dynamicNetwork.classify(image, OutputTopK, TOP_K, classification);
+        keepValue(classification);
+    }});
+    benchmarks.push_back({"network/latency_static", 1, [&]()
+    {
+        keepValue((*staticNetwork)(image.data()));
+    }});
+    benchmarks.push_back({"network/latency_int8", 1, [&]()
+    {
+        keepValue(quantizedNetwork(image));
+    }});
+    for (size_t b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); b++)
+    {
+        batches[b] = randomMatrix(weightsDims[0].cols, batchSizes[b], 1.0f, seed);
+        benchmarks.push_back({"network/batch/" + std::to_string(batchSizes[b]), batchSizes[b],
+                              [&, b]()
+        {
+            keepValue(dynamicNetwork.classifyBatch(batches[b]));
+        }});
+    }
+
+    std::printf("build %s, isa %s, bounds checks %s\n", BUILD_CONFIG, isaLevelName(getIsaLevel()),
+                BOUNDS_CHECKS);
+    std::printf("%-32s %12s %10s %12s %14s\n", "benchmark", "median ns", "stddev", "iterations",
+                "items/s");
+    std::vector<BenchResult> results;
+    for (const Benchmark& benchmark : benchmarks)
+    {
+        if (benchmark.name.find(options.filter) == std::string::npos)
+        {
+            continue;
+        }
+        results.push_back(runBenchmark(benchmark, options));
+        const BenchResult& result = results.back();
+        std::printf("%-32s %12.1f %10.1f %12ld %14.0f\n", result.name.c_str(), result.median,
+                    result.stddev, result.iterations, itemsPerSecond(result));
+        std::fflush(stdout);
+    }
+    if (!options.jsonPath.empty())
+    {
+        writeJson(options.jsonPath, results, options);
+    }
+
+    // the static network is only worth measuring while it computes the same thing
+    if (dynamicNetwork(image).value != (*staticNetwork)(image.data()).value)
+    {
+        std::cerr << STR_DIFFERENT_RESULTS_ERR << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,249 @@
+/**
+* @file   BinaryReader.cpp
+* @brief a program that implements BinaryReader.h. bulk reading of floats from binary files
+* @section DESCRIPTION a program that implements BinaryReader.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "BinaryReader.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STR_OPEN_FILE_ERR  "Error: cannot open file "
+#define STR_READ_FILE_ERR  "Error: cannot read file "
+#define STR_SHORT_FILE_ERR "Error: not enough data in file "
+#define TRANSPOSE_BLOCK 32 // the rows and cols of one tile when images are turned into columns
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief returns the byte order of the host
+ * @return the byte order
+ */
+ByteOrder hostByteOrder()
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    return BigEndian;
+#else
+    return LittleEndian;
+#endif
+}
+
+/**
+ * @brief reverses the bytes of every float in an array
+ * @param values - the array
+ * @param count - the number of floats
+ */
+void swapFloatBytes(float* values, long count)
+{
+    for (long i = 0; i < count; i++)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, values + i, sizeof(bits));
+        bits = __builtin_bswap32(bits);
+        std::memcpy(values + i, &bits, sizeof(bits));
+    }
+}
+
+/**
+ * @brief reads floats from a stream with one read, and fixes their byte order
+ * @param is - the stream
+ * @param values - the array to read into
+ * @param count - the number of floats
+ * @param order - the byte order of the floats in the stream
+ * @return true if all the floats were read
+ */
+bool readFloats(std::istream& is, float* values, long count, ByteOrder order)
+{
+    std::streamsize bytes = (std::streamsize)(count * sizeof(float));
+    if (!is.read((char*)values, bytes) || (is.gcount() != bytes))
+    {
+        return false;
+    }
+    if (order != hostByteOrder())
+    {
+        swapFloatBytes(values, count);
+    }
+    return true;
+}
+
+/**
+ * @brief opens a file, prints an error and exits if it cannot be opened
+ * @param path - the path of the file
+ * @param order - the byte order of the floats in the file
+ */
+BinaryReader::BinaryReader(const std::string& path, ByteOrder order): _path(path), _order(order),
+                                                                    _fd(-1), _remaining(0)
+{
+    _fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if ((_fd < 0) || (fstat(_fd, &info) != 0))
+    {
+        std::cerr << STR_OPEN_FILE_ERR << path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    _remaining = (long)info.st_size;
+}
+
+/**
+ * @brief destructor for binary reader, closes the file
+ */
+BinaryReader::~BinaryReader()
+{
+    close(_fd);
+}
+
+/**
+ * @brief returns the number of bytes in the file that were not read yet
+ * @return the number of bytes
+ */
+long BinaryReader::getRemaining() const
+{
+    return _remaining;
+}
+
+/**
+ * @brief reads floats with one read, and fixes their byte order
+ * @param values - the array to read into
+ * @param count - the number of floats
+ * @return true if the floats were read, false (and nothing is read) if the file does not
+ *         have that many floats left
+ */
+bool BinaryReader::read(float* values, long count)
+{
+    if ((count < 0) || !readBytes((unsigned char*)values, count * (long)sizeof(float)))
+    {
+        return false;
+    }
+    if (_order != hostByteOrder())
+    {
+        swapFloatBytes(values, count);
+    }
+    return true;
+}
+
+/**
+ * @brief reads raw bytes with one read
+ * @param values - the array to read into
+ * @param count - the number of bytes
+ * @return true if the bytes were read, false (and nothing is read) if the file does not
+ *         have that many bytes left
+ */
+bool BinaryReader::readBytes(unsigned char* values, long count)
+{
+    if ((count < 0) || (count > _remaining))
+    {
+        return false;
+    }
+
+    // a read may return less than asked for (a signal or a pipe), so it goes on until done
+    long done = 0;
+    while (done < count)
+    {
+        ssize_t got = ::read(_fd, values + done, count - done);
+        if ((got < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            std::cerr << STR_READ_FILE_ERR << _path << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        done += got;
+    }
+    _remaining -= count;
+    return true;
+}
+
+/**
+ * @brief reads a 32 bit integer in the byte order of the file
+ * @param value - the integer to read into
+ * @return true if the integer was read, false if the file does not have 4 bytes left
+ */
+bool BinaryReader::readInt32(int32_t& value)
+{
+    unsigned char bytes[sizeof(int32_t)];
+    if (!readBytes(bytes, sizeof(bytes)))
+    {
+        return false;
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < (int)sizeof(bytes); i++)
+    {
+        int shift = (_order == BigEndian) ? (8 * ((int)sizeof(bytes) - 1 - i)) : (8 * i);
+        bits |= (uint32_t)bytes[i] << shift;
+    }
+    value = (int32_t)bits;
+    return true;
+}
+
+/**
+ * @brief fills a matrix with the next floats of the file, row after row.
+ *        prints an error and exits if the file does not have enough floats left
+ * @param mat - the matrix, at the size to read
+ */
+void BinaryReader::readMatrix(Matrix& mat)
+{
+    bool complete = true;
+    if (mat.isPacked())
+    {
+        complete = read(mat.data(), (long)mat.getRows() * mat.getCols());
+    }
+    else
+    {
+        // the rows of a padded matrix are read one by one, around the padding
+        for (int i = 0; (i < mat.getRows()) && complete; i++)
+        {
+            complete = read(mat.row(i), mat.getCols());
+        }
+    }
+    if (!complete)
+    {
+        std::cerr << STR_SHORT_FILE_ERR << _path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief reads images that are stored one after the other into the columns of one batch,
+ *        with one read for all of them. prints an error and exits if the file does not have
+ *        enough floats left
+ * @param count - the number of images
+ * @param imageSize - the number of floats in every image
+ * @return the batch, at size imageSize*count
+ */
+Matrix BinaryReader::readImages(int count, int imageSize)
+{
+    // the images are read as the rows of one matrix, then turned into columns
+    Matrix rows(count, imageSize);
+    readMatrix(rows);
+
+    Matrix batch(imageSize, count);
+    const float* images = rows.data();
+    float* columns = batch.data();
+
+    // Goes over TRANSPOSE_BLOCK*TRANSPOSE_BLOCK tiles, so the reads and the writes of a tile
+    // both stay in the cache
+    for (int jj = 0; jj < count; jj += TRANSPOSE_BLOCK)
+    {
+        int jEnd = (jj + TRANSPOSE_BLOCK < count) ? (jj + TRANSPOSE_BLOCK) : count;
+        for (int ii = 0; ii < imageSize; ii += TRANSPOSE_BLOCK)
+        {
+            int iEnd = (ii + TRANSPOSE_BLOCK < imageSize) ? (ii + TRANSPOSE_BLOCK) : imageSize;
+            for (int i = ii; i < iEnd; i++)
+            {
+                for (int j = jj; j < jEnd; j++)
+                {
+                    columns[(long)i * count + j] = images[(long)j * imageSize + i];
+                }
+            }
+        }
+    }
+    return batch;
+}
@@ -0,0 +1,122 @@
+
+//BinaryReader.h
+
+#ifndef BINARYREADER_H
+#define BINARYREADER_H
+
+#include "Matrix.h"
+#include <cstdint>
+#include <string>
+
+/**
+ * @enum ByteOrder
+ * @brief Indicator of the order of the bytes of the floats in a file.
+ */
+enum ByteOrder
+{
+    LittleEndian,
+    BigEndian
+};
+
+/**
+ * @brief returns the byte order of the host
+ * @return the byte order
+ */
+ByteOrder hostByteOrder();
+
+/**
+ * @brief reverses the bytes of every float in an array
+ * @param values - the array
+ * @param count - the number of floats
+ */
+void swapFloatBytes(float* values, long count);
+
+/**
+ * @brief reads floats from a stream with one read, and fixes their byte order
+ * @param is - the stream
+ * @param values - the array to read into
+ * @param count - the number of floats
+ * @param order - the byte order of the floats in the stream
+ * @return true if all the floats were read
+ */
+bool readFloats(std::istream& is, float* values, long count, ByteOrder order = LittleEndian);
+
+/**
+ * @brief class that reads whole matrices and batches of images from a binary file of floats,
+ *        each with one read of the file instead of one per float. the number of bytes left is
+ *        checked before every read, so a short file is an error and not a partial matrix
+ */
+class BinaryReader
+{
+public:
+    /**
+     * @brief opens a file, prints an error and exits if it cannot be opened
+     * @param path - the path of the file
+     * @param order - the byte order of the floats in the file
+     */
+    explicit BinaryReader(const std::string& path, ByteOrder order = LittleEndian);
+
+    /**
+     * @brief destructor for binary reader, closes the file
+     */
+    ~BinaryReader();
+
+    BinaryReader(const BinaryReader&) = delete;
+    BinaryReader& operator=(const BinaryReader&) = delete;
+
+    /**
+     * @brief returns the number of bytes in the file that were not read yet
+     * @return the number of bytes
+     */
+    long getRemaining() const;
+
+    /**
+     * @brief reads floats with one read, and fixes their byte order
+     * @param values - the array to read into
+     * @param count - the number of floats
+     * @return true if the floats were read, false (and nothing is read) if the file does not
+     *         have that many floats left
+     */
+    bool read(float* values, long count);
+
+    /**
+     * @brief reads raw bytes with one read
+     * @param values - the array to read into
+     * @param count - the number of bytes
+     * @return true if the bytes were read, false (and nothing is read) if the file does not
+     *         have that many bytes left
+     */
+    bool readBytes(unsigned char* values, long count);
+
+    /**
+     * @brief reads a 32 bit integer in the byte order of the file
+     * @param value - the integer to read into
+     * @return true if the integer was read, false if the file does not have 4 bytes left
+     */
+    bool readInt32(int32_t& value);
+
+    /**
+     * @brief fills a matrix with the next floats of the file, row after row.
+     *        prints an error and exits if the file does not have enough floats left
+     * @param mat - the matrix, at the size to read
+     */
+    void readMatrix(Matrix& mat);
+
+    /**
+     * @brief reads images that are stored one after the other into the columns of one batch,
+     *        with one read for all of them. prints an error and exits if the file does not have
+     *        enough floats left
+     * @param count - the number of images
+     * @param imageSize - the number of floats in every image
+     * @return the batch, at size imageSize*count
+     */
+    Matrix readImages(int count, int imageSize);
+
+private:
+    std::string _path; // the path of the file, for the errors
+    ByteOrder _order;  // the byte order of the floats in the file
+    int _fd;           // the file descriptor
+    long _remaining;   // the number of bytes that were not read yet
+};
+
+#endif //BINARYREADER_H
@@ -0,0 +1,312 @@
+
+//BoundedQueue.h
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define STR_QUEUE_CAPACITY_ERR "Error: the capacity of a queue must be a power of two, at least 2"
+#define QUEUE_CACHE_LINE 64
+#define QUEUE_SPINS 64  // failed tries before a blocked push or pop yields the core
+#define QUEUE_YIELDS 16 // yields after them before it sleeps until the other side wakes it
+
+/**
+ * @brief class that represents a bounded lock-free queue for many producers and many consumers
+ *        (Vyukov's array queue). every cell has a sequence number that says whose turn it is,
+ *        so a push and a pop each take one compare-and-swap. push blocks while the queue is
+ *        full, which is how a slow stage pushes back on the stage before it. a blocked push or
+ *        pop spins, then yields, then sleeps on a condition variable, so an idle stage does not
+ *        keep a core busy. the side that frees it takes the lock only when someone sleeps
+ * @tparam T - the type of the items, cheap to move (a pointer in the pipeline)
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    /**
+     * @brief constructor for bounded queue
+     * @param capacity - the number of items it holds, a power of two of at least 2 (with one
+     *                   cell the sequence of a full cell looks like the one of a free cell)
+     */
+    explicit BoundedQueue(size_t capacity): _cells(capacity), _mask(capacity - 1), _head(0),
+                                            _tail(0), _closed(false), _sleepingPushes(0),
+                                            _sleepingPops(0)
+    {
+        if ((capacity < 2) || ((capacity & (capacity - 1)) != 0))
+        {
+            std::cerr << STR_QUEUE_CAPACITY_ERR << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < capacity; i++)
+        {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * @brief adds an item if there is room
+     * @param item - the item
+     * @return true if it was added, false if the queue is full
+     */
+    bool tryPush(T item)
+    {
+        if (!_tryPush(item))
+        {
+            return false;
+        }
+        _wake(_sleepingPops, _notEmpty);
+        return true;
+    }
+
+    /**
+     * @brief takes the oldest item if there is one
+     * @param item - the item to move it into
+     * @return true if an item was taken, false if the queue is empty
+     */
+    bool tryPop(T& item)
+    {
+        if (!_tryPop(item))
+        {
+            return false;
+        }
+        _wake(_sleepingPushes, _notFull);
+        return true;
+    }
+
+    /**
+     * @brief adds an item, waiting while the queue is full
+     * @param item - the item
+     */
+    void push(T item)
+    {
+        for (int tries = 0; !_tryPush(item); tries++)
+        {
+            if (tries >= QUEUE_SPINS + QUEUE_YIELDS)
+            {
+                _sleepUntil(_sleepingPushes, _notFull, [this, &item]()
+                                                       {
+                                                           return _tryPush(item);
+                                                       });
+                break;
+            }
+            if (tries >= QUEUE_SPINS)
+            {
+                std::this_thread::yield();
+            }
+        }
+        _wake(_sleepingPops, _notEmpty);
+    }
+
+    /**
+     * @brief takes the oldest item, waiting while the queue is empty and not closed
+     * @param item - the item to move it into
+     * @return true if an item was taken, false if the queue is closed and empty
+     */
+    bool pop(T& item)
+    {
+        bool taken = true;
+        for (int tries = 0; !_tryPop(item); tries++)
+        {
+            if (_closed.load(std::memory_order_acquire))
+            {
+                // an item may have been pushed right before the queue was closed
+                taken = _tryPop(item);
+                break;
+            }
+            if (tries >= QUEUE_SPINS + QUEUE_YIELDS)
+            {
+                _sleepUntil(_sleepingPops, _notEmpty, [this, &item, &taken]()
+                                                      {
+                                                          if (_tryPop(item))
+                                                          {
+                                                              return true;
+                                                          }
+                                                          if (!_closed.load())
+                                                          {
+                                                              return false;
+                                                          }
+                                                          taken = _tryPop(item);
+                                                          return true;
+                                                      });
+                break;
+            }
+            if (tries >= QUEUE_SPINS)
+            {
+                std::this_thread::yield();
+            }
+        }
+        if (taken)
+        {
+            _wake(_sleepingPushes, _notFull);
+        }
+        return taken;
+    }
+
+    /**
+     * @brief closes the queue: no more items will be pushed, pop returns false once it is empty
+     */
+    void close()
+    {
+        _closed.store(true);
+        std::lock_guard<std::mutex> guard(_sleepLock);
+        _notEmpty.notify_all();
+    }
+
+    /**
+     * @brief returns the number of items in the queue (a snapshot, it may change right away)
+     * @return the number of items
+     */
+    size_t size() const
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t head = _head.load(std::memory_order_relaxed);
+        return (tail > head) ? (tail - head) : 0;
+    }
+
+    /**
+     * @brief returns the number of items the queue holds
+     * @return the capacity
+     */
+    size_t capacity() const
+    {
+        return _mask + 1;
+    }
+
+private:
+    /**
+     * @brief adds an item if there is room, without waking the sleeping pops
+     * @param item - the item, moved from only if it was added
+     * @return true if it was added, false if the queue is full
+     */
+    bool _tryPush(T& item)
+    {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = _cells[pos & _mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            long diff = (long)sequence - (long)pos;
+
+            // the cell is free for this position: claim the position, then fill the cell
+            if (diff == 0)
+            {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.item = std::move(item);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // the cell still holds the item of the previous round
+            }
+            else
+            {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief takes the oldest item if there is one, without waking the sleeping pushes
+     * @param item - the item to move it into
+     * @return true if an item was taken, false if the queue is empty
+     */
+    bool _tryPop(T& item)
+    {
+        size_t pos = _head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = _cells[pos & _mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            long diff = (long)sequence - (long)(pos + 1);
+
+            // the cell was filled for this position: claim the position, then empty the cell
+            if (diff == 0)
+            {
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    item = std::move(cell.item);
+                    cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // the producer of this position did not fill it yet
+            }
+            else
+            {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief sleeps until a try succeeds. the sleeper is counted before it tries again under
+     *        the lock, so a thread that frees the queue after that try sees the count and wakes
+     *        it (both sides order the count and the queue with sequentially consistent atomics)
+     * @param sleeping - the count of the sleepers of this side
+     * @param wakeUp - the condition variable of this side
+     * @param tryOnce - tries to push or pop once, true when done
+     */
+    template <typename Try>
+    void _sleepUntil(std::atomic<int>& sleeping, std::condition_variable& wakeUp, Try tryOnce)
+    {
+        std::unique_lock<std::mutex> sleep(_sleepLock);
+        sleeping.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wakeUp.wait(sleep, tryOnce);
+        sleeping.fetch_sub(1);
+    }
+
+    /**
+     * @brief wakes the sleepers of a side after an item was pushed or popped, if there are any
+     * @param sleeping - the count of the sleepers of the side
+     * @param wakeUp - the condition variable of the side
+     */
+    void _wake(std::atomic<int>& sleeping, std::condition_variable& wakeUp)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load() > 0)
+        {
+            std::lock_guard<std::mutex> guard(_sleepLock);
+            wakeUp.notify_all();
+        }
+    }
+
+    /**
+     * @struct Cell
+     * @brief one cell of the queue, on its own cache line
+     */
+    typedef struct alignas(QUEUE_CACHE_LINE) Cell
+    {
+        std::atomic<size_t> sequence; // pos: free for a push, pos + 1: full for a pop
+        T item;
+    } Cell;
+
+    std::vector<Cell> _cells;
+    const size_t _mask;
+    alignas(QUEUE_CACHE_LINE) std::atomic<size_t> _head; // the next position to pop
+    alignas(QUEUE_CACHE_LINE) std::atomic<size_t> _tail; // the next position to push
+    std::atomic<bool> _closed;
+    std::mutex _sleepLock;              // guards the sleep of blocked pushes and pops
+    std::condition_variable _notFull;   // wakes the sleeping pushes
+    std::condition_variable _notEmpty;  // wakes the sleeping pops
+    std::atomic<int> _sleepingPushes;   // the pushes that sleep or are about to
+    std::atomic<int> _sleepingPops;     // the pops that sleep or are about to
+};
+
+#endif //BOUNDEDQUEUE_H
@@ -1,68 +1,313 @@
-/**
-* @file   Dense.cpp
-* @brief a program that implements Dense.h. represents and creates a dense in mlpnetwork
-* @section DESCRIPTION a program that implements Dense.h.
-*/
-
-// -------------------------------------- includes ------------------------------------------------
-
-#include "Dense.h"
-#include "Activation.h"
-
-// ------------------------------------------- function declaration -------------------------------
-
-/**
- * @brief constructor for dense
- * @param w - array of 4 matrices
- * @param bias - array of 4 matrices
- * @param actType - activation type
- */
-Dense::Dense(Matrix& w, Matrix& bias, ActivationType actType):_w(w), _bias(bias), _act(actType)
-{
-}
-
-/**
- * @brief return the weights matrix of the dense
- * @return - the weights matrix
- */
-const Matrix& Dense::getWeights() const
-{
-    return _w;
-}
-
-/**
- * @brief return the bias matrix of the dense
- * @return - the bias matrix
- */
-const Matrix& Dense::getBias() const
-{
-    return _bias;
-}
-
-/**
- * @brief the activation type
- * @return
- */
-Activation Dense::getActivation() const
-{
-   return _act;
-}
-
-/**
-* @brief performs the activation function on the input
-* @param matVector - the input matrix
-* @return - the matrix after the activation function
-*/
-Matrix Dense::operator()(const Matrix& matVector) const
-{
-    Matrix outputMat(matVector.getRows(), matVector.getCols());
-    Matrix mat = (getWeights() * matVector);
-
-    mat += getBias();
-    outputMat = getActivation()(mat);
-    return outputMat;
-}
-
-
-
-
+/**
+* @file   Dense.cpp
+* @brief a program that implements Dense.h. represents and creates a dense in mlpnetwork
+* @section DESCRIPTION a program that implements Dense.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+
+#include "Dense.h"
+#include "Activation.h"
+#include "Gemm.h"
+#include "Profiler.h"
+#include "SimdKernels.h"
+#include <utility>
+
+#define ERROR_WRONG_SIZE_INPUT "Error: different sizes input matrix"
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief constructor for dense
+ * @param w - array of 4 matrices
+ * @param bias - array of 4 matrices
+ * @param actType - activation type
+ */
+Dense::Dense(Matrix& w, Matrix& bias, ActivationType actType):_w(w), _bias(bias),
+                                                              _precision(PrecisionFloat),
+                                                              _act(actType)
+{
+    _pack(nullptr);
+}
+
+/**
+ * @brief constructor for dense that takes the matrices without copying them, so a dense
+ *        can run on views into a slab or a mapped model file. with their panels it copies
+ *        nothing, and holds the panels while it runs on them
+ * @param w - the weights matrix, left empty
+ * @param bias - the bias matrix, left empty
+ * @param actType - activation type
+ * @param panels - the weights and the bias packed by packPanels, or nullptr to pack them
+ */
+Dense::Dense(Matrix&& w, Matrix&& bias, ActivationType actType,
+             std::shared_ptr<const float> panels):
+             _w(std::move(w)), _bias(std::move(bias)), _givenPanels(panels),
+             _precision(PrecisionFloat), _act(actType)
+{
+    _pack(std::move(panels));
+}
+
+/**
+ * @brief runs the dense on given panels, or packs the weights and the bias into its own
+ * @param panels - the packed panels, or nullptr to pack them
+ */
+void Dense::_pack(std::shared_ptr<const float> panels)
+{
+    // the half panels and the unfused pass read the bias as one array, a padded bias is packed
+    if (!_bias.isPacked())
+    {
+        _bias = Matrix(_bias.asView());
+    }
+    if (panels != nullptr)
+    {
+        _panels = std::move(panels);
+        return;
+    }
+
+    // its own panels are an aligned matrix, the pointer to its cells keeps the matrix alive
+    std::shared_ptr<Matrix> own = std::make_shared<Matrix>(
+        (int)packedPanelsSize(_w.getRows(), _w.getCols()), 1);
+    packPanels(_w.asView(), _bias.data(), own->data());
+    _panels = std::shared_ptr<const float>(own, own->data());
+}
+
+/**
+ * @brief return the weights matrix of the dense
+ * @return - the weights matrix
+ */
+const Matrix& Dense::getWeights() const
+{
+    return _w;
+}
+
+/**
+ * @brief return the bias matrix of the dense
+ * @return - the bias matrix
+ */
+const Matrix& Dense::getBias() const
+{
+    return _bias;
+}
+
+/**
+ * @brief returns the weights and the bias packed into panels, which a replica of the dense
+ *        can run on without packing them again. the replica holds them, so they stay valid
+ *        when this dense switches to a half precision or is destroyed
+ * @return the packedPanelsSize floats of the panels, nullptr in a half precision
+ */
+std::shared_ptr<const float> Dense::getPanels() const
+{
+    return _panels;
+}
+
+/**
+ * @brief gives the dense the panels to run on in the float precision, packed by packPanels
+ *        from its weights and bias. in a half precision they are only read once the dense
+ *        is back in floats, until then the dense holds them
+ * @param panels - the panels, or nullptr to pack its own
+ */
+void Dense::setPanels(std::shared_ptr<const float> panels)
+{
+    _givenPanels = panels;
+    if (_precision == PrecisionFloat)
+    {
+        _pack(std::move(panels));
+    }
+}
+
+/**
+ * @brief the activation type
+ * @return
+ */
+Activation Dense::getActivation() const
+{
+   return _act;
+}
+
+/**
+ * @brief switches the softmax of the dense to the fast exp, or back to std::exp
+ * @param fastExp - true for the fast exp
+ */
+void Dense::setFastExp(bool fastExp)
+{
+    _act.setFastExp(fastExp);
+}
+
+/**
+ * @brief sets how the products store the weights. a half precision packs the weights again
+ *        from the float matrix, in 16 bits (the bias stays a float), and lets the float
+ *        panels go (they are freed if no replica holds them); the float precision frees the
+ *        16 bit panels and packs the float ones again, or runs on the given ones. only the
+ *        panels a product streams shrink: the float matrix stays, both are packed from it
+ * @param precision - the precision
+ */
+void Dense::setWeightPrecision(WeightPrecision precision)
+{
+    if (precision == PrecisionFloat)
+    {
+        std::vector<uint16_t>().swap(_halfPanels);
+        if (_panels == nullptr)
+        {
+            _pack(_givenPanels);
+        }
+    }
+    else if (precision != _precision)
+    {
+        _halfPanels.resize(packedHalfPanelsSize(_w.getRows(), _w.getCols()));
+        packHalfPanels(_w.asView(), _bias.data(),
+                       (precision == PrecisionHalf) ? HalfIeee : HalfBfloat16,
+                       _halfPanels.data());
+
+        // its own panels are freed unless a copy or a replica still runs on them, given panels
+        // are held by _givenPanels until the network lets them go
+        _panels.reset();
+    }
+    _precision = precision;
+}
+
+/**
+ * @brief returns how the products store the weights
+ * @return the precision
+ */
+WeightPrecision Dense::getWeightPrecision() const
+{
+    return _precision;
+}
+
+/**
+* @brief performs the activation function on the input
+* @param matVector - the input matrix, one column per image
+* @return - the matrix after the activation function
+*/
+Matrix Dense::operator()(const Matrix& matVector) const
+{
+    return (*this)(matVector, nullptr);
+}
+
+/**
+ * @brief performs the activation function on the input, splitting the rows of the
+ *        product between the threads of a pool
+ * @param matVector - the input matrix, one column per image
+ * @param pool - the thread pool, or nullptr to run on the calling thread
+ * @return - the matrix after the activation function
+ */
+Matrix Dense::operator()(const Matrix& matVector, ThreadPool* pool) const
+{
+    Matrix outputMat(_w.getRows(), matVector.getCols());
+
+    forward(matVector, outputMat, pool);
+    return outputMat;
+}
+
+/**
+ * @brief performs the activation function on the input into an output matrix, reusing its
+ *        array when it is big enough, so a warm call does not allocate
+ * @param matVector - the input matrix, one column per image
+ * @param output - the matrix to write the result into (not matVector)
+ * @param pool - the thread pool, or nullptr to run on the calling thread
+ * @return - the output matrix
+ */
+Matrix& Dense::forward(const Matrix& matVector, Matrix& output, ThreadPool* pool) const
+{
+    if ((matVector.getRows() != _w.getCols()) || (&matVector == &output))
+    {
+        std::cerr << ERROR_WRONG_SIZE_INPUT << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // the input and the output may be padded, the product reads and writes them by their stride
+    output.resize(_w.getRows(), matVector.getCols());
+    forward(matVector.asView(), output.asView(), pool);
+    return output;
+}
+
+/**
+ * @brief performs the activation function on a row-major input array, writing straight
+ *        into a preallocated output array. the product, bias and relu are fused into one
+ *        pass that reads the weights once and writes the output once, softmax then runs
+ *        on the output while it is in the cache
+ * @param input - the input array, the cols of the weights matrix times cols floats
+ * @param cols - the number of cols in the input, one per image
+ * @param output - the output array, the rows of the weights matrix times cols floats
+ * @param pool - the thread pool, or nullptr to run on the calling thread
+ * @param softmax - false to leave the output before softmax (relu is always performed)
+ */
+void Dense::forward(const float* input, int cols, float* output, ThreadPool* pool,
+                    bool softmax) const
+{
+    forward(ConstMatrixView(input, _w.getCols(), cols), MatrixView(output, _w.getRows(), cols),
+            pool, softmax);
+}
+
+/**
+ * @brief like the forward on arrays, on views of any stride: a sub-batch of a bigger batch
+ *        or images inside a buffer are read where they are. prints an error and exits if
+ *        the sizes do not match the weights
+ * @param input - the input, the cols of the weights matrix rows, one column per image
+ * @param output - the output, the rows of the weights matrix rows, as many cols as input
+ * @param pool - the thread pool, or nullptr to run on the calling thread
+ * @param softmax - false to leave the output before softmax (relu is always performed)
+ */
+void Dense::forward(ConstMatrixView input, MatrixView output, ThreadPool* pool,
+                    bool softmax) const
+{
+    PROFILE_SCOPE(ProfileDense);
+    if ((input.getRows() != _w.getCols()) || (output.getRows() != _w.getRows()) ||
+        (output.getCols() != input.getCols()))
+    {
+        std::cerr << ERROR_WRONG_SIZE_INPUT << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    bool relu = (_act.getActivationType() == Relu);
+
+    if (_precision == PrecisionFloat)
+    {
+        PROFILE_SCOPE_BYTES(ProfileProduct,
+                            sizeof(float) * packedPanelsSize(_w.getRows(), _w.getCols()));
+        gemmPackedBiasAct(_panels.get(), _w.getRows(), _w.getCols(), input, output, relu, pool);
+    }
+    else
+    {
+        PROFILE_SCOPE_BYTES(ProfileProduct, sizeof(uint16_t) * _halfPanels.size());
+        gemmPackedHalfBiasAct(_halfPanels.data(),
+                              (_precision == PrecisionHalf) ? HalfIeee : HalfBfloat16,
+                              _w.getRows(), _w.getCols(), input, output, relu, pool);
+    }
+
+    if (!relu && softmax)
+    {
+        _act.apply(output);
+    }
+}
+
+/**
+ * @brief like forward, but with a separate pass for the product, the bias and the
+ *        activation. kept to validate the fused kernel against
+ * @param input - the input array, the cols of the weights matrix times cols floats
+ * @param cols - the number of cols in the input, one per image
+ * @param output - the output array, the rows of the weights matrix times cols floats
+ * @param pool - the thread pool, or nullptr to run on the calling thread
+ */
+void Dense::forwardUnfused(const float* input, int cols, float* output, ThreadPool* pool) const
+{
+    PROFILE_SCOPE(ProfileDense);
+    int rows = _w.getRows();
+    int depth = _w.getCols();
+
+    {
+        PROFILE_SCOPE_BYTES(ProfileProduct, sizeof(float) * rows * depth);
+        if (cols == 1)
+        {
+            gemv(rows, depth, _w.data(), _w.getStride(), input, output, pool);
+        }
+        else
+        {
+            gemm(rows, cols, depth, _w.data(), _w.getStride(), input, cols, output, cols, pool);
+        }
+    }
+    {
+        PROFILE_SCOPE(ProfileBias);
+        simdAddColumnVector(output, _bias.data(), rows, cols);
+    }
+    _act.apply(output, rows, cols);
+}
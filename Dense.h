@@ -1,53 +1,187 @@
-
-//Dense.h
-
-#ifndef CPP_EX1_DENSE_H
-#define CPP_EX1_DENSE_H
-
-#include "Activation.h"
-
-/**
- * @brief class that represents a dense
- */
-class Dense
-{
-public:
-    /**
-     * @brief constructor for dense
-     * @param w - array of 4 matrices
-     * @param bias - array of 4 matrices
-     * @param actType - activation type
-     */
-    Dense(Matrix& w, Matrix& bias, ActivationType actType);
-
-    /**
-     * @brief return the weights matrix of the dense
-     * @return - the weights matrix
-     */
-    const Matrix& getWeights() const;
-
-    /**
-     * @brief return the bias matrix of the dense
-     * @return - the bias matrix
-     */
-    const Matrix& getBias() const;
-
-    /**
-     * @brief returns the activation
-     * @return - the activation object
-     */
-    Activation getActivation() const;
-
-    /**
-     * @brief performs the activation function on the input
-     * @param matVector - the input matrix
-     * @return - the matrix after the activation function
-     */
-    Matrix operator()(const Matrix& matVector) const;
-private:
-    Matrix _w;           // the matrix of weights
-    Matrix _bias;        // the matrix of bias
-    Activation _act;     // the activation of the dense
-};
-
-#endif //CPP_EX1_DENSE_H
+
+//Dense.h
+
+#ifndef CPP_EX1_DENSE_H
+#define CPP_EX1_DENSE_H
+
+#include "Activation.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @enum WeightPrecision
+ * @brief Indicator of how a dense stores the weights its products read. the half precisions
+ *        stream half the bytes, the weights are widened in the registers and summed in floats.
+ */
+enum WeightPrecision
+{
+    PrecisionFloat,
+    PrecisionHalf,      // ieee half (fp16): 10 bits of mantissa, up to 65504
+    PrecisionBfloat16   // bfloat16: the range of a float with 7 bits of mantissa
+};
+
+/**
+ * @brief class that represents a dense. the weights and the bias are packed into panels once
+ *        (see packPanels in Gemm.h), by the dense or by the slab or model file it runs on, and
+ *        every product reads the panels. the panels are shared: a copy or a replica of the dense
+ *        holds them too, so they live until the last dense that runs on them lets them go
+ */
+class Dense
+{
+public:
+    /**
+     * @brief constructor for dense
+     * @param w - array of 4 matrices
+     * @param bias - array of 4 matrices
+     * @param actType - activation type
+     */
+    Dense(Matrix& w, Matrix& bias, ActivationType actType);
+
+    /**
+     * @brief constructor for dense that takes the matrices without copying them, so a dense
+     *        can run on views into a slab or a mapped model file. with their panels it copies
+     *        nothing, and holds the panels while it runs on them
+     * @param w - the weights matrix, left empty
+     * @param bias - the bias matrix, left empty
+     * @param actType - activation type
+     * @param panels - the weights and the bias packed by packPanels, or nullptr to pack them
+     */
+    Dense(Matrix&& w, Matrix&& bias, ActivationType actType,
+          std::shared_ptr<const float> panels = nullptr);
+
+    /**
+     * @brief return the weights matrix of the dense
+     * @return - the weights matrix
+     */
+    const Matrix& getWeights() const;
+
+    /**
+     * @brief return the bias matrix of the dense
+     * @return - the bias matrix
+     */
+    const Matrix& getBias() const;
+
+    /**
+     * @brief returns the weights and the bias packed into panels, which a replica of the dense
+     *        can run on without packing them again. the replica holds them, so they stay valid
+     *        when this dense switches to a half precision or is destroyed
+     * @return the packedPanelsSize floats of the panels, nullptr in a half precision
+     */
+    std::shared_ptr<const float> getPanels() const;
+
+    /**
+     * @brief gives the dense the panels to run on in the float precision, packed by packPanels
+     *        from its weights and bias. in a half precision they are only read once the dense
+     *        is back in floats, until then the dense holds them
+     * @param panels - the panels, or nullptr to pack its own
+     */
+    void setPanels(std::shared_ptr<const float> panels);
+
+    /**
+     * @brief returns the activation
+     * @return - the activation object
+     */
+    Activation getActivation() const;
+
+    /**
+     * @brief switches the softmax of the dense to the fast exp, or back to std::exp
+     * @param fastExp - true for the fast exp
+     */
+    void setFastExp(bool fastExp);
+
+    /**
+     * @brief sets how the products store the weights. a half precision packs the weights again
+     *        from the float matrix, in 16 bits (the bias stays a float), and lets the float
+     *        panels go (they are freed if no replica holds them); the float precision frees the
+     *        16 bit panels and packs the float ones again, or runs on the given ones. only the
+     *        panels a product streams shrink: the float matrix stays, both are packed from it
+     * @param precision - the precision
+     */
+    void setWeightPrecision(WeightPrecision precision);
+
+    /**
+     * @brief returns how the products store the weights
+     * @return the precision
+     */
+    WeightPrecision getWeightPrecision() const;
+
+    /**
+     * @brief performs the activation function on the input
+     * @param matVector - the input matrix, one column per image
+     * @return - the matrix after the activation function
+     */
+    Matrix operator()(const Matrix& matVector) const;
+
+    /**
+     * @brief performs the activation function on the input, splitting the rows of the
+     *        product between the threads of a pool
+     * @param matVector - the input matrix, one column per image
+     * @param pool - the thread pool, or nullptr to run on the calling thread
+     * @return - the matrix after the activation function
+     */
+    Matrix operator()(const Matrix& matVector, ThreadPool* pool) const;
+
+    /**
+     * @brief performs the activation function on the input into an output matrix, reusing its
+     *        array when it is big enough, so a warm call does not allocate
+     * @param matVector - the input matrix, one column per image
+     * @param output - the matrix to write the result into (not matVector)
+     * @param pool - the thread pool, or nullptr to run on the calling thread
+     * @return - the output matrix
+     */
+    Matrix& forward(const Matrix& matVector, Matrix& output, ThreadPool* pool = nullptr) const;
+
+    /**
+     * @brief performs the activation function on a row-major input array, writing straight
+     *        into a preallocated output array. the product, bias and relu are fused into one
+     *        pass that reads the weights once and writes the output once, softmax then runs
+     *        on the output while it is in the cache
+     * @param input - the input array, the cols of the weights matrix times cols floats
+     * @param cols - the number of cols in the input, one per image
+     * @param output - the output array, the rows of the weights matrix times cols floats
+     * @param pool - the thread pool, or nullptr to run on the calling thread
+     * @param softmax - false to leave the output before softmax (relu is always performed)
+     */
+    void forward(const float* input, int cols, float* output, ThreadPool* pool = nullptr,
+                 bool softmax = true) const;
+
+    /**
+     * @brief like the forward on arrays, on views of any stride: a sub-batch of a bigger batch
+     *        or images inside a buffer are read where they are. prints an error and exits if
+     *        the sizes do not match the weights
+     * @param input - the input, the cols of the weights matrix rows, one column per image
+     * @param output - the output, the rows of the weights matrix rows, as many cols as input
+     * @param pool - the thread pool, or nullptr to run on the calling thread
+     * @param softmax - false to leave the output before softmax (relu is always performed)
+     */
+    void forward(ConstMatrixView input, MatrixView output, ThreadPool* pool = nullptr,
+                 bool softmax = true) const;
+
+    /**
+     * @brief like forward, but with a separate pass for the product, the bias and the
+     *        activation. kept to validate the fused kernel against
+     * @param input - the input array, the cols of the weights matrix times cols floats
+     * @param cols - the number of cols in the input, one per image
+     * @param output - the output array, the rows of the weights matrix times cols floats
+     * @param pool - the thread pool, or nullptr to run on the calling thread
+     */
+    void forwardUnfused(const float* input, int cols, float* output,
+                        ThreadPool* pool = nullptr) const;
+private:
+    /**
+     * @brief runs the dense on given panels, or packs the weights and the bias into its own
+     * @param panels - the packed panels, or nullptr to pack them
+     */
+    void _pack(std::shared_ptr<const float> panels);
+
+    Matrix _w;           // the matrix of weights
+    Matrix _bias;        // the matrix of bias
+    std::shared_ptr<const float> _panels; // the packed weights and bias forward reads
+    std::shared_ptr<const float> _givenPanels; // the panels the dense was given, nullptr if none
+    std::vector<uint16_t> _halfPanels; // the panels in 16 bits, empty in the float precision
+    WeightPrecision _precision;        // the panels forward reads
+    Activation _act;     // the activation of the dense
+};
+
+#endif //CPP_EX1_DENSE_H
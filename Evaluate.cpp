@@ -0,0 +1,74 @@
+/**
+* @file   Evaluate.cpp
+* @brief a program that classifies an MNIST dataset in batches and reports the accuracy against
+ *       its labels, the throughput and the metrics of every stage of the pipeline.
+* @section DESCRIPTION usage: evaluate model images labels [batchSize] [workers]
+ *          the model is a model file (see ModelFile.h), the images and labels are IDX files.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "IdxDataset.h"
+#include "MlpNetwork.h"
+#include "Pipeline.h"
+#include <chrono>
+#include <cstdio>
+
+#define ARGS_COUNT_MIN 4
+#define ARGS_COUNT_MAX 6
+#define MODEL_ARG 1
+#define IMAGES_ARG 2
+#define LABELS_ARG 3
+#define BATCH_ARG 4
+#define WORKERS_ARG 5
+#define DEFAULT_BATCH_SIZE 256
+#define QUEUE_CAPACITY 4
+#define USAGE_MSG "Usage: evaluate model images labels [batchSize] [workers]"
+#define STR_IMAGE_SIZE_ERR "Error: the images do not match the input of the model"
+
+// ------------------------------------------- function declaration -------------------------------
+
+int main(int argc, char* argv[])
+{
+    if ((argc < ARGS_COUNT_MIN) || (argc > ARGS_COUNT_MAX))
+    {
+        std::cerr << USAGE_MSG << std::endl;
+        return EXIT_FAILURE;
+    }
+    int batchSize = (argc > BATCH_ARG) ? std::atoi(argv[BATCH_ARG]) : DEFAULT_BATCH_SIZE;
+    int workers = (argc > WORKERS_ARG) ? std::atoi(argv[WORKERS_ARG]) : 1;
+
+    ModelFile model(argv[MODEL_ARG]);
+    MlpNetwork network(model);
+
+    auto start = std::chrono::steady_clock::now();
+    IdxDataset dataset(argv[IMAGES_ARG], argv[LABELS_ARG], batchSize);
+    if (dataset.getImageSize() != network.getInputSize())
+    {
+        std::cerr << STR_IMAGE_SIZE_ERR << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // the batches are read, classified and counted at the same time. the accuracy needs only
+    // the class of every image, so the workers skip the softmax
+    int correct = 0;
+    Pipeline pipeline(network, workers, QUEUE_CAPACITY, OutputArgmax);
+    pipeline.run([&](IdxBatch& batch)
+    {
+        return dataset.next(batch);
+    }, [&](const IdxBatch& batch, const std::vector<Digit>& digits)
+    {
+        for (int j = 0; j < batch.count; j++)
+        {
+            correct += (digits[j].value == batch.labels[j]);
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                   start).count();
+
+    std::printf("images     %d\n", dataset.getCount());
+    std::printf("accuracy   %.2f%%\n", 100.0 * correct / dataset.getCount());
+    std::printf("throughput %.0f images/s\n", dataset.getCount() / seconds);
+    std::printf("io wait    %.1f%% of the time\n", 100.0 * dataset.getWaitSeconds() / seconds);
+    pipeline.printStats(std::cout);
+    return EXIT_SUCCESS;
+}
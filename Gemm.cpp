@@ -0,0 +1,509 @@
+/**
+* @file   Gemm.cpp
+* @brief a program that implements Gemm.h. multiplies row-major float matrices with a blocked
+ *       algorithm: b is packed into panels that stay in L2, a into panels that stay in L1, and a
+ *       register-tiled simd kernel (simdGemmTile) computes an MR*NR block of the result at a
+ *       time. the weights of a dense are packed into panels once, and the product from panels
+ *       streams them.
+* @section DESCRIPTION a program that implements Gemm.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+
+#include "Gemm.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include <cstring>
+#include <vector>
+
+#define MR GEMM_TILE_ROWS  // rows of the register tile (see simdGemmTile)
+#define NR GEMM_TILE_COLS  // cols of the register tile
+#define MC 128    // rows of a packed into one L1/L2 block
+#define KC 256    // depth of one packed block
+#define NC 2048   // cols of b packed into one L2/L3 block
+#define NARROW_COLS NR  // narrower products are padded to a whole tile, so they run as gemvs
+#define GEMV_GRAIN_ROWS 32          // rows of a in one task of a parallel gemv
+#define PACKED_NC 96                // cols of b one panel multiplies at a time, they stay in L2
+#define PARALLEL_MIN_WORK (1 << 16) // the fewest multiply-adds worth splitting between threads
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief packs an mc*kc block of a into panels of MR rows, each stored column by column,
+ *        the last panel is padded with zeros
+ * @param mc - the number of rows to pack
+ * @param kc - the number of cols to pack
+ * @param a - the first element of the block
+ * @param lda - the distance between two rows of a
+ * @param packed - the destination buffer, at least ceil(mc / MR) * MR * kc floats
+ */
+static void packA(int mc, int kc, const float* a, int lda, float* packed)
+{
+    for (int p = 0; p < mc; p += MR)
+    {
+        int rows = (mc - p < MR) ? (mc - p) : MR;
+        for (int kk = 0; kk < kc; kk++)
+        {
+            for (int r = 0; r < MR; r++)
+            {
+                *packed++ = (r < rows) ? a[(p + r) * lda + kk] : 0.0f;
+            }
+        }
+    }
+}
+
+/**
+ * @brief packs a kc*nc block of b into panels of NR cols, each stored row by row,
+ *        the last panel is padded with zeros
+ * @param kc - the number of rows to pack
+ * @param nc - the number of cols to pack
+ * @param b - the first element of the block
+ * @param ldb - the distance between two rows of b
+ * @param packed - the destination buffer, at least ceil(nc / NR) * NR * kc floats
+ */
+static void packB(int kc, int nc, const float* b, int ldb, float* packed)
+{
+    for (int p = 0; p < nc; p += NR)
+    {
+        int cols = (nc - p < NR) ? (nc - p) : NR;
+        for (int kk = 0; kk < kc; kk++)
+        {
+            const float* row = b + kk * ldb + p;
+            for (int c = 0; c < NR; c++)
+            {
+                *packed++ = (c < cols) ? row[c] : 0.0f;
+            }
+        }
+    }
+}
+
+/**
+ * @brief computes c = act(a * b + bias) on the current thread (see gemmBiasAct)
+ */
+static void gemmSerial(int m, int n, int k, const float* a, int lda, const float* b, int ldb,
+                       float* c, int ldc, const float* bias, bool relu)
+{
+    // the packing buffers are kept per thread so a warm call does not allocate
+    static thread_local std::vector<float> packedA(MC * KC);
+    static thread_local std::vector<float> packedB(NC * KC);
+
+    // Goes over the cols of b in L3 blocks, the depth in L2 blocks and the rows of a in L1 blocks
+    for (int jc = 0; jc < n; jc += NC)
+    {
+        int nc = (n - jc < NC) ? (n - jc) : NC;
+        for (int pc = 0; pc < k; pc += KC)
+        {
+            int kc = (k - pc < KC) ? (k - pc) : KC;
+            bool last = (pc + kc >= k); // the bias and activation go with the last block
+            packB(kc, nc, b + pc * ldb + jc, ldb, packedB.data());
+
+            for (int ic = 0; ic < m; ic += MC)
+            {
+                int mc = (m - ic < MC) ? (m - ic) : MC;
+                packA(mc, kc, a + ic * lda + pc, lda, packedA.data());
+
+                for (int jr = 0; jr < nc; jr += NR)
+                {
+                    int cols = (nc - jr < NR) ? (nc - jr) : NR;
+                    for (int ir = 0; ir < mc; ir += MR)
+                    {
+                        int rows = (mc - ir < MR) ? (mc - ir) : MR;
+                        const float* tileBias = (last && (bias != nullptr)) ? bias + ic + ir
+                                                                            : nullptr;
+                        simdGemmTile(kc, packedA.data() + ir * kc, packedB.data() + jr * kc,
+                                     c + (ic + ir) * ldc + jc + jr, ldc, rows, cols, pc > 0,
+                                     tileBias, last && relu);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief computes c = act(a * b + bias) for a b with fewer cols than a register tile (a small
+ *        batch) with one simd gemv per col, the tiled kernel would pad b to NR cols
+ *        (see gemmBiasAct)
+ */
+static void gemmNarrow(int m, int n, int k, const float* a, int lda, const float* b, int ldb,
+                       float* c, int ldc, const float* bias, bool relu, ThreadPool* pool)
+{
+    static thread_local std::vector<float> x;
+    static thread_local std::vector<float> y;
+    x.resize(k);
+    y.resize(m);
+
+    // Goes over the cols of b, every col is copied out, multiplied and copied into c
+    for (int j = 0; j < n; j++)
+    {
+        for (int kk = 0; kk < k; kk++)
+        {
+            x[kk] = b[kk * ldb + j];
+        }
+        gemvBiasAct(m, k, a, lda, x.data(), bias, relu, y.data(), pool);
+        for (int i = 0; i < m; i++)
+        {
+            c[i * ldc + j] = y[i];
+        }
+    }
+}
+
+/**
+ * @brief computes c = a * b for row-major float matrices, using a cache-blocked,
+ *        register-tiled kernel (a is m*k, b is k*n, c is m*n)
+ * @param m - the number of rows of a and c
+ * @param n - the number of cols of b and c
+ * @param k - the number of cols of a and rows of b
+ * @param a - the left matrix
+ * @param lda - the distance between two rows of a
+ * @param b - the right matrix
+ * @param ldb - the distance between two rows of b
+ * @param c - the result matrix, overwritten
+ * @param ldc - the distance between two rows of c
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemm(int m, int n, int k, const float* a, int lda, const float* b, int ldb,
+          float* c, int ldc, ThreadPool* pool)
+{
+    gemmBiasAct(m, n, k, a, lda, b, ldb, c, ldc, nullptr, false, pool);
+}
+
+/**
+ * @brief computes c = act(a * b + bias) in one pass over c: the bias (one value per row) and
+ *        relu are applied to every tile of c before it is stored
+ * @param m - the number of rows of a and c
+ * @param n - the number of cols of b and c
+ * @param k - the number of cols of a and rows of b
+ * @param a - the left matrix
+ * @param lda - the distance between two rows of a
+ * @param b - the right matrix
+ * @param ldb - the distance between two rows of b
+ * @param c - the result matrix, overwritten
+ * @param ldc - the distance between two rows of c
+ * @param bias - the bias vector (m floats), or nullptr for none
+ * @param relu - true to perform relu on the result
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemmBiasAct(int m, int n, int k, const float* a, int lda, const float* b, int ldb,
+                 float* c, int ldc, const float* bias, bool relu, ThreadPool* pool)
+{
+    if (n < NARROW_COLS)
+    {
+        gemmNarrow(m, n, k, a, lda, b, ldb, c, ldc, bias, relu, pool);
+        return;
+    }
+    if ((pool == nullptr) || ((long)m * n * k < PARALLEL_MIN_WORK))
+    {
+        gemmSerial(m, n, k, a, lda, b, ldb, c, ldc, bias, relu);
+        return;
+    }
+
+    // every task computes whole rows of c, so the tasks never write to the same cells
+    int grain = (m + pool->getNumThreads() - 1) / pool->getNumThreads();
+    grain = ((grain + MR - 1) / MR) * MR;
+    pool->parallelFor(0, m, grain, [=](int from, int to)
+    {
+        gemmSerial(to - from, n, k, a + from * lda, lda, b, ldb, c + from * ldc, ldc,
+                   (bias == nullptr) ? nullptr : bias + from, relu);
+    });
+}
+
+/**
+ * @brief computes c = a * b on views of any stride, like gemm (a is m*k, b is k*n, c is m*n)
+ * @param a - the left matrix
+ * @param b - the right matrix
+ * @param c - the result matrix, overwritten
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemm(ConstMatrixView a, ConstMatrixView b, MatrixView c, ThreadPool* pool)
+{
+    gemmBiasAct(a, b, c, nullptr, false, pool);
+}
+
+/**
+ * @brief computes c = act(a * b + bias) on views of any stride, like gemmBiasAct (a is m*k,
+ *        b is k*n, c is m*n). one contiguous col of b and c runs as a gemv
+ * @param a - the left matrix
+ * @param b - the right matrix
+ * @param c - the result matrix, overwritten
+ * @param bias - the bias vector (m floats), or nullptr for none
+ * @param relu - true to perform relu on the result
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemmBiasAct(ConstMatrixView a, ConstMatrixView b, MatrixView c, const float* bias,
+                 bool relu, ThreadPool* pool)
+{
+    // a col with a stride of 1 is a contiguous vector
+    if ((b.getCols() == 1) && (b.getStride() == 1) && (c.getStride() == 1))
+    {
+        gemvBiasAct(a.getRows(), a.getCols(), a.data(), a.getStride(), b.data(), bias, relu,
+                    c.data(), pool);
+        return;
+    }
+    gemmBiasAct(a.getRows(), b.getCols(), a.getCols(), a.data(), a.getStride(), b.data(),
+                b.getStride(), c.data(), c.getStride(), bias, relu, pool);
+}
+
+/**
+ * @brief computes y = a * x for a row-major float matrix and a contiguous vector,
+ *        with the simd kernel of the current instruction set
+ * @param m - the number of rows of a and the size of y
+ * @param k - the number of cols of a and the size of x
+ * @param a - the matrix
+ * @param lda - the distance between two rows of a
+ * @param x - the input vector
+ * @param y - the result vector, overwritten
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemv(int m, int k, const float* a, int lda, const float* x, float* y, ThreadPool* pool)
+{
+    gemvBiasAct(m, k, a, lda, x, nullptr, false, y, pool);
+}
+
+/**
+ * @brief computes y = act(a * x + bias) in one pass over y, with the simd kernel of the current
+ *        instruction set
+ * @param m - the number of rows of a and the size of y
+ * @param k - the number of cols of a and the size of x
+ * @param a - the matrix
+ * @param lda - the distance between two rows of a
+ * @param x - the input vector
+ * @param bias - the bias vector (m floats), or nullptr for none
+ * @param relu - true to perform relu on the result
+ * @param y - the result vector, overwritten
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemvBiasAct(int m, int k, const float* a, int lda, const float* x, const float* bias,
+                 bool relu, float* y, ThreadPool* pool)
+{
+    if ((pool == nullptr) || ((long)m * k < PARALLEL_MIN_WORK))
+    {
+        simdGemvBiasAct(m, k, a, lda, x, bias, relu, y);
+        return;
+    }
+
+    pool->parallelFor(0, m, GEMV_GRAIN_ROWS, [=](int from, int to)
+    {
+        simdGemvBiasAct(to - from, k, a + from * lda, lda, x,
+                        (bias == nullptr) ? nullptr : bias + from, relu, y + from);
+    });
+}
+
+/**
+ * @brief computes a tile from a float panel with simdPanelTile
+ */
+static inline void panelTile(int k, const float* panel, HalfFormat format, const float* b,
+                             int ldb, int cols, float* tile)
+{
+    (void)format;
+    simdPanelTile(k, panel, b, ldb, cols, tile);
+}
+
+/**
+ * @brief computes a tile from a 16 bit panel with simdPanelTileHalf
+ */
+static inline void panelTile(int k, const uint16_t* panel, HalfFormat format, const float* b,
+                             int ldb, int cols, float* tile)
+{
+    simdPanelTileHalf(k, panel, format, b, ldb, cols, tile);
+}
+
+/**
+ * @brief returns the number of elements of one packed panel: the bias takes PANEL_ROWS floats
+ * @tparam T - float, or uint16_t for 16 bit panels
+ * @param k - the number of cols of the matrix
+ * @return the number of elements
+ */
+template <typename T>
+static inline long panelSize(int k)
+{
+    return (long)PANEL_ROWS * (k + (long)(sizeof(float) / sizeof(T)));
+}
+
+/**
+ * @brief computes c = act(a * b + bias) from packed panels on the current thread
+ *        (see gemmPackedBiasAct)
+ */
+template <typename T>
+static void gemmPackedSerial(const T* panels, HalfFormat format, int m, int k, ConstMatrixView b,
+                             MatrixView c, bool relu)
+{
+    float tile[PANEL_ROWS * PANEL_TILE_COLS];
+    int n = b.getCols();
+
+    // Goes over the cols of b in L2 blocks, every panel is multiplied by the whole block a tile
+    // at a time, and the tile is stored into the rows of c
+    for (int jc = 0; jc < n; jc += PACKED_NC)
+    {
+        int nc = (n - jc < PACKED_NC) ? (n - jc) : PACKED_NC;
+        for (int ic = 0; ic < m; ic += PANEL_ROWS)
+        {
+            const T* panel = panels + (ic / PANEL_ROWS) * panelSize<T>(k);
+            int rows = (m - ic < PANEL_ROWS) ? (m - ic) : PANEL_ROWS;
+            for (int jr = jc; jr < jc + nc; jr += PANEL_TILE_COLS)
+            {
+                int cols = (jc + nc - jr < PANEL_TILE_COLS) ? (jc + nc - jr) : PANEL_TILE_COLS;
+                panelTile(k, panel, format, b.data() + jr, b.getStride(), cols, tile);
+                for (int r = 0; r < rows; r++)
+                {
+                    float* out = c.row(ic + r) + jr;
+                    for (int j = 0; j < cols; j++)
+                    {
+                        float value = tile[j * PANEL_ROWS + r];
+                        out[j] = (relu && (value < 0)) ? 0 : value;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief computes c = act(a * b + bias) from packed panels, splitting the panels between the
+ *        threads of a pool (see gemmPackedBiasAct)
+ */
+template <typename T>
+static void gemmPacked(const T* panels, HalfFormat format, int m, int k, ConstMatrixView b,
+                       MatrixView c, bool relu, ThreadPool* pool)
+{
+    if ((pool == nullptr) || ((long)m * b.getCols() * k < PARALLEL_MIN_WORK))
+    {
+        gemmPackedSerial(panels, format, m, k, b, c, relu);
+        return;
+    }
+
+    // every task computes the rows of whole panels, so the tasks never write to the same cells
+    int panelCount = (m + PANEL_ROWS - 1) / PANEL_ROWS;
+    int grain = (panelCount + pool->getNumThreads() - 1) / pool->getNumThreads();
+    pool->parallelFor(0, panelCount, grain, [=](int from, int to)
+    {
+        int first = from * PANEL_ROWS;
+        int rows = ((to * PANEL_ROWS < m) ? (to * PANEL_ROWS) : m) - first;
+        gemmPackedSerial(panels + from * panelSize<T>(k), format, rows, k, b,
+                         c.rowRange(first, rows), relu);
+    });
+}
+
+/**
+ * @brief packs one panel of a matrix and its bias (see packPanels)
+ * @param a - the matrix
+ * @param bias - the bias vector, or nullptr for none
+ * @param first - the first row of the panel
+ * @param panel - the destination, panelSize<float>(k) floats
+ */
+static void packPanel(ConstMatrixView a, const float* bias, int first, float* panel)
+{
+    int rows = (a.getRows() - first < PANEL_ROWS) ? (a.getRows() - first) : PANEL_ROWS;
+    for (int r = 0; r < PANEL_ROWS; r++)
+    {
+        *panel++ = ((r < rows) && (bias != nullptr)) ? bias[first + r] : 0.0f;
+    }
+    for (int kk = 0; kk < a.getCols(); kk++)
+    {
+        for (int r = 0; r < PANEL_ROWS; r++)
+        {
+            *panel++ = (r < rows) ? a(first + r, kk) : 0.0f;
+        }
+    }
+}
+
+/**
+ * @brief returns the number of floats of the packed panels of an m*k matrix (see packPanels)
+ * @param m - the number of rows of the matrix
+ * @param k - the number of cols of the matrix
+ * @return the number of floats
+ */
+long packedPanelsSize(int m, int k)
+{
+    return (m + PANEL_ROWS - 1) / PANEL_ROWS * panelSize<float>(k);
+}
+
+/**
+ * @brief packs a row-major matrix and its bias into the panels the product from panels reads:
+ *        every panel holds PANEL_ROWS rows (see SimdKernels.h), first their bias and then the
+ *        rows column by column, so a product streams the weights from start to end, one vector
+ *        a step. the last panel is padded with zeros. packed once when the weights are loaded
+ * @param a - the matrix (m*k)
+ * @param bias - the bias vector (m floats), or nullptr for none
+ * @param panels - the destination buffer, packedPanelsSize(m, k) floats
+ */
+void packPanels(ConstMatrixView a, const float* bias, float* panels)
+{
+    for (int p = 0; p < a.getRows(); p += PANEL_ROWS)
+    {
+        packPanel(a, bias, p, panels);
+        panels += panelSize<float>(a.getCols());
+    }
+}
+
+/**
+ * @brief computes c = act(a * b + bias) from the packed panels of a and of its bias (see
+ *        packPanels), like gemmBiasAct (a is m*k, b is k*n, c is m*n). one col of b runs the
+ *        same kernel as a batch, so a gemv reads the panels with no horizontal sums
+ * @param panels - the packed panels of a and the bias
+ * @param m - the number of rows of a and c
+ * @param k - the number of cols of a and rows of b
+ * @param b - the right matrix
+ * @param c - the result matrix, overwritten
+ * @param relu - true to perform relu on the result
+ * @param pool - a thread pool to split the panels between, or nullptr to run on this thread
+ */
+void gemmPackedBiasAct(const float* panels, int m, int k, ConstMatrixView b, MatrixView c,
+                       bool relu, ThreadPool* pool)
+{
+    // the format is read only from 16 bit panels
+    gemmPacked(panels, HalfIeee, m, k, b, c, relu, pool);
+}
+
+/**
+ * @brief returns the number of 16 bit slots of the packed half panels of an m*k matrix (see
+ *        packHalfPanels)
+ * @param m - the number of rows of the matrix
+ * @param k - the number of cols of the matrix
+ * @return the number of slots
+ */
+long packedHalfPanelsSize(int m, int k)
+{
+    return (m + PANEL_ROWS - 1) / PANEL_ROWS * panelSize<uint16_t>(k);
+}
+
+/**
+ * @brief packs a row-major matrix and its bias into panels like packPanels, with the weights in
+ *        a 16 bit format (half the bytes to stream). the bias stays floats, in the first
+ *        PANEL_HALF_BIAS slots of every panel
+ * @param a - the matrix (m*k)
+ * @param bias - the bias vector (m floats), or nullptr for none
+ * @param format - the format of the weights
+ * @param panels - the destination buffer, packedHalfPanelsSize(m, k) slots
+ */
+void packHalfPanels(ConstMatrixView a, const float* bias, HalfFormat format, uint16_t* panels)
+{
+    // every panel is packed in floats first, then its weights are converted
+    std::vector<float> panel(panelSize<float>(a.getCols()));
+    for (int p = 0; p < a.getRows(); p += PANEL_ROWS)
+    {
+        packPanel(a, bias, p, panel.data());
+        std::memcpy(panels, panel.data(), sizeof(float) * PANEL_ROWS);
+        simdFloatToHalf(panel.data() + PANEL_ROWS, panels + PANEL_HALF_BIAS,
+                        PANEL_ROWS * a.getCols(), format);
+        panels += panelSize<uint16_t>(a.getCols());
+    }
+}
+
+/**
+ * @brief computes c = act(a * b + bias) from the packed half panels of a (see packHalfPanels),
+ *        like gemmPackedBiasAct: the weights are widened in the registers and summed in floats
+ * @param panels - the packed half panels of a and the bias
+ * @param format - the format of the weights
+ * @param m - the number of rows of a and c
+ * @param k - the number of cols of a and rows of b
+ * @param b - the right matrix
+ * @param c - the result matrix, overwritten
+ * @param relu - true to perform relu on the result
+ * @param pool - a thread pool to split the panels between, or nullptr to run on this thread
+ */
+void gemmPackedHalfBiasAct(const uint16_t* panels, HalfFormat format, int m, int k,
+                           ConstMatrixView b, MatrixView c, bool relu, ThreadPool* pool)
+{
+    gemmPacked(panels, format, m, k, b, c, relu, pool);
+}
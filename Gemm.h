@@ -0,0 +1,168 @@
+
+//Gemm.h
+
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "MatrixView.h"
+#include "SimdKernels.h"
+
+class ThreadPool;
+
+/**
+ * @brief computes c = a * b for row-major float matrices, using a cache-blocked,
+ *        register-tiled kernel (a is m*k, b is k*n, c is m*n)
+ * @param m - the number of rows of a and c
+ * @param n - the number of cols of b and c
+ * @param k - the number of cols of a and rows of b
+ * @param a - the left matrix
+ * @param lda - the distance between two rows of a
+ * @param b - the right matrix
+ * @param ldb - the distance between two rows of b
+ * @param c - the result matrix, overwritten
+ * @param ldc - the distance between two rows of c
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemm(int m, int n, int k, const float* a, int lda, const float* b, int ldb,
+          float* c, int ldc, ThreadPool* pool = nullptr);
+
+/**
+ * @brief computes c = act(a * b + bias) in one pass over c: the bias (one value per row) and
+ *        relu are applied to every tile of c before it is stored
+ * @param m - the number of rows of a and c
+ * @param n - the number of cols of b and c
+ * @param k - the number of cols of a and rows of b
+ * @param a - the left matrix
+ * @param lda - the distance between two rows of a
+ * @param b - the right matrix
+ * @param ldb - the distance between two rows of b
+ * @param c - the result matrix, overwritten
+ * @param ldc - the distance between two rows of c
+ * @param bias - the bias vector (m floats), or nullptr for none
+ * @param relu - true to perform relu on the result
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemmBiasAct(int m, int n, int k, const float* a, int lda, const float* b, int ldb,
+                 float* c, int ldc, const float* bias, bool relu, ThreadPool* pool = nullptr);
+
+/**
+ * @brief computes c = a * b on views of any stride, like gemm (a is m*k, b is k*n, c is m*n)
+ * @param a - the left matrix
+ * @param b - the right matrix
+ * @param c - the result matrix, overwritten
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemm(ConstMatrixView a, ConstMatrixView b, MatrixView c, ThreadPool* pool = nullptr);
+
+/**
+ * @brief computes c = act(a * b + bias) on views of any stride, like gemmBiasAct (a is m*k,
+ *        b is k*n, c is m*n). one contiguous col of b and c runs as a gemv
+ * @param a - the left matrix
+ * @param b - the right matrix
+ * @param c - the result matrix, overwritten
+ * @param bias - the bias vector (m floats), or nullptr for none
+ * @param relu - true to perform relu on the result
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemmBiasAct(ConstMatrixView a, ConstMatrixView b, MatrixView c, const float* bias,
+                 bool relu, ThreadPool* pool = nullptr);
+
+/**
+ * @brief computes y = a * x for a row-major float matrix and a contiguous vector
+ * @param m - the number of rows of a and the size of y
+ * @param k - the number of cols of a and the size of x
+ * @param a - the matrix
+ * @param lda - the distance between two rows of a
+ * @param x - the input vector
+ * @param y - the result vector, overwritten
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemv(int m, int k, const float* a, int lda, const float* x, float* y,
+          ThreadPool* pool = nullptr);
+
+/**
+ * @brief computes y = act(a * x + bias) in one pass over y, with the simd kernel of the current
+ *        instruction set
+ * @param m - the number of rows of a and the size of y
+ * @param k - the number of cols of a and the size of x
+ * @param a - the matrix
+ * @param lda - the distance between two rows of a
+ * @param x - the input vector
+ * @param bias - the bias vector (m floats), or nullptr for none
+ * @param relu - true to perform relu on the result
+ * @param y - the result vector, overwritten
+ * @param pool - a thread pool to split the rows of a between, or nullptr to run on this thread
+ */
+void gemvBiasAct(int m, int k, const float* a, int lda, const float* x, const float* bias,
+                 bool relu, float* y, ThreadPool* pool = nullptr);
+
+/**
+ * @brief returns the number of floats of the packed panels of an m*k matrix (see packPanels)
+ * @param m - the number of rows of the matrix
+ * @param k - the number of cols of the matrix
+ * @return the number of floats
+ */
+long packedPanelsSize(int m, int k);
+
+/**
+ * @brief packs a row-major matrix and its bias into the panels the product from panels reads:
+ *        every panel holds PANEL_ROWS rows (see SimdKernels.h), first their bias and then the
+ *        rows column by column, so a product streams the weights from start to end, one vector
+ *        a step. the last panel is padded with zeros. packed once when the weights are loaded
+ * @param a - the matrix (m*k)
+ * @param bias - the bias vector (m floats), or nullptr for none
+ * @param panels - the destination buffer, packedPanelsSize(m, k) floats
+ */
+void packPanels(ConstMatrixView a, const float* bias, float* panels);
+
+/**
+ * @brief computes c = act(a * b + bias) from the packed panels of a and of its bias (see
+ *        packPanels), like gemmBiasAct (a is m*k, b is k*n, c is m*n). one col of b runs the
+ *        same kernel as a batch, so a gemv reads the panels with no horizontal sums
+ * @param panels - the packed panels of a and the bias
+ * @param m - the number of rows of a and c
+ * @param k - the number of cols of a and rows of b
+ * @param b - the right matrix
+ * @param c - the result matrix, overwritten
+ * @param relu - true to perform relu on the result
+ * @param pool - a thread pool to split the panels between, or nullptr to run on this thread
+ */
+void gemmPackedBiasAct(const float* panels, int m, int k, ConstMatrixView b, MatrixView c,
+                       bool relu, ThreadPool* pool = nullptr);
+
+/**
+ * @brief returns the number of 16 bit slots of the packed half panels of an m*k matrix (see
+ *        packHalfPanels)
+ * @param m - the number of rows of the matrix
+ * @param k - the number of cols of the matrix
+ * @return the number of slots
+ */
+long packedHalfPanelsSize(int m, int k);
+
+/**
+ * @brief packs a row-major matrix and its bias into panels like packPanels, with the weights in
+ *        a 16 bit format (half the bytes to stream). the bias stays floats, in the first
+ *        PANEL_HALF_BIAS slots of every panel
+ * @param a - the matrix (m*k)
+ * @param bias - the bias vector (m floats), or nullptr for none
+ * @param format - the format of the weights
+ * @param panels - the destination buffer, packedHalfPanelsSize(m, k) slots
+ */
+void packHalfPanels(ConstMatrixView a, const float* bias, HalfFormat format, uint16_t* panels);
+
+/**
+ * @brief computes c = act(a * b + bias) from the packed half panels of a (see packHalfPanels),
+ *        like gemmPackedBiasAct: the weights are widened in the registers and summed in floats
+ * @param panels - the packed half panels of a and the bias
+ * @param format - the format of the weights
+ * @param m - the number of rows of a and c
+ * @param k - the number of cols of a and rows of b
+ * @param b - the right matrix
+ * @param c - the result matrix, overwritten
+ * @param relu - true to perform relu on the result
+ * @param pool - a thread pool to split the panels between, or nullptr to run on this thread
+ */
+void gemmPackedHalfBiasAct(const uint16_t* panels, HalfFormat format, int m, int k,
+                           ConstMatrixView b, MatrixView c, bool relu, ThreadPool* pool = nullptr);
+
+#endif //GEMM_H
@@ -0,0 +1,213 @@
+/**
+* @file   IdxDataset.cpp
+* @brief a program that implements IdxDataset.h. streams an MNIST dataset in batches
+* @section DESCRIPTION a program that implements IdxDataset.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "IdxDataset.h"
+#include <chrono>
+#include <utility>
+
+#define IDX_IMAGES_MAGIC 0x00000803 // unsigned bytes, 3 dimensions
+#define IDX_LABELS_MAGIC 0x00000801 // unsigned bytes, 1 dimension
+#define PIXEL_MAX_VALUE 255.0f
+#define STR_INVALID_IDX_ERR   "Error: invalid IDX file "
+#define STR_IDX_MISMATCH_ERR  "Error: the images and labels files have different counts"
+#define STR_INVALID_BATCH_ERR "Error: the batch size must be positive"
+#define STR_READ_IDX_ERR      "Error: cannot read the IDX files"
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief prints an error about an IDX file and exits
+ * @param path - the path of the file
+ */
+static void idxError(const std::string& path)
+{
+    std::cerr << STR_INVALID_IDX_ERR << path << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief opens the files, checks their headers and starts the prefetch thread.
+ *        prints an error and exits if the files are not a matching pair of IDX files
+ * @param imagesPath - the path of the images file
+ * @param labelsPath - the path of the labels file
+ * @param batchSize - the number of images in a batch (the last one may have fewer)
+ */
+IdxDataset::IdxDataset(const std::string& imagesPath, const std::string& labelsPath,
+                       int batchSize): _images(imagesPath, BigEndian),
+                                       _labels(labelsPath, BigEndian), _count(0), _imageSize(0),
+                                       _batchSize(batchSize), _hasReady(false), _finished(false),
+                                       _stop(false), _waitSeconds(0)
+{
+    if (batchSize <= 0)
+    {
+        std::cerr << STR_INVALID_BATCH_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // the headers are big endian: the magic number, then the size of every dimension
+    int32_t magic = 0, count = 0, rows = 0, cols = 0;
+    if (!_images.readInt32(magic) || (magic != IDX_IMAGES_MAGIC) || !_images.readInt32(count) ||
+        !_images.readInt32(rows) || !_images.readInt32(cols) || (count <= 0) || (rows <= 0) ||
+        (cols <= 0) || (_images.getRemaining() != (long)count * rows * cols))
+    {
+        idxError(imagesPath);
+    }
+    _count = count;
+    _imageSize = rows * cols;
+
+    if (!_labels.readInt32(magic) || (magic != IDX_LABELS_MAGIC) || !_labels.readInt32(count) ||
+        (_labels.getRemaining() != count))
+    {
+        idxError(labelsPath);
+    }
+    if (count != _count)
+    {
+        std::cerr << STR_IDX_MISMATCH_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    _thread = std::thread(&IdxDataset::_prefetch, this);
+}
+
+/**
+ * @brief destructor for idx dataset, stops the prefetch thread
+ */
+IdxDataset::~IdxDataset()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stop = true;
+    }
+    _changed.notify_all();
+    _thread.join();
+}
+
+/**
+ * @brief returns the number of images in the dataset
+ * @return the number of images
+ */
+int IdxDataset::getCount() const
+{
+    return _count;
+}
+
+/**
+ * @brief returns the number of pixels in every image
+ * @return the number of pixels
+ */
+int IdxDataset::getImageSize() const
+{
+    return _imageSize;
+}
+
+/**
+ * @brief takes the next batch, waiting for the prefetch thread if it is not ready yet.
+ *        the arrays of the batch given are handed to the prefetch thread to fill again, so
+ *        a steady stream of batches does not allocate
+ * @param batch - the batch to swap the next batch into
+ * @return true if there was a batch, false at the end of the dataset
+ */
+bool IdxDataset::next(IdxBatch& batch)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> guard(_lock);
+    _changed.wait(guard, [this]()
+    {
+        return _hasReady || _finished;
+    });
+    auto end = std::chrono::steady_clock::now();
+    _waitSeconds += std::chrono::duration<double>(end - start).count();
+
+    if (!_hasReady)
+    {
+        return false;
+    }
+    std::swap(batch, _ready);
+    _hasReady = false;
+    guard.unlock();
+    _changed.notify_all();
+    return true;
+}
+
+/**
+ * @brief returns the total time next waited for the prefetch thread
+ * @return the time in seconds
+ */
+double IdxDataset::getWaitSeconds() const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _waitSeconds;
+}
+
+/**
+ * @brief the loop of the prefetch thread: reads a batch, waits until the previous one was
+ *        taken and hands it over, until the end of the dataset
+ */
+void IdxDataset::_prefetch()
+{
+    IdxBatch work;
+    int left = _count;
+
+    while (left > 0)
+    {
+        int count = (left < _batchSize) ? left : _batchSize;
+        _readBatch(work, count);
+        left -= count;
+
+        std::unique_lock<std::mutex> guard(_lock);
+        _changed.wait(guard, [this]()
+        {
+            return !_hasReady || _stop;
+        });
+        if (_stop)
+        {
+            return;
+        }
+        std::swap(work, _ready);
+        _hasReady = true;
+        guard.unlock();
+        _changed.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _finished = true;
+    }
+    _changed.notify_all();
+}
+
+/**
+ * @brief reads the next images and labels into a batch, with one read for each file, and
+ *        turns every image into a column of floats in [0, 1]
+ * @param batch - the batch to fill
+ * @param count - the number of images
+ */
+void IdxDataset::_readBatch(IdxBatch& batch, int count)
+{
+    _raw.resize((size_t)count * _imageSize);
+    batch.labels.resize(count);
+    batch.images.resize(_imageSize, count);
+    batch.count = count;
+
+    // the sizes were checked against the headers, so a short read is a broken file
+    if (!_images.readBytes(_raw.data(), (long)count * _imageSize) ||
+        !_labels.readBytes(batch.labels.data(), count))
+    {
+        std::cerr << STR_READ_IDX_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const unsigned char* pixels = _raw.data();
+    float* columns = batch.images.data();
+    for (int j = 0; j < count; j++)
+    {
+        for (int i = 0; i < _imageSize; i++)
+        {
+            columns[(long)i * count + j] = pixels[(long)j * _imageSize + i] / PIXEL_MAX_VALUE;
+        }
+    }
+}
@@ -0,0 +1,95 @@
+
+//IdxDataset.h
+
+#ifndef IDXDATASET_H
+#define IDXDATASET_H
+
+#include "BinaryReader.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct IdxBatch
+ * @brief a batch of images and their labels
+ */
+typedef struct IdxBatch
+{
+    Matrix images;                      // imageSize*count, every column is one image
+    std::vector<unsigned char> labels;  // the label of every image
+    int count = 0;                      // the number of images in the batch
+} IdxBatch;
+
+/**
+ * @brief class that streams an MNIST dataset (an IDX file of uint8 images and an IDX file of
+ *        labels) in fixed-size batches. a background thread reads and normalizes the next
+ *        batch while the current one is classified, the pixels become floats in [0, 1]
+ */
+class IdxDataset
+{
+public:
+    /**
+     * @brief opens the files, checks their headers and starts the prefetch thread.
+     *        prints an error and exits if the files are not a matching pair of IDX files
+     * @param imagesPath - the path of the images file
+     * @param labelsPath - the path of the labels file
+     * @param batchSize - the number of images in a batch (the last one may have fewer)
+     */
+    IdxDataset(const std::string& imagesPath, const std::string& labelsPath, int batchSize);
+
+    /**
+     * @brief destructor for idx dataset, stops the prefetch thread
+     */
+    ~IdxDataset();
+
+    IdxDataset(const IdxDataset&) = delete;
+    IdxDataset& operator=(const IdxDataset&) = delete;
+
+    /**
+     * @brief returns the number of images in the dataset
+     * @return the number of images
+     */
+    int getCount() const;
+
+    /**
+     * @brief returns the number of pixels in every image
+     * @return the number of pixels
+     */
+    int getImageSize() const;
+
+    /**
+     * @brief takes the next batch, waiting for the prefetch thread if it is not ready yet.
+     *        the arrays of the batch given are handed to the prefetch thread to fill again, so
+     *        a steady stream of batches does not allocate
+     * @param batch - the batch to swap the next batch into
+     * @return true if there was a batch, false at the end of the dataset
+     */
+    bool next(IdxBatch& batch);
+
+    /**
+     * @brief returns the total time next waited for the prefetch thread
+     * @return the time in seconds
+     */
+    double getWaitSeconds() const;
+
+private:
+    void _prefetch();
+    void _readBatch(IdxBatch& batch, int count);
+    BinaryReader _images;             // the images file, after the header
+    BinaryReader _labels;             // the labels file, after the header
+    int _count;                       // the number of images
+    int _imageSize;                   // the number of pixels in every image
+    int _batchSize;                   // the number of images in a batch
+    std::vector<unsigned char> _raw;  // the pixels of a batch as read, before normalizing
+    IdxBatch _ready;                  // the batch that waits for next
+    bool _hasReady;                   // true if _ready holds a batch
+    bool _finished;                   // true when the prefetch thread read the last batch
+    bool _stop;                       // true to stop the prefetch thread
+    double _waitSeconds;              // the time next waited
+    mutable std::mutex _lock;         // guards _ready, the flags and _waitSeconds
+    std::condition_variable _changed; // signaled when a flag changes
+    std::thread _thread;              // the prefetch thread
+};
+
+#endif //IDXDATASET_H
@@ -0,0 +1,568 @@
+/**
+* @file   InferenceServer.cpp
+* @brief a program that implements InferenceServer.h. serves a network on a Unix domain socket
+ *       with epoll, and collects the requests of all clients into micro-batches.
+* @section DESCRIPTION a program that implements InferenceServer.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "InferenceServer.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define LISTEN_ID 0        // the epoll id of the listening socket
+#define TIMER_ID 1         // the epoll id of the timer
+#define STOP_ID 2          // the epoll id of the eventfd of stop
+#define FIRST_CLIENT_ID 3  // the epoll id of the first client
+#define MAX_EVENTS 64
+#define READ_REQUESTS 16   // the requests one read of a client may take
+#define MICROS_PER_SECOND 1000000L
+#define NANOS_PER_MICRO 1000L
+#define STR_SOCKET_PATH_ERR   "Error: the socket path is too long "
+#define STR_SOCKET_ERR        "Error: cannot listen on socket "
+#define STR_CONNECT_ERR       "Error: cannot connect to socket "
+#define STR_EPOLL_ERR         "Error: cannot set up epoll"
+#define STR_SERVER_ARGS_ERR   "Error: the batch size must be positive, the delay not negative"
+#define STR_SERVER_INPUT_ERR  "Error: the input of the network is not one request"
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief fills the address of a Unix domain socket. prints an error and exits if the path
+ *        does not fit
+ * @param path - the path of the socket
+ * @param address - the address to fill
+ */
+static void socketAddress(const std::string& path, sockaddr_un& address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << STR_SOCKET_PATH_ERR << path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+}
+
+/**
+ * @brief adds a file to an epoll instance, or changes the events it waits for
+ * @param epollFd - the epoll instance
+ * @param op - EPOLL_CTL_ADD or EPOLL_CTL_MOD
+ * @param fd - the file
+ * @param events - the events to wait for
+ * @param id - the id the events of the file come with
+ */
+static void epollControl(int epollFd, int op, int fd, uint32_t events, uint64_t id)
+{
+    epoll_event event;
+    event.events = events;
+    event.data.u64 = id;
+    if (epoll_ctl(epollFd, op, fd, &event) < 0)
+    {
+        std::cerr << STR_EPOLL_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief creates the socket and starts listening. prints an error and exits on failure
+ * @param network - the network (not owned), its input must be SERVER_REQUEST_FLOATS
+ * @param socketPath - the path of the socket, an old socket at the path is removed
+ * @param maxBatch - the largest batch, a batch that fills up runs right away
+ * @param maxDelayMicros - the latency budget, the longest a request waits for a batch
+ */
+InferenceServer::InferenceServer(MlpNetwork& network, const std::string& socketPath,
+                                 int maxBatch, int maxDelayMicros):
+                 _network(network), _socketPath(socketPath), _maxBatch(maxBatch),
+                 _maxDelayMicros(maxDelayMicros), _nextId(FIRST_CLIENT_ID)
+{
+    if ((maxBatch <= 0) || (maxDelayMicros < 0))
+    {
+        std::cerr << STR_SERVER_ARGS_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (network.getInputSize() != SERVER_REQUEST_FLOATS)
+    {
+        std::cerr << STR_SERVER_INPUT_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    _pending.reserve((size_t)maxBatch * SERVER_REQUEST_FLOATS);
+    _pendingIds.reserve(maxBatch);
+
+    sockaddr_un address;
+    socketAddress(socketPath, address);
+    unlink(socketPath.c_str());
+    _listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ((_listenFd < 0) || (bind(_listenFd, (sockaddr*)&address, sizeof(address)) < 0) ||
+        (listen(_listenFd, SOMAXCONN) < 0))
+    {
+        std::cerr << STR_SOCKET_ERR << socketPath << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    _timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    _stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((_epollFd < 0) || (_timerFd < 0) || (_stopFd < 0))
+    {
+        std::cerr << STR_EPOLL_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    epollControl(_epollFd, EPOLL_CTL_ADD, _listenFd, EPOLLIN, LISTEN_ID);
+    epollControl(_epollFd, EPOLL_CTL_ADD, _timerFd, EPOLLIN, TIMER_ID);
+    epollControl(_epollFd, EPOLL_CTL_ADD, _stopFd, EPOLLIN, STOP_ID);
+}
+
+/**
+ * @brief destructor for inference server, closes every client and removes the socket
+ */
+InferenceServer::~InferenceServer()
+{
+    for (auto& entry : _connections)
+    {
+        close(entry.second.fd);
+    }
+    close(_stopFd);
+    close(_timerFd);
+    close(_epollFd);
+    close(_listenFd);
+    unlink(_socketPath.c_str());
+}
+
+/**
+ * @brief serves the clients until stop is called
+ */
+void InferenceServer::run()
+{
+    epoll_event events[MAX_EVENTS];
+    bool stopped = false;
+
+    while (!stopped)
+    {
+        int count = epoll_wait(_epollFd, events, MAX_EVENTS, -1);
+        if ((count < 0) && (errno != EINTR))
+        {
+            std::cerr << STR_EPOLL_ERR << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // Goes over the ready files, a client that closed in this round is skipped by its id
+        for (int i = 0; i < count; i++)
+        {
+            uint64_t id = events[i].data.u64;
+            uint64_t ticks = 0;
+            if (id == LISTEN_ID)
+            {
+                _accept();
+            }
+            else if (id == TIMER_ID)
+            {
+                // a timer disarmed after this round started has no ticks to read
+                if ((read(_timerFd, &ticks, sizeof(ticks)) == sizeof(ticks)) &&
+                    !_pendingIds.empty())
+                {
+                    _runBatch(false);
+                }
+            }
+            else if (id == STOP_ID)
+            {
+                stopped = true;
+            }
+            else if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                _close(id);
+            }
+            else
+            {
+                if (events[i].events & EPOLLOUT)
+                {
+                    _write(id);
+                }
+                if (events[i].events & EPOLLIN)
+                {
+                    _read(id);
+                }
+            }
+        }
+    }
+
+    // the requests already received are answered before returning
+    if (!_pendingIds.empty())
+    {
+        _runBatch(false);
+    }
+}
+
+/**
+ * @brief makes run return. may be called from another thread or from a signal handler
+ */
+void InferenceServer::stop()
+{
+    // write is async-signal-safe, and a stop that cannot be written is already pending
+    uint64_t one = 1;
+    ssize_t written = write(_stopFd, &one, sizeof(one));
+    (void)written;
+}
+
+/**
+ * @brief returns the metrics of the server
+ * @return the metrics
+ */
+const ServerStats& InferenceServer::getStats() const
+{
+    return _stats;
+}
+
+/**
+ * @brief prints the metrics of the server
+ * @param out - the stream to print into
+ */
+void InferenceServer::printStats(std::ostream& out) const
+{
+    char line[256];
+    double meanBatch = (_stats.batches > 0) ? ((double)_stats.requests / _stats.batches) : 0;
+    std::snprintf(line, sizeof(line), "connections %ld\nrequests    %ld\nbatches     %ld "
+                  "(%ld full)\nmean batch  %.1f\nbusy        %.3f s\n", _stats.connections,
+                  _stats.requests, _stats.batches, _stats.fullBatches, meanBatch,
+                  _stats.busySeconds);
+    out << line;
+}
+
+/**
+ * @brief accepts every client waiting on the listening socket
+ */
+void InferenceServer::_accept()
+{
+    while (true)
+    {
+        int fd = accept4(_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return; // EAGAIN when none is left, a client that gave up is not an error
+        }
+        uint64_t id = _nextId++;
+        Connection& connection = _connections[id];
+        connection.fd = fd;
+        connection.in.resize((size_t)READ_REQUESTS * SERVER_REQUEST_BYTES);
+        connection.events = EPOLLIN;
+        epollControl(_epollFd, EPOLL_CTL_ADD, fd, EPOLLIN, id);
+        _stats.connections++;
+    }
+}
+
+/**
+ * @brief reads from a client once (epoll is level triggered, so a client with more to read
+ *        comes back in the next round, after the others) and enqueues its complete requests
+ * @param id - the id of the client
+ */
+void InferenceServer::_read(uint64_t id)
+{
+    auto found = _connections.find(id);
+    if (found == _connections.end())
+    {
+        return;
+    }
+    Connection& connection = found->second;
+    if (!(connection.events & EPOLLIN))
+    {
+        return; // it stopped reading in this round, after epoll returned
+    }
+    ssize_t count = read(connection.fd, connection.in.data() + connection.inSize,
+                         connection.in.size() - connection.inSize);
+    if (count <= 0)
+    {
+        if ((count == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+        {
+            _close(id);
+        }
+        return;
+    }
+    connection.inSize += count;
+
+    // the requests are read in place from the input buffer of the client. a full batch runs
+    // inside _enqueue and may close this client, which frees the buffer, so the client is
+    // looked up again after every request and nothing of it is touched once it is gone
+    size_t requests = connection.inSize / SERVER_REQUEST_BYTES;
+    size_t used = requests * SERVER_REQUEST_BYTES;
+    std::vector<char>& in = connection.in;
+    for (size_t i = 0; i < requests; i++)
+    {
+        _enqueue(id, in.data() + i * SERVER_REQUEST_BYTES);
+        if (_connections.find(id) == _connections.end())
+        {
+            return;
+        }
+    }
+    std::memmove(in.data(), in.data() + used, connection.inSize - used);
+    connection.inSize -= used;
+}
+
+/**
+ * @brief sends the responses a client has not got yet, as far as its socket takes them, and
+ *        waits for EPOLLOUT while some are left
+ * @param id - the id of the client
+ */
+void InferenceServer::_write(uint64_t id)
+{
+    auto found = _connections.find(id);
+    if (found == _connections.end())
+    {
+        return;
+    }
+    Connection& connection = found->second;
+    while (connection.outSent < connection.out.size())
+    {
+        ssize_t count = send(connection.fd, connection.out.data() + connection.outSent,
+                             connection.out.size() - connection.outSent,
+                             MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                _watch(id, connection, true);
+                return;
+            }
+            _close(id);
+            return;
+        }
+        connection.outSent += count;
+    }
+
+    connection.out.clear();
+    connection.outSent = 0;
+    _watch(id, connection, false);
+}
+
+/**
+ * @brief sets the events epoll waits for on a client: EPOLLOUT while its socket is full, and
+ *        EPOLLIN while it has fewer than SERVER_MAX_UNSENT responses waiting, so a client that
+ *        sends requests and never reads the responses cannot make the server grow without
+ *        bound (its requests stay in its socket, and its sends block)
+ * @param id - the id of the client
+ * @param connection - the client
+ * @param blocked - true if its socket took no more responses
+ */
+void InferenceServer::_watch(uint64_t id, Connection& connection, bool blocked)
+{
+    size_t unsent = connection.out.size() - connection.outSent;
+    uint32_t events = 0;
+    if (blocked)
+    {
+        events |= EPOLLOUT;
+    }
+    if (unsent < SERVER_MAX_UNSENT * sizeof(ServerResponse))
+    {
+        events |= EPOLLIN;
+    }
+    if (events != connection.events)
+    {
+        epollControl(_epollFd, EPOLL_CTL_MOD, connection.fd, events, id);
+        connection.events = events;
+    }
+}
+
+/**
+ * @brief closes a client. its requests in the current batch are classified, but dropped
+ * @param id - the id of the client
+ */
+void InferenceServer::_close(uint64_t id)
+{
+    auto found = _connections.find(id);
+    if (found == _connections.end())
+    {
+        return;
+    }
+    close(found->second.fd); // closing removes it from epoll
+    _connections.erase(found);
+}
+
+/**
+ * @brief adds a request to the batch. the first request of a batch starts the timer of the
+ *        latency budget, and a batch that fills up runs right away
+ * @param id - the id of the client
+ * @param request - the request, SERVER_REQUEST_BYTES bytes
+ */
+void InferenceServer::_enqueue(uint64_t id, const char* request)
+{
+    if (_pendingIds.empty())
+    {
+        // a budget of 0 still arms the timer, the batch takes what arrived in the same round
+        _armTimer((_maxDelayMicros > 0) ? _maxDelayMicros : 1);
+    }
+    size_t offset = _pending.size();
+    _pending.resize(offset + SERVER_REQUEST_FLOATS);
+    std::memcpy(_pending.data() + offset, request, SERVER_REQUEST_BYTES);
+    _pendingIds.push_back(id);
+
+    if ((int)_pendingIds.size() >= _maxBatch)
+    {
+        _runBatch(true);
+    }
+}
+
+/**
+ * @brief classifies the batch and sends every response to its client
+ * @param full - true if the batch runs because it is full, false if it timed out
+ */
+void InferenceServer::_runBatch(bool full)
+{
+    _armTimer(0);
+    auto start = std::chrono::steady_clock::now();
+
+    // the requests come one image after another, the network wants an image in every column
+    int count = (int)_pendingIds.size();
+    _batch.resize(SERVER_REQUEST_FLOATS, count);
+    float* columns = _batch.data();
+    for (int j = 0; j < count; j++)
+    {
+        const float* image = _pending.data() + (size_t)j * SERVER_REQUEST_FLOATS;
+        for (int i = 0; i < SERVER_REQUEST_FLOATS; i++)
+        {
+            columns[(long)i * count + j] = image[i];
+        }
+    }
+    std::vector<Digit> digits = _network.classifyBatch(_batch);
+
+    // Goes over the responses, a client's responses are added in the order of its requests
+    for (int j = 0; j < count; j++)
+    {
+        auto found = _connections.find(_pendingIds[j]);
+        if (found != _connections.end())
+        {
+            ServerResponse response = {digits[j].value, digits[j].probability};
+            const char* bytes = (const char*)&response;
+            found->second.out.insert(found->second.out.end(), bytes, bytes + sizeof(response));
+        }
+    }
+    for (int j = 0; j < count; j++)
+    {
+        if ((j == 0) || (_pendingIds[j] != _pendingIds[j - 1]))
+        {
+            _write(_pendingIds[j]);
+        }
+    }
+
+    _stats.requests += count;
+    _stats.batches++;
+    _stats.fullBatches += full;
+    _stats.busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                        start).count();
+    _pending.clear();
+    _pendingIds.clear();
+}
+
+/**
+ * @brief arms the timer to fire once, or disarms it (which also drops a tick not read yet)
+ * @param micros - the time until it fires, 0 to disarm
+ */
+void InferenceServer::_armTimer(long micros)
+{
+    itimerspec spec;
+    std::memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = micros / MICROS_PER_SECOND;
+    spec.it_value.tv_nsec = (micros % MICROS_PER_SECOND) * NANOS_PER_MICRO;
+    timerfd_settime(_timerFd, 0, &spec, nullptr);
+}
+
+/**
+ * @brief connects to a server. prints an error and exits on failure
+ * @param socketPath - the path of the socket of the server
+ */
+InferenceClient::InferenceClient(const std::string& socketPath)
+{
+    sockaddr_un address;
+    socketAddress(socketPath, address);
+    _fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if ((_fd < 0) || (connect(_fd, (sockaddr*)&address, sizeof(address)) < 0))
+    {
+        std::cerr << STR_CONNECT_ERR << socketPath << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief destructor for inference client, closes the connection
+ */
+InferenceClient::~InferenceClient()
+{
+    close(_fd);
+}
+
+/**
+ * @brief sends a request without waiting for its response
+ * @param image - the image, SERVER_REQUEST_FLOATS floats
+ * @return true on success, false if the connection broke
+ */
+bool InferenceClient::send(const float* image)
+{
+    const char* bytes = (const char*)image;
+    long left = SERVER_REQUEST_BYTES;
+    while (left > 0)
+    {
+        ssize_t count = ::send(_fd, bytes, left, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return false;
+        }
+        bytes += count;
+        left -= count;
+    }
+    return true;
+}
+
+/**
+ * @brief waits for the response to the oldest request not answered yet
+ * @param digit - the digit to put the response into
+ * @return true on success, false if the connection broke
+ */
+bool InferenceClient::receive(Digit& digit)
+{
+    ServerResponse response;
+    char* bytes = (char*)&response;
+    long left = sizeof(response);
+    while (left > 0)
+    {
+        ssize_t count = read(_fd, bytes, left);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return false;
+        }
+        bytes += count;
+        left -= count;
+    }
+    digit.value = response.value;
+    digit.probability = response.probability;
+    return true;
+}
+
+/**
+ * @brief classifies one image: sends it and waits for the response
+ * @param image - the image, SERVER_REQUEST_FLOATS floats
+ * @param digit - the digit to put the response into
+ * @return true on success, false if the connection broke
+ */
+bool InferenceClient::classify(const float* image, Digit& digit)
+{
+    return send(image) && receive(digit);
+}
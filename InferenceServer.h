@@ -0,0 +1,185 @@
+
+//InferenceServer.h
+
+#ifndef INFERENCESERVER_H
+#define INFERENCESERVER_H
+
+#include "MlpNetwork.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief the protocol of the server: a client sends requests of SERVER_REQUEST_FLOATS floats
+ *        (one image, in host byte order, the server runs on the same host) and gets a
+ *        ServerResponse for every request, in the order it sent them. a client may send more
+ *        requests before it reads the responses, but once SERVER_MAX_UNSENT responses wait
+ *        for it the server stops reading its requests until it reads them
+ */
+#define SERVER_REQUEST_FLOATS 784
+#define SERVER_REQUEST_BYTES (SERVER_REQUEST_FLOATS * (int)sizeof(float))
+#define SERVER_MAX_UNSENT 1024
+
+/**
+ * @struct ServerResponse
+ * @brief the response to one request
+ */
+typedef struct ServerResponse
+{
+    uint32_t value;     // the digit
+    float probability;  // its probability
+} ServerResponse;
+
+static_assert(sizeof(ServerResponse) == 8, "the response is sent as it is");
+
+/**
+ * @struct ServerStats
+ * @brief the metrics of a server since it started
+ */
+typedef struct ServerStats
+{
+    long connections = 0;   // the number of clients that connected
+    long requests = 0;      // the number of images classified
+    long batches = 0;       // the number of batches run
+    long fullBatches = 0;   // the batches run because they were full, the rest timed out
+    double busySeconds = 0; // the time spent classifying
+} ServerStats;
+
+/**
+ * @brief class that represents an inference daemon on a Unix domain socket. one thread serves
+ *        every client with epoll, and the requests of all clients are collected into one batch
+ *        (dynamic micro-batching): a batch runs when it is full, or when its oldest request
+ *        waited the latency budget, so under load the network runs on large batches and a
+ *        lone request waits no more than the budget
+ */
+class InferenceServer
+{
+public:
+    /**
+     * @brief creates the socket and starts listening. prints an error and exits on failure
+     * @param network - the network (not owned), its input must be SERVER_REQUEST_FLOATS
+     * @param socketPath - the path of the socket, an old socket at the path is removed
+     * @param maxBatch - the largest batch, a batch that fills up runs right away
+     * @param maxDelayMicros - the latency budget, the longest a request waits for a batch
+     */
+    InferenceServer(MlpNetwork& network, const std::string& socketPath, int maxBatch,
+                    int maxDelayMicros);
+
+    /**
+     * @brief destructor for inference server, closes every client and removes the socket
+     */
+    ~InferenceServer();
+
+    InferenceServer(const InferenceServer&) = delete;
+    InferenceServer& operator=(const InferenceServer&) = delete;
+
+    /**
+     * @brief serves the clients until stop is called
+     */
+    void run();
+
+    /**
+     * @brief makes run return. may be called from another thread or from a signal handler
+     */
+    void stop();
+
+    /**
+     * @brief returns the metrics of the server
+     * @return the metrics
+     */
+    const ServerStats& getStats() const;
+
+    /**
+     * @brief prints the metrics of the server
+     * @param out - the stream to print into
+     */
+    void printStats(std::ostream& out) const;
+
+private:
+    /**
+     * @struct Connection
+     * @brief a client, with the bytes of a partial request and the responses not sent yet
+     */
+    typedef struct Connection
+    {
+        int fd = -1;
+        std::vector<char> in;   // the bytes of the request being received
+        size_t inSize = 0;      // the number of bytes in in
+        std::vector<char> out;  // the responses not sent yet
+        size_t outSent = 0;     // the number of bytes of out already sent
+        uint32_t events = 0;    // the events epoll waits for on the connection
+    } Connection;
+
+    void _accept();
+    void _read(uint64_t id);
+    void _write(uint64_t id);
+    void _close(uint64_t id);
+    void _watch(uint64_t id, Connection& connection, bool blocked);
+    void _enqueue(uint64_t id, const char* request);
+    void _runBatch(bool full);
+    void _armTimer(long micros);
+    MlpNetwork& _network;
+    std::string _socketPath;
+    int _maxBatch;
+    int _maxDelayMicros;
+    int _listenFd;                                  // the listening socket
+    int _epollFd;                                   // the epoll instance
+    int _timerFd;                                   // fires when the batch waited the budget
+    int _stopFd;                                    // an eventfd that stop writes to
+    uint64_t _nextId;                               // the id of the next client
+    std::unordered_map<uint64_t, Connection> _connections;
+    std::vector<float> _pending;                    // the images of the batch, one after another
+    std::vector<uint64_t> _pendingIds;              // the client of every image of the batch
+    Matrix _batch;                                  // the batch, every column is one image
+    ServerStats _stats;
+};
+
+/**
+ * @brief class that represents a client of an inference server, on one connection
+ */
+class InferenceClient
+{
+public:
+    /**
+     * @brief connects to a server. prints an error and exits on failure
+     * @param socketPath - the path of the socket of the server
+     */
+    explicit InferenceClient(const std::string& socketPath);
+
+    /**
+     * @brief destructor for inference client, closes the connection
+     */
+    ~InferenceClient();
+
+    InferenceClient(const InferenceClient&) = delete;
+    InferenceClient& operator=(const InferenceClient&) = delete;
+
+    /**
+     * @brief sends a request without waiting for its response
+     * @param image - the image, SERVER_REQUEST_FLOATS floats
+     * @return true on success, false if the connection broke
+     */
+    bool send(const float* image);
+
+    /**
+     * @brief waits for the response to the oldest request not answered yet
+     * @param digit - the digit to put the response into
+     * @return true on success, false if the connection broke
+     */
+    bool receive(Digit& digit);
+
+    /**
+     * @brief classifies one image: sends it and waits for the response
+     * @param image - the image, SERVER_REQUEST_FLOATS floats
+     * @param digit - the digit to put the response into
+     * @return true on success, false if the connection broke
+     */
+    bool classify(const float* image, Digit& digit);
+
+private:
+    int _fd;
+};
+
+#endif //INFERENCESERVER_H
@@ -0,0 +1,124 @@
+/**
+* @file   InferenceWorkspace.cpp
+* @brief a program that implements InferenceWorkspace.h. keeps the activations of the network in
+ *       one aligned arena per thread, so threads that classify at the same time do not compete
+ *       on the allocator.
+* @section DESCRIPTION a program that implements InferenceWorkspace.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+
+#include "InferenceWorkspace.h"
+#include "Matrix.h"
+#include <cstdlib>
+#include <iostream>
+
+#define STR_ALLOCATION_ERR "Error: memory allocation didn't work"
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief rounds a number of floats up to whole cache lines
+ * @param size - the number of floats
+ * @return the rounded number of floats
+ */
+static int roundToAlignment(int size)
+{
+    return ((size + MATRIX_ALIGNMENT_FLOATS - 1) / MATRIX_ALIGNMENT_FLOATS) *
+           MATRIX_ALIGNMENT_FLOATS;
+}
+
+/**
+ * @brief constructor for an empty workspace, the first network that runs on it sizes it
+ */
+InferenceWorkspace::InferenceWorkspace(): _arena(nullptr), _bufferSize(0), _input(nullptr),
+                                          _inputSize(0)
+{
+}
+
+/**
+ * @brief destructor for workspace
+ */
+InferenceWorkspace::~InferenceWorkspace()
+{
+    std::free(_arena);
+    std::free(_input);
+}
+
+/**
+ * @brief makes room for a batch of images of a network, allocates only when the buffers are
+ *        smaller than needed (the thread may run networks of different sizes). the content of
+ *        the buffers is not kept
+ * @param bufferRows - the largest output of a dense of the network
+ * @param cols - the number of images in the batch
+ */
+void InferenceWorkspace::reserve(int bufferRows, int cols)
+{
+    int bufferSize = roundToAlignment(bufferRows * cols);
+    if (bufferSize <= _bufferSize)
+    {
+        return;
+    }
+
+    float* arena = (float*)std::aligned_alloc(MATRIX_ALIGNMENT, sizeof(float) * 2 * bufferSize);
+
+    // Checks if the memory allocation worked
+    if (arena == nullptr)
+    {
+        std::cerr << STR_ALLOCATION_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::free(_arena);
+    _arena = arena;
+    _bufferSize = bufferSize;
+}
+
+/**
+ * @brief returns one of the two output buffers, room for the largest dense output per image
+ * @param index - the number of the dense, the buffers alternate between denses
+ * @return the output buffer
+ */
+float* InferenceWorkspace::getBuffer(int index)
+{
+    return _arena + (index % 2) * _bufferSize;
+}
+
+/**
+ * @brief returns a buffer for an input that cannot be read where it is (the rows of a padded
+ *        image, copied one after the other), allocates only when it is smaller than needed
+ * @param size - the number of floats
+ * @return the input buffer
+ */
+float* InferenceWorkspace::getInputBuffer(int size)
+{
+    if (size <= _inputSize)
+    {
+        return _input;
+    }
+
+    int inputSize = roundToAlignment(size);
+    float* input = (float*)std::aligned_alloc(MATRIX_ALIGNMENT, sizeof(float) * inputSize);
+
+    // Checks if the memory allocation worked
+    if (input == nullptr)
+    {
+        std::cerr << STR_ALLOCATION_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::free(_input);
+    _input = input;
+    _inputSize = inputSize;
+    return _input;
+}
+
+/**
+ * @brief returns the workspace of the calling thread
+ * @return the workspace
+ */
+InferenceWorkspace& InferenceWorkspace::local()
+{
+    static thread_local InferenceWorkspace workspace;
+    return workspace;
+}
@@ -0,0 +1,67 @@
+
+//InferenceWorkspace.h
+
+#ifndef INFERENCEWORKSPACE_H
+#define INFERENCEWORKSPACE_H
+
+/**
+ * @brief class that represents the memory one thread classifies with: two buffers the denses
+ *        write into in turns (ping-pong), in one arena aligned to MATRIX_ALIGNMENT and sized
+ *        for the widest dense and the largest batch the thread ran. the images are read where
+ *        they are, through views. a warm classification does not allocate
+ */
+class InferenceWorkspace
+{
+public:
+    /**
+     * @brief constructor for an empty workspace, the first network that runs on it sizes it
+     */
+    InferenceWorkspace();
+
+    /**
+     * @brief destructor for workspace
+     */
+    ~InferenceWorkspace();
+
+    InferenceWorkspace(const InferenceWorkspace&) = delete;
+    InferenceWorkspace& operator=(const InferenceWorkspace&) = delete;
+
+    /**
+     * @brief makes room for a batch of images of a network, allocates only when the buffers
+     *        are smaller than needed (the thread may run networks of different sizes). the
+     *        content of the buffers is not kept
+     * @param bufferRows - the largest output of a dense of the network
+     * @param cols - the number of images in the batch
+     */
+    void reserve(int bufferRows, int cols);
+
+    /**
+     * @brief returns one of the two output buffers, room for the largest dense output per image
+     * @param index - the number of the dense, the buffers alternate between denses
+     * @return the output buffer
+     */
+    float* getBuffer(int index);
+
+    /**
+     * @brief returns a buffer for an input that cannot be read where it is (the rows of a
+     *        padded image, copied one after the other), allocates only when it is smaller than
+     *        needed
+     * @param size - the number of floats
+     * @return the input buffer
+     */
+    float* getInputBuffer(int size);
+
+    /**
+     * @brief returns the workspace of the calling thread
+     * @return the workspace
+     */
+    static InferenceWorkspace& local();
+
+private:
+    float* _arena;        // the two output buffers, one after the other
+    int _bufferSize;      // the number of floats in each output buffer
+    float* _input;        // the input buffer
+    int _inputSize;       // the number of floats in the input buffer
+};
+
+#endif //INFERENCEWORKSPACE_H
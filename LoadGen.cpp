@@ -0,0 +1,182 @@
+/**
+* @file   LoadGen.cpp
+* @brief a program that loads an inference server: every client is a thread on its own
+ *       connection that keeps some requests in flight, and the latency of every request is
+ *       measured from its send to its response. prints the p50/p99 latency and throughput.
+* @section DESCRIPTION usage: loadgen socket images labels [clients] [requests] [inflight]
+ *          the images and labels are IDX files, requests is the number sent by every client.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "IdxDataset.h"
+#include "InferenceServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#define ARGS_COUNT_MIN 4
+#define ARGS_COUNT_MAX 7
+#define SOCKET_ARG 1
+#define IMAGES_ARG 2
+#define LABELS_ARG 3
+#define CLIENTS_ARG 4
+#define REQUESTS_ARG 5
+#define INFLIGHT_ARG 6
+#define DEFAULT_CLIENTS 8
+#define DEFAULT_REQUESTS 2000
+#define DEFAULT_INFLIGHT 1
+#define MAX_IMAGES 1024      // the images sent are the first ones of the dataset
+#define MICROS_PER_SECOND 1e6
+#define USAGE_MSG "Usage: loadgen socket images labels [clients] [requests] [inflight]"
+#define STR_LOADGEN_ARGS_ERR "Error: clients, requests and inflight must be positive"
+#define STR_IMAGE_SIZE_ERR "Error: the images do not match the requests of the server"
+#define STR_CONNECTION_ERR "Error: the server closed the connection"
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @struct ClientResult
+ * @brief what one client measured
+ */
+typedef struct ClientResult
+{
+    std::vector<double> latencies; // the latency of every request, in microseconds
+    long correct = 0;              // the responses that match the labels
+    bool failed = false;           // true if the connection broke
+} ClientResult;
+
+/**
+ * @brief the loop of a client: sends inflight requests, then sends a new one for every
+ *        response, until it sent its share
+ * @param socketPath - the path of the socket of the server
+ * @param images - the images, one after another
+ * @param labels - the label of every image
+ * @param first - the index of the first image the client sends
+ * @param requests - the number of requests to send
+ * @param inflight - the number of requests in flight
+ * @param result - the result to fill
+ */
+static void runClient(const char* socketPath, const std::vector<float>& images,
+                      const std::vector<unsigned char>& labels, int first, int requests,
+                      int inflight, ClientResult& result)
+{
+    typedef std::chrono::steady_clock Clock;
+    InferenceClient client(socketPath);
+    int count = (int)labels.size();
+    std::vector<Clock::time_point> sent(requests);
+    result.latencies.reserve(requests);
+
+    int sending = 0;
+    for (int received = 0; received < requests; received++)
+    {
+        // Keeps the window full, the responses come in the order of the requests
+        for (; (sending < requests) && (sending < received + inflight); sending++)
+        {
+            int image = (first + sending) % count;
+            sent[sending] = Clock::now();
+            if (!client.send(images.data() + (size_t)image * SERVER_REQUEST_FLOATS))
+            {
+                result.failed = true;
+                return;
+            }
+        }
+        Digit digit;
+        if (!client.receive(digit))
+        {
+            result.failed = true;
+            return;
+        }
+        result.latencies.push_back(std::chrono::duration<double>(Clock::now() -
+                                                                 sent[received]).count() *
+                                   MICROS_PER_SECOND);
+        result.correct += (digit.value == labels[(first + received) % count]);
+    }
+}
+
+/**
+ * @brief returns a percentile of sorted values
+ * @param sorted - the values, sorted
+ * @param percent - the percentile, in [0, 100]
+ * @return the value
+ */
+static double percentile(const std::vector<double>& sorted, double percent)
+{
+    size_t index = (size_t)(percent / 100 * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+int main(int argc, char* argv[])
+{
+    if ((argc < ARGS_COUNT_MIN) || (argc > ARGS_COUNT_MAX))
+    {
+        std::cerr << USAGE_MSG << std::endl;
+        return EXIT_FAILURE;
+    }
+    int clients = (argc > CLIENTS_ARG) ? std::atoi(argv[CLIENTS_ARG]) : DEFAULT_CLIENTS;
+    int requests = (argc > REQUESTS_ARG) ? std::atoi(argv[REQUESTS_ARG]) : DEFAULT_REQUESTS;
+    int inflight = (argc > INFLIGHT_ARG) ? std::atoi(argv[INFLIGHT_ARG]) : DEFAULT_INFLIGHT;
+    if ((clients <= 0) || (requests <= 0) || (inflight <= 0))
+    {
+        std::cerr << STR_LOADGEN_ARGS_ERR << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // the requests hold an image each, so the columns of the batch are laid out one by one
+    IdxBatch batch;
+    {
+        IdxDataset dataset(argv[IMAGES_ARG], argv[LABELS_ARG], MAX_IMAGES);
+        if (dataset.getImageSize() != SERVER_REQUEST_FLOATS)
+        {
+            std::cerr << STR_IMAGE_SIZE_ERR << std::endl;
+            return EXIT_FAILURE;
+        }
+        dataset.next(batch);
+    }
+    std::vector<float> images((size_t)batch.count * SERVER_REQUEST_FLOATS);
+    for (int j = 0; j < batch.count; j++)
+    {
+        for (int i = 0; i < SERVER_REQUEST_FLOATS; i++)
+        {
+            images[(size_t)j * SERVER_REQUEST_FLOATS + i] = batch.images(i, j);
+        }
+    }
+
+    std::vector<ClientResult> results(clients);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < clients; c++)
+    {
+        threads.emplace_back(runClient, argv[SOCKET_ARG], std::cref(images),
+                             std::cref(batch.labels), c * requests, requests, inflight,
+                             std::ref(results[c]));
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                   start).count();
+
+    std::vector<double> latencies;
+    long correct = 0;
+    for (const ClientResult& result : results)
+    {
+        if (result.failed)
+        {
+            std::cerr << STR_CONNECTION_ERR << std::endl;
+            return EXIT_FAILURE;
+        }
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        correct += result.correct;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::printf("requests   %zu (%d clients, %d in flight each)\n", latencies.size(), clients,
+                inflight);
+    std::printf("accuracy   %.2f%%\n", 100.0 * correct / latencies.size());
+    std::printf("throughput %.0f requests/s\n", latencies.size() / seconds);
+    std::printf("latency    p50 %.1f us, p99 %.1f us, max %.1f us\n", percentile(latencies, 50),
+                percentile(latencies, 99), latencies.back());
+    return EXIT_SUCCESS;
+}
@@ -1,454 +1,717 @@
-/**
-* @file   Matrix.cpp
-* @brief a program that implements Matrix.h. represents and creates a matrix object that contains
- *       an array of float.
-* @section DESCRIPTION a program that implements Matrix.h.
-*/
-
-// -------------------------------------- includes ------------------------------------------------
-#include "Matrix.h"
-#include <iostream>
-#include <fstream>
-#include <cstdio>
-
-#define STR_INVALID_NUM_ROWS_OR_COLS "Error: number of rows or cols is invalid"
-#define STR_ALLOCATION_ERR         "Error: memory allocation didn't work"
-#define STR_WRONG_SIZES_MULT       "Error: different sizes for * "
-#define STR_WRONG_SIZES_ADD        "Error: different sizes for + "
-#define STR_WRONG_SIZES_ASSIGN_ADD "Error: different sizes for += "
-#define STR_OUT_OF_BOUNDS_ERR      "Error: out of bounds"
-#define STR_INVALID_ARGS_ERR       "Error: invalid args"
-#define STR_DIFFERENT_SIZES_ERR    "Error: different sizes"
-#define DEFAULT_SIZE 1
-
-// ------------------------------------------- function declaration -------------------------------
-
-/**
- * @brief destructor for Matrix
- */
-Matrix::~Matrix()
-{
-    delete [] _2DArray;
-}
-
-/**
- * @brief constructor for Matrix - creates a matrix object
- * @param rows - the number of rows of the matrix to create
- * @param cols - the number of cols of the matrix to create
- */
-Matrix::Matrix(int rows, int cols) : _dims{rows, cols}
-{
-    // Checks if the number of rows or cols is smaller or equal to zero
-    if ((_dims.rows <= 0) || (_dims.cols <= 0))
-    {
-        std::cerr << STR_INVALID_NUM_ROWS_OR_COLS << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    _2DArray = new float[_dims.rows* _dims.cols];
-
-    // Checks if the memory allocation worked
-    if (_2DArray == nullptr)
-    {
-        std::cerr << STR_ALLOCATION_ERR << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    _size = _dims.rows * _dims.cols;
-
-    // Goes over the array of float and initializes each cell with zero
-    for (int i = 0; i < (_size); i++)
-    {
-        _2DArray[i] = 0;
-    }
-}
-
-/**
- * @brief constructs a matrix with one cell
- */
-Matrix::Matrix(): _dims{DEFAULT_SIZE, DEFAULT_SIZE}
-{
-    _2DArray = new float[_dims.rows * _dims.cols];
-
-    // Checks if the memory allocation worked
-    if (_2DArray == nullptr)
-    {
-        std::cerr << STR_ALLOCATION_ERR << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    _size = _dims.rows * _dims.cols;
-
-    _2DArray[0] = 0;
-}
-
-/**
- * @brief copy constructor for matrix
- * @param mat - the other matrix to copy from
- */
-Matrix::Matrix(const Matrix& mat): _dims{mat.getRows(), mat.getCols()}
-{
-    _2DArray = new float[_dims.rows * _dims.cols];
-
-    // Checks if the memory allocation worked
-    if (_2DArray == nullptr)
-    {
-        std::cerr << STR_ALLOCATION_ERR << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    _size = _dims.rows * _dims.cols;
-
-    // Goes over the array of float and initializes each value with the according value in mat
-    for (int i = 0; i < (_size); i++)
-    {
-        _2DArray[i] = mat[i];
-    }
-}
-
-/**
- * @brief returns the number of rows of the array
- * @return the number of rows
- */
-int& Matrix::getRows()
-{
-    return _dims.rows;
-}
-
-/**
- * @brief returns the number of cols of the array
- * @return the number of cols
- */
-int& Matrix::getCols()
-{
-    return _dims.cols;
-}
-
-/**
- * @brief multiples two matrices
- * @param other - the matrix to multiply with the current matrix
- * @return - a matrix with the result of multiplication
- */
-Matrix Matrix::operator*(const Matrix& other) const
-{
-    // checks if the number of cols is different from the number of rows
-    if (_dims.cols != other.getRows())
-    {
-        std::cerr << STR_WRONG_SIZES_MULT << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    int otherCols = other.getCols();
-    Matrix temp(_dims.rows, other.getCols());
-
-    for (int i = 0; i < _dims.rows; i++)
-    {
-        for (int j = 0; j < otherCols; j++)
-        {
-            for (int k = 0; k < _dims.cols; k++)
-            {
-                (temp)(i, j) += ((*this)(i, k) * (other)(k, j));
-            }
-        }
-    }
-    return temp;
-}
-
-/**
- * @brief prints the matrix array
- */
-void Matrix::plainPrint() const
-{
-    for (int i = 0; i < _dims.rows; i++)
-    {
-        for (int j = 0; j < _dims.cols; j++)
-        {
-            std::cout << _2DArray[i * _dims.cols + j] << " ";
-        }
-        std::cout << std::endl;
-    }
-}
-
-/**
- * @brief returns the element in the i row, j column
- * @param i - the row
- * @param j - the column
- * @return  - the element in the matrix
- */
-float& Matrix::operator()(const int i, const int j)
-{
-    if ((i < 0) || (j < 0))
-    {
-        std::cerr << STR_INVALID_ARGS_ERR << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    if ((i >= _dims.rows) || (j >= _dims.cols))
-    {
-        std::cerr << STR_OUT_OF_BOUNDS_ERR << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    return _2DArray[i * _dims.cols + j];
-}
-
-const float& Matrix::operator()(const int i, const int j) const
-{
-    if ((i < 0) || (j < 0))
-    {
-        std::cerr << STR_INVALID_ARGS_ERR << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    if ((i >= _dims.rows) || (j >= _dims.cols))
-    {
-        std::cerr << STR_OUT_OF_BOUNDS_ERR << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    return _2DArray[i * _dims.cols + j];
-}
-
-/**
- * @brief adds two matrices
- * @param other - the other matrix
- * @return a matrix after the addition
- */
-Matrix Matrix::operator+(const Matrix& other) const
-{
-    if ((_dims.rows != other.getRows()) || (_dims.cols != other.getCols()))
-    {
-        std::cerr << STR_WRONG_SIZES_ADD << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    Matrix temp(_dims.rows, _dims.cols);
-
-    for (int i = 0; i < _dims.rows; i++)
-    {
-        for (int j = 0; j < _dims.cols; j++)
-        {
-            (temp)(i, j) = (other)(i, j) + (*this)(i, j);
-        }
-    }
-    return temp;
-}
-
-const int& Matrix::getRows() const
-{
-    return _dims.rows;
-}
-
-const int& Matrix::getCols() const
-{
-    return _dims.cols;
-}
-
-/**
- * @brief assigns the information of other matrix into the current matrix
- * @param other - the other matrix
- * @return the current matrix
- */
-Matrix& Matrix::operator=(const Matrix &other)
-{
-    if (this == &other)
-    {
-        return *this;
-    }
-
-    delete [] _2DArray;
-
-    _dims.rows = other.getRows();
-    _dims.cols = other.getCols();
-
-    _2DArray = new float[_dims.rows * _dims.cols];
-
-    // Checks if the memory allocation worked
-    if (_2DArray == nullptr)
-    {
-        std::cerr << STR_ALLOCATION_ERR << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    _size = _dims.rows * _dims.cols;
-
-
-    // Goes over the array of float and copies the data
-    for (int i = 0; i < (_size); i++)
-    {
-        _2DArray[i] = other[i];
-    }
-
-    return *this;
-}
-
-/**
- * @brief represents the matrix as a column vector
- * @return the current matrix represented as column vector
- */
-Matrix& Matrix::vectorize()
-{
-    _dims.rows = _dims.rows * _dims.cols;
-    _dims.cols = 1;
-
-    return *this;
-}
-
-/**
- * @brief multiples the matrix by scalar
- * @param scalar the scalar
- * @return a matrix after multiplication by scalar
- */
-Matrix Matrix::operator*(const float& scalar) const
-{
-    Matrix temp(_dims.rows, _dims.cols);
-
-    // Goes over the array and multiples each cell by the scalar
-    for (int i = 0; i < _dims.rows; i++)
-    {
-        for (int j = 0; j < _dims.cols; j++)
-        {
-            (temp)(i, j) = (*this)(i, j) * scalar;
-        }
-    }
-    return (temp);
-}
-
-/**
- * @brief multiples scalar by matrix
- * @param scalar the scalar
- * @param m the matrix (const)
- * @return a matrix after the multiplication
- */
-Matrix operator*(const float& scalar,  const Matrix& m)
-{
-    Matrix temp(m.getRows(), m.getCols());
-
-    // Goes over the array and multiples each cell by the scalar
-    for (int i = 0; i < temp.getRows(); i++)
-    {
-        for (int j = 0; j < temp.getCols(); j++)
-        {
-            temp(i, j) = scalar * m(i , j);
-        }
-    }
-    return temp;
-}
-
-/**
- * @brief multiples scalar by matrix
- * @param scalar the scalar
- * @param m the matrix
- * @return a matrix after the multiplication
- */
-Matrix operator*(const float& scalar,  Matrix& m)
-{
-    Matrix temp(m.getRows(), m.getCols());
-
-    // Goes over the array and multiples each cell by the scalar
-    for (int i = 0; i < temp.getRows(); i++)
-    {
-        for (int j = 0; j < temp.getCols(); j++)
-        {
-            temp(i, j) = scalar * m(i , j);
-        }
-    }
-    return temp;
-}
-
-/**
- * @brief assigns and adds the other matrix to the current matrix
- * @param other - the other matrix
- * @return - the current matrix after the add and assignment
- */
-Matrix& Matrix::operator+=(const Matrix& other)
-{
-    if ((_dims.rows != other.getRows()) || (_dims.cols != other.getCols()))
-    {
-        std::cerr << STR_WRONG_SIZES_ASSIGN_ADD << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    for (int i = 0; i < _dims.rows; i++)
-    {
-        for (int j = 0; j < _dims.cols; j++)
-        {
-            (*this)(i, j) = (other)(i, j) + (*this)(i, j);
-        }
-    }
-    return (*this);
-}
-
-/**
- * @brief returns the element in the array in the i index
- * @param i the index
- * @return the element (non const)
- */
-float& Matrix::operator[](const int i)
-{
-    // Checks if i is a valid index
-    if (i >= (_dims.rows * _dims.cols) || (i < 0))
-    {
-        std::cerr << STR_OUT_OF_BOUNDS_ERR << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    return _2DArray[i];
-}
-
-/**
- * @brief returns the element in the array in the i index
- * @param i the index
- * @return the element (const)
- */
-const float& Matrix::operator[](const int i) const
-{
-    // Checks if i is a valid index
-    if (i >= (_dims.rows * _dims.cols) || (i < 0))
-    {
-        std::cerr << STR_OUT_OF_BOUNDS_ERR << std::endl;
-        exit(EXIT_FAILURE);
-    }
-    return _2DArray[i];
-}
-
-/**
- * @brief reads data into mat
- * @param is - ifstream object
- * @param mat - the matrix to save the data into
- */
-std::istream& operator>>(std::istream& is, Matrix& mat)
-{
-    int i = 0;
-
-    while (i < mat.getRows() * mat.getCols())
-    {
-        if (!is.good())
-        {
-            std::cerr << STR_DIFFERENT_SIZES_ERR << std::endl;
-        }
-        is.read((char*)&mat[i] , 4);
-        i++;
-    }
-    return is;
-}
-
-/**
- * @brief prints the matrix according to a condition
- * @param out - ostream object
- * @param mat - the matrix to print
- * @return - ostream object
- */
-std::ostream& operator<<(std::ostream& out, Matrix& mat)
-{
-    for (int i = 0; i < mat.getRows(); i++)
-    {
-        for (int j = 0; j < mat.getCols(); j++)
-        {
-            if (mat(i, j) <= 0.1f)
-            {
-                out << "  ";
-            }
-            else
-            {
-                out << "**";
-            }
-        }
-        std::cout << std::endl;
-    }
-    return out;
-}
+/**
+* @file   Matrix.cpp
+* @brief a program that implements Matrix.h. represents and creates a matrix object that contains
+ *       an array of float.
+* @section DESCRIPTION a program that implements Matrix.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "Matrix.h"
+#include "BinaryReader.h"
+#include "Gemm.h"
+#include "Profiler.h"
+#include "SimdKernels.h"
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+
+#define STR_INVALID_NUM_ROWS_OR_COLS "Error: number of rows or cols is invalid"
+#define STR_ALLOCATION_ERR         "Error: memory allocation didn't work"
+#define STR_WRONG_SIZES_MULT       "Error: different sizes for * "
+#define STR_WRONG_SIZES_ADD        "Error: different sizes for + "
+#define STR_WRONG_SIZES_ASSIGN_ADD "Error: different sizes for += "
+#define STR_OUT_OF_BOUNDS_ERR      "Error: out of bounds"
+#define STR_INVALID_ARGS_ERR       "Error: invalid args"
+#define STR_DIFFERENT_SIZES_ERR    "Error: different sizes"
+#define DEFAULT_SIZE 1
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief returns the stride of the rows of a layout
+ * @param cols - the number of cols
+ * @param padded - true for rows padded to MATRIX_ALIGNMENT
+ * @return the stride
+ */
+int Matrix::_strideOf(int cols, bool padded)
+{
+    if (!padded)
+    {
+        return cols;
+    }
+    return (cols + MATRIX_ALIGNMENT_FLOATS - 1) / MATRIX_ALIGNMENT_FLOATS *
+           MATRIX_ALIGNMENT_FLOATS;
+}
+
+/**
+ * @brief allocates an array aligned to MATRIX_ALIGNMENT. prints an error and exits on failure
+ * @param cells - the number of floats
+ * @return the array, freed with std::free
+ */
+float* Matrix::_allocate(int cells)
+{
+    // aligned_alloc wants a size that is a multiple of the alignment
+    size_t bytes = ((size_t)cells * sizeof(float) + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT *
+                   MATRIX_ALIGNMENT;
+    float* array = (float*)std::aligned_alloc(MATRIX_ALIGNMENT, bytes);
+    PROFILE_ALLOCATION(bytes);
+
+    // Checks if the memory allocation worked
+    if (array == nullptr)
+    {
+        std::cerr << STR_ALLOCATION_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+/**
+ * @brief copies the cells of a matrix of the same sizes, row by row when a stride differs.
+ *        the padding of the current matrix is left as it is
+ * @param other - the matrix
+ */
+void Matrix::_copyRows(const Matrix& other)
+{
+    PROFILE_SCOPE_BYTES(ProfileCopy, sizeof(float) * _dims.rows * _dims.cols);
+    if (isPacked() && other.isPacked())
+    {
+        simdCopy(other._2DArray, _2DArray, _dims.rows * _dims.cols);
+        return;
+    }
+    for (int i = 0; i < _dims.rows; i++)
+    {
+        simdCopy(other.row(i), row(i), _dims.cols);
+    }
+}
+
+/**
+ * @brief destructor for Matrix
+ */
+Matrix::~Matrix()
+{
+    if (_owner)
+    {
+        std::free(_2DArray);
+    }
+}
+
+/**
+ * @brief creates a read-only matrix over memory it does not own (like a mapped model file),
+ *        without copying. the memory must outlive the matrix. a copy of a view owns its
+ *        array, and resizing or assigning into a view gives it an array of its own
+ * @param data - the cells, row after row
+ * @param rows - the number of rows
+ * @param cols - the number of cols
+ * @return the view
+ */
+Matrix Matrix::view(const float* data, int rows, int cols)
+{
+    return view(data, rows, cols, cols);
+}
+
+/**
+ * @brief creates a read-only matrix over memory it does not own, whose rows are stride
+ *        floats apart (like padded weights), without copying. the memory must outlive the
+ *        matrix
+ * @param data - the cells, row after row
+ * @param rows - the number of rows
+ * @param cols - the number of cols
+ * @param stride - the distance between two rows, at least cols
+ * @return the view
+ */
+Matrix Matrix::view(const float* data, int rows, int cols, int stride)
+{
+    if ((rows <= 0) || (cols <= 0) || (stride < cols) || (data == nullptr))
+    {
+        std::cerr << STR_INVALID_NUM_ROWS_OR_COLS << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    Matrix mat;
+    std::free(mat._2DArray);
+    mat._dims = {rows, cols};
+    mat._2DArray = const_cast<float*>(data); // never written through, see resize
+    mat._size = (rows - 1) * stride + cols;  // the last row may have no padding after it
+    mat._capacity = mat._size;
+    mat._stride = stride;
+    mat._owner = false;
+    return mat;
+}
+
+/**
+ * @brief returns true if the matrix is a view over memory it does not own
+ * @return true for a view
+ */
+bool Matrix::isView() const
+{
+    return !_owner;
+}
+
+/**
+ * @brief constructor for Matrix - creates a matrix object
+ * @param rows - the number of rows of the matrix to create
+ * @param cols - the number of cols of the matrix to create
+ */
+Matrix::Matrix(int rows, int cols) : Matrix(rows, cols, LayoutPacked)
+{
+}
+
+/**
+ * @brief constructor for Matrix - creates a matrix object of a layout
+ * @param rows - the number of rows of the matrix to create
+ * @param cols - the number of cols of the matrix to create
+ * @param layout - packed rows, or rows padded to MATRIX_ALIGNMENT
+ */
+Matrix::Matrix(int rows, int cols, MatrixLayout layout) : _dims{rows, cols},
+                                                         _padded(layout == LayoutPadded),
+                                                         _owner(true)
+{
+    // Checks if the number of rows or cols is smaller or equal to zero
+    if ((_dims.rows <= 0) || (_dims.cols <= 0))
+    {
+        std::cerr << STR_INVALID_NUM_ROWS_OR_COLS << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    _stride = _strideOf(cols, _padded);
+    _size = _dims.rows * _stride;
+    _capacity = _size;
+    _2DArray = _allocate(_capacity);
+
+    // Initializes each cell with zero, the padding too
+    simdFill(_2DArray, 0, _size);
+}
+
+/**
+ * @brief constructs a matrix with one cell
+ */
+Matrix::Matrix(): _dims{DEFAULT_SIZE, DEFAULT_SIZE}, _padded(false), _owner(true)
+{
+    _stride = _dims.cols;
+    _size = _dims.rows * _dims.cols;
+    _capacity = _size;
+    _2DArray = _allocate(_capacity);
+
+    _2DArray[0] = 0;
+}
+
+/**
+ * @brief copy constructor for matrix, the copy has the layout of the other matrix (a copy of
+ *        a view with a stride is packed)
+ * @param mat - the other matrix to copy from
+ */
+Matrix::Matrix(const Matrix& mat): _dims{mat.getRows(), mat.getCols()}, _padded(mat._padded),
+                                   _owner(true)
+{
+    _stride = _strideOf(_dims.cols, _padded);
+    _size = _dims.rows * _stride;
+    _capacity = _size;
+    _2DArray = _allocate(_capacity);
+
+    // Initializes each value with the according value in mat, the padding with zeros
+    if (!isPacked())
+    {
+        simdFill(_2DArray, 0, _size);
+    }
+    _copyRows(mat);
+}
+
+/**
+ * @brief constructor for Matrix - copies the cells of a view into an array of its own
+ * @param view - the view, of any stride
+ */
+Matrix::Matrix(ConstMatrixView view): Matrix(view.getRows(), view.getCols())
+{
+    PROFILE_SCOPE_BYTES(ProfileCopy, sizeof(float) * _size);
+
+    // Copies the view row by row, its rows may not follow one another
+    for (int i = 0; i < _dims.rows; i++)
+    {
+        simdCopy(view.row(i), _2DArray + i * _dims.cols, _dims.cols);
+    }
+}
+
+/**
+ * @brief move constructor for matrix, takes the array of the other matrix without copying
+ * @param mat - the other matrix, left empty
+ */
+Matrix::Matrix(Matrix&& mat) noexcept: _dims(mat._dims), _2DArray(mat._2DArray), _size(mat._size),
+                                       _capacity(mat._capacity), _stride(mat._stride),
+                                       _padded(mat._padded), _owner(mat._owner)
+{
+    mat._dims = {0, 0};
+    mat._2DArray = nullptr;
+    mat._size = 0;
+    mat._capacity = 0;
+    mat._stride = 0;
+    mat._padded = false;
+    mat._owner = true;
+}
+
+/**
+ * @brief returns a view of the whole matrix, to slice without copying or to pass to the
+ *        kernels. it is valid until the matrix is resized, assigned into or destroyed
+ * @return the view
+ */
+MatrixView Matrix::asView()
+{
+    return MatrixView(_2DArray, _dims.rows, _dims.cols, _stride);
+}
+
+/**
+ * @brief returns a read-only view of the whole matrix, to slice without copying or to pass
+ *        to the kernels. it is valid until the matrix is resized, assigned into or destroyed
+ * @return the view
+ */
+ConstMatrixView Matrix::asView() const
+{
+    return ConstMatrixView(_2DArray, _dims.rows, _dims.cols, _stride);
+}
+
+/**
+ * @brief multiples two matrices
+ * @param other - the matrix to multiply with the current matrix
+ * @return - a matrix with the result of multiplication
+ */
+Matrix Matrix::operator*(const Matrix& other) const
+{
+    return multiply(other, nullptr);
+}
+
+/**
+ * @brief multiples two matrices, splitting the rows of the result between threads
+ * @param other - the matrix to multiply with the current matrix
+ * @param pool - the thread pool, or nullptr to run on the calling thread
+ * @return - a matrix with the result of multiplication
+ */
+Matrix Matrix::multiply(const Matrix& other, ThreadPool* pool) const
+{
+    Matrix temp(_dims.rows, other.getCols());
+
+    multiply(other, temp, pool);
+    return temp;
+}
+
+/**
+ * @brief multiples two matrices into a result matrix, reusing its array when it is big enough
+ * @param other - the matrix to multiply with the current matrix
+ * @param temp - the matrix to write the result into (not the current matrix or other)
+ * @param pool - the thread pool, or nullptr to run on the calling thread
+ * @return - the result matrix
+ */
+Matrix& Matrix::multiply(const Matrix& other, Matrix& temp, ThreadPool* pool) const
+{
+    // checks if the number of cols is different from the number of rows
+    if (_dims.cols != other.getRows())
+    {
+        std::cerr << STR_WRONG_SIZES_MULT << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if ((&temp == this) || (&temp == &other))
+    {
+        std::cerr << STR_INVALID_ARGS_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    int otherCols = other.getCols();
+    temp.resize(_dims.rows, otherCols);
+
+    // the strides of the matrices go to the kernels, a packed column vector (the input of a
+    // dense) goes through the matrix-vector path
+    gemm(asView(), other.asView(), temp.asView(), pool);
+    return temp;
+}
+
+/**
+ * @brief prints the matrix array
+ */
+void Matrix::plainPrint() const
+{
+    for (int i = 0; i < _dims.rows; i++)
+    {
+        for (int j = 0; j < _dims.cols; j++)
+        {
+            std::cout << _2DArray[i * _stride + j] << " ";
+        }
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * @brief returns the element in the i row, j column, checked in every build. prints an
+ *        error and exits if the index is out of the matrix
+ * @param i - the row
+ * @param j - the column
+ * @return  - the element in the matrix
+ */
+float& Matrix::at(const int i, const int j)
+{
+    _checkIndex(i, j);
+    return _2DArray[i * _stride + j];
+}
+
+/**
+ * @brief returns the element in the i row, j column, checked in every build. prints an
+ *        error and exits if the index is out of the matrix
+ * @param i - the row
+ * @param j - the column
+ * @return  - the element in the matrix (const)
+ */
+const float& Matrix::at(const int i, const int j) const
+{
+    _checkIndex(i, j);
+    return _2DArray[i * _stride + j];
+}
+
+/**
+ * @brief checks that the i row, j column is in the matrix. prints an error and exits if not
+ * @param i - the row
+ * @param j - the column
+ */
+void Matrix::_checkIndex(int i, int j) const
+{
+    if ((i < 0) || (j < 0))
+    {
+        std::cerr << STR_INVALID_ARGS_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if ((i >= _dims.rows) || (j >= _dims.cols))
+    {
+        matrixOutOfBounds();
+    }
+}
+
+/**
+ * @brief checks that the i index is one of the rows*cols cells. prints an error and exits if
+ *        not
+ * @param i - the index
+ */
+void Matrix::_checkIndex(int i) const
+{
+    if ((i >= _dims.rows * _dims.cols) || (i < 0))
+    {
+        matrixOutOfBounds();
+    }
+}
+
+/**
+ * @brief prints an out of bounds error and exits, the failure of a checked accessor
+ */
+void matrixOutOfBounds()
+{
+    std::cerr << STR_OUT_OF_BOUNDS_ERR << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief assigns the information of other matrix into the current matrix
+ * @param other - the other matrix
+ * @return the current matrix
+ */
+Matrix& Matrix::operator=(const Matrix &other)
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+    // the current array is reused when it is big enough, the layout is the layout of other
+    _padded = other._padded;
+    resize(other.getRows(), other.getCols());
+
+    // Copies the data
+    _copyRows(other);
+
+    return *this;
+}
+
+/**
+ * @brief moves the information of other matrix into the current matrix, without copying
+ * @param other - the other matrix, gets the array of the current matrix
+ * @return the current matrix
+ */
+Matrix& Matrix::operator=(Matrix &&other) noexcept
+{
+    std::swap(_dims, other._dims);
+    std::swap(_2DArray, other._2DArray);
+    std::swap(_size, other._size);
+    std::swap(_capacity, other._capacity);
+    std::swap(_stride, other._stride);
+    std::swap(_padded, other._padded);
+    std::swap(_owner, other._owner);
+
+    return *this;
+}
+
+/**
+ * @brief changes the dimensions of the matrix. allocates only when the matrix has fewer cells
+ *        than needed, the values of the cells are not kept. a padded matrix stays padded
+ * @param rows - the new number of rows
+ * @param cols - the new number of cols
+ * @return the current matrix
+ */
+Matrix& Matrix::resize(int rows, int cols)
+{
+    if ((rows <= 0) || (cols <= 0))
+    {
+        std::cerr << STR_INVALID_NUM_ROWS_OR_COLS << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // a view never writes into the memory it looks at
+    int stride = _strideOf(cols, _padded);
+    if ((rows * stride > _capacity) || (!_owner))
+    {
+        if (_owner)
+        {
+            std::free(_2DArray);
+        }
+        _2DArray = _allocate(rows * stride);
+        _capacity = rows * stride;
+        _owner = true;
+    }
+
+    _dims.rows = rows;
+    _dims.cols = cols;
+    _stride = stride;
+    _size = rows * stride;
+
+    // the padding of the rows is zeros, the array may have held rows of another stride. only the
+    // padding is written: an expression assigned to the matrix may still read its cells
+    if (!isPacked())
+    {
+        for (int i = 0; i < rows; i++)
+        {
+            simdFill(_2DArray + (long)i * stride + cols, 0, stride - cols);
+        }
+    }
+
+    return *this;
+}
+
+/**
+ * @brief represents the matrix as a column vector
+ * @return the current matrix represented as column vector
+ */
+Matrix& Matrix::vectorize()
+{
+    // the cells of a padded matrix are packed first, a column vector has no padding
+    if (!isPacked())
+    {
+        *this = Matrix(asView());
+    }
+    _dims.rows = _dims.rows * _dims.cols;
+    _dims.cols = 1;
+    _stride = 1;
+    _padded = false;
+
+    return *this;
+}
+
+/**
+ * @brief assigns and adds the other matrix to the current matrix
+ * @param other - the other matrix
+ * @return - the current matrix after the add and assignment
+ */
+Matrix& Matrix::operator+=(const Matrix& other)
+{
+    if ((_dims.rows != other.getRows()) || (_dims.cols != other.getCols()))
+    {
+        std::cerr << STR_WRONG_SIZES_ASSIGN_ADD << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (isPacked() && other.isPacked())
+    {
+        simdAddInPlace(_2DArray, other._2DArray, _size);
+        return (*this);
+    }
+    for (int i = 0; i < _dims.rows; i++)
+    {
+        simdAddInPlace(row(i), other.row(i), _dims.cols);
+    }
+    return (*this);
+}
+
+/**
+ * @brief prints the error of an add and assignment of different sizes and exits
+ */
+void Matrix::_wrongSizesAssignAdd()
+{
+    std::cerr << STR_WRONG_SIZES_ASSIGN_ADD << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief prints a different sizes error and exits, the failure of an expression whose matrices
+ *        do not have the same sizes
+ */
+void matrixExprWrongSizes()
+{
+    std::cerr << STR_WRONG_SIZES_ADD << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief evaluates a + b with simdAdd
+ * @param expr - the expression
+ * @param out - the matrix to write into
+ */
+void evaluateMatrixExpr(const MatrixSumExpr<Matrix, Matrix>& expr, MatrixView out)
+{
+    const Matrix& left = expr.left();
+    const Matrix& right = expr.right();
+    if (expr.isPacked() && out.isContiguous())
+    {
+        simdAdd(left.data(), right.data(), out.data(), out.getRows() * out.getCols());
+        return;
+    }
+    for (int i = 0; i < out.getRows(); i++)
+    {
+        simdAdd(left.row(i), right.row(i), out.row(i), out.getCols());
+    }
+}
+
+/**
+ * @brief evaluates scalar * a with simdScale
+ * @param expr - the expression
+ * @param out - the matrix to write into
+ */
+void evaluateMatrixExpr(const MatrixScaledExpr<Matrix>& expr, MatrixView out)
+{
+    const Matrix& mat = expr.expr();
+    if (expr.isPacked() && out.isContiguous())
+    {
+        simdScale(mat.data(), expr.scalar(), out.data(), out.getRows() * out.getCols());
+        return;
+    }
+    for (int i = 0; i < out.getRows(); i++)
+    {
+        simdScale(mat.row(i), expr.scalar(), out.row(i), out.getCols());
+    }
+}
+
+/**
+ * @brief evaluates scalar * a + b with simdScaleAdd, row by row unless every matrix is packed
+ * @param scaled - the matrix to scale
+ * @param scalar - the scalar
+ * @param added - the matrix to add
+ * @param out - the matrix to write into
+ */
+static void scaleAddInto(const Matrix& scaled, float scalar, const Matrix& added, MatrixView out)
+{
+    if (scaled.isPacked() && added.isPacked() && out.isContiguous())
+    {
+        simdScaleAdd(scaled.data(), scalar, added.data(), out.data(),
+                     out.getRows() * out.getCols());
+        return;
+    }
+    for (int i = 0; i < out.getRows(); i++)
+    {
+        simdScaleAdd(scaled.row(i), scalar, added.row(i), out.row(i), out.getCols());
+    }
+}
+
+/**
+ * @brief evaluates scalar * a + b with simdScaleAdd
+ * @param expr - the expression
+ * @param out - the matrix to write into
+ */
+void evaluateMatrixExpr(const MatrixSumExpr<MatrixScaledExpr<Matrix>, Matrix>& expr,
+                        MatrixView out)
+{
+    scaleAddInto(expr.left().expr(), expr.left().scalar(), expr.right(), out);
+}
+
+/**
+ * @brief evaluates b + scalar * a with simdScaleAdd
+ * @param expr - the expression
+ * @param out - the matrix to write into
+ */
+void evaluateMatrixExpr(const MatrixSumExpr<Matrix, MatrixScaledExpr<Matrix>>& expr,
+                        MatrixView out)
+{
+    scaleAddInto(expr.right().expr(), expr.right().scalar(), expr.left(), out);
+}
+
+/**
+ * @brief adds a column vector to every column of the current matrix (bias broadcast)
+ * @param vec - the column vector, with the same number of rows as the current matrix
+ * @return - the current matrix after the addition
+ */
+Matrix& Matrix::addColumnVector(const Matrix& vec)
+{
+    if ((_dims.rows != vec.getRows()) || (vec.getCols() != 1))
+    {
+        std::cerr << STR_WRONG_SIZES_ASSIGN_ADD << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (isPacked() && vec.isPacked())
+    {
+        simdAddColumnVector(_2DArray, vec._2DArray, _dims.rows, _dims.cols);
+        return (*this);
+    }
+    for (int i = 0; i < _dims.rows; i++)
+    {
+        simdAddColumnVector(row(i), vec.row(i), 1, _dims.cols);
+    }
+    return (*this);
+}
+
+/**
+ * @brief reads data into mat
+ * @param is - ifstream object
+ * @param mat - the matrix to save the data into
+ */
+std::istream& operator>>(std::istream& is, Matrix& mat)
+{
+    // the whole matrix is read at once, a short stream is an error and not a partial matrix
+    bool read = true;
+    if (mat.isPacked())
+    {
+        read = readFloats(is, mat._2DArray, mat._size);
+    }
+    else
+    {
+        // the rows of a padded matrix are read one by one, around the padding
+        for (int i = 0; (i < mat.getRows()) && read; i++)
+        {
+            read = readFloats(is, mat.row(i), mat.getCols());
+        }
+    }
+    if (!read)
+    {
+        std::cerr << STR_DIFFERENT_SIZES_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return is;
+}
+
+/**
+ * @brief prints the matrix according to a condition
+ * @param out - ostream object
+ * @param mat - the matrix to print
+ * @return - ostream object
+ */
+std::ostream& operator<<(std::ostream& out, Matrix& mat)
+{
+    for (int i = 0; i < mat.getRows(); i++)
+    {
+        const float* row = mat.row(i);
+        for (int j = 0; j < mat.getCols(); j++)
+        {
+            if (row[j] <= 0.1f)
+            {
+                out << "  ";
+            }
+            else
+            {
+                out << "**";
+            }
+        }
+        std::cout << std::endl;
+    }
+    return out;
+}
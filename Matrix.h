@@ -1,186 +1,537 @@
-
-
-// Matrix.h
-#ifndef MATRIX_H
-#define MATRIX_H
-
-#include <iostream>
-
-/**
- * @struct MatrixDims
- * @brief Matrix dimensions container
- */
-typedef struct MatrixDims
-{
-    int rows, cols;
-} MatrixDims;
-
-/**
- * @brief class that represents a matrix
- */
-class Matrix
-{
-public:
-    /**
-     * @brief constructs a matrix with one cell
-     */
-    Matrix();
-
-    /**
-     * @brief constructor for Matrix - creates a matrix object
-     * @param rows - the number of rows of the matrix to create
-     * @param cols - the number of cols of the matrix to create
-     */
-    Matrix(int rows, int cols);
-
-    /**
-     * @brief copy constructor for matrix
-     * @param mat - the other matrix to copy from
-     */
-    Matrix(const Matrix &m);
-
-    /**
-     * @brief destructor for Matrix
-     */
-    ~Matrix();
-
-    /**
-     * @brief multiples two matrices
-     * @param other - the matrix to multiply with the current matrix
-     * @return - a matrix with the result of multiplication
-     */
-    Matrix operator*(const Matrix &other) const;
-
-    /**
-     * @brief adds two matrices
-     * @param other - the other matrix
-     * @return a matrix after the addition
-     */
-    Matrix operator+(const Matrix &other) const;
-
-    /**
-     * @brief multiples the matrix by scalar
-     * @param scalar the scalar
-     * @return a matrix after multiplication by scalar
-     */
-    Matrix operator*(const float &scalar) const;
-
-    /**
-     * @brief assigns and adds the other matrix to the current matrix
-     * @param other - the other matrix
-     * @return - the current matrix after the add and assignment
-     */
-    Matrix &operator+=(const Matrix &other);
-
-    /**
-     * @brief returns the element in the i row, j column
-     * @param i - the row
-     * @param j - the column
-     * @return  - the element in the matrix
-     */
-    float &operator()(const int i, const int j);
-
-    /**
-     * @brief returns the element in the i row, j column
-     * @param i - the row
-     * @param j - the column
-     * @return  - the element in the matrix (const)
-     */
-    const float &operator()(const int i, const int j) const;
-
-    /**
-     * @brief returns the element in the array in the i index
-     * @param i the index
-     * @return the element (non const)
-     */
-    float &operator[](const int i);
-
-    /**
-     * @brief returns the element in the array in the i index
-     * @param i the index
-     * @return the element (const)
-     */
-    const float &operator[](const int i) const;
-
-    /**
-     * @brief assigns the information of other matrix into the current matrix
-     * @param other - the other matrix
-     * @return the current matrix
-     */
-    Matrix &operator=(const Matrix &other);
-
-    /**
-     * @brief returns the number of rows of the array
-     * @return the number of rows
-     */
-    int &getRows();
-
-    /**
-     * @brief returns the number of cols of the array
-     * @return the number of cols
-     */
-    int &getCols();
-
-    /**
-     * @brief returns the number of rows of the array
-     * @return the number of rows
-     */
-    const int &getRows() const;
-
-    /**
-     * @brief returns the number of cols of the array
-     * @return the number of cols
-     */
-    const int &getCols() const;
-
-    /**
-     * @brief prints the matrix array
-     */
-    void plainPrint() const;
-
-    /**
-     * @brief represents the matrix as a column vector
-     * @return the current matrix represented as column vector
-     */
-    Matrix &vectorize();
-
-    /**
-     * @brief multiples scalar by matrix
-     * @param scalar the scalar
-     * @param m the matrix (const)
-     * @return a matrix after the multiplication
-     */
-    friend Matrix operator*(const float &scalar, const Matrix &m);
-
-    /**
-     * @brief prints the matrix according to a condition
-     * @param out - ostream object
-     * @param mat - the matrix to print
-     * @return - ostream object
-     */
-    friend std::ostream &operator<<(std::ostream &out, Matrix &mat);
-
-    /**
-     * @brief reads data into mat
-     * @param is - ifstream object
-     * @param mat - the matrix to save the data into
-     */
-    friend std::istream& operator>>(std::istream& is, Matrix& mat);
-
-    /**
-    * @brief multiples scalar by matrix
-    * @param scalar the scalar
-    * @param m the matrix (const)
-    * @return a matrix after the multiplication
-    */
-    friend Matrix operator*(const float& scalar,  Matrix& m);
-
-private:
-    MatrixDims _dims;
-    float *_2DArray;
-    int _size;
-};
-
-#endif //MATRIX_H
-
-
+
+
+// Matrix.h
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include "MatrixExpr.h"
+#include "MatrixView.h"
+#include <iostream>
+#include <utility>
+
+class ThreadPool;
+
+#define MATRIX_ALIGNMENT 64 // the alignment of the arrays in bytes, a cache line
+#define MATRIX_ALIGNMENT_FLOATS (MATRIX_ALIGNMENT / (int)sizeof(float))
+
+/**
+ * @enum MatrixLayout
+ * @brief how the rows of a matrix are laid out: packed one after the other, or padded so every
+ *        row starts on a cache line (the stride is the cols rounded up to MATRIX_ALIGNMENT, and
+ *        the padding is zeros), so the vector loads of a row never straddle two lines
+ */
+enum MatrixLayout
+{
+    LayoutPacked,
+    LayoutPadded
+};
+
+/**
+ * @struct MatrixDims
+ * @brief Matrix dimensions container
+ */
+typedef struct MatrixDims
+{
+    int rows, cols;
+} MatrixDims;
+
+/**
+ * @brief class that represents a matrix. a + b, scalar * a and their chains are expressions
+ *        (see MatrixExpr.h) that are evaluated into the matrix they are assigned to, in one
+ *        pass and with no temporary matrices
+ */
+class Matrix : public MatrixExpr<Matrix>
+{
+public:
+    /**
+     * @brief constructs a matrix with one cell
+     */
+    Matrix();
+
+    /**
+     * @brief constructor for Matrix - creates a matrix object
+     * @param rows - the number of rows of the matrix to create
+     * @param cols - the number of cols of the matrix to create
+     */
+    Matrix(int rows, int cols);
+
+    /**
+     * @brief constructor for Matrix - creates a matrix object of a layout
+     * @param rows - the number of rows of the matrix to create
+     * @param cols - the number of cols of the matrix to create
+     * @param layout - packed rows, or rows padded to MATRIX_ALIGNMENT
+     */
+    Matrix(int rows, int cols, MatrixLayout layout);
+
+    /**
+     * @brief copy constructor for matrix
+     * @param mat - the other matrix to copy from
+     */
+    Matrix(const Matrix &m);
+
+    /**
+     * @brief constructor for Matrix - copies the cells of a view into an array of its own
+     * @param view - the view, of any stride
+     */
+    explicit Matrix(ConstMatrixView view);
+
+    /**
+     * @brief move constructor for matrix, takes the array of the other matrix without copying
+     * @param mat - the other matrix, left empty
+     */
+    Matrix(Matrix &&mat) noexcept;
+
+    /**
+     * @brief constructor for Matrix - evaluates an expression (like scalar * a + b) into a
+     *        matrix of its sizes, in one pass
+     * @param expr - the expression
+     */
+    template <typename E>
+    Matrix(const MatrixExpr<E> &expr): Matrix(expr.self().getRows(), expr.self().getCols())
+    {
+        evaluateMatrixExpr(expr.self(), asView());
+    }
+
+    /**
+     * @brief destructor for Matrix
+     */
+    ~Matrix();
+
+    /**
+     * @brief creates a read-only matrix over memory it does not own (like a mapped model file),
+     *        without copying. the memory must outlive the matrix. a copy of a view owns its
+     *        array, and resizing or assigning into a view gives it an array of its own
+     * @param data - the cells, row after row
+     * @param rows - the number of rows
+     * @param cols - the number of cols
+     * @return the view
+     */
+    static Matrix view(const float *data, int rows, int cols);
+
+    /**
+     * @brief creates a read-only matrix over memory it does not own, whose rows are stride
+     *        floats apart (like padded weights), without copying. the memory must outlive the
+     *        matrix
+     * @param data - the cells, row after row
+     * @param rows - the number of rows
+     * @param cols - the number of cols
+     * @param stride - the distance between two rows, at least cols
+     * @return the view
+     */
+    static Matrix view(const float *data, int rows, int cols, int stride);
+
+    /**
+     * @brief returns true if the matrix is a view over memory it does not own
+     * @return true for a view
+     */
+    bool isView() const;
+
+    /**
+     * @brief returns a view of the whole matrix, to slice without copying or to pass to the
+     *        kernels. it is valid until the matrix is resized, assigned into or destroyed
+     * @return the view
+     */
+    MatrixView asView();
+
+    /**
+     * @brief returns a read-only view of the whole matrix, to slice without copying or to pass
+     *        to the kernels. it is valid until the matrix is resized, assigned into or destroyed
+     * @return the view
+     */
+    ConstMatrixView asView() const;
+
+    /**
+     * @brief multiples two matrices
+     * @param other - the matrix to multiply with the current matrix
+     * @return - a matrix with the result of multiplication
+     */
+    Matrix operator*(const Matrix &other) const;
+
+    /**
+     * @brief multiples two matrices, splitting the rows of the result between threads
+     * @param other - the matrix to multiply with the current matrix
+     * @param pool - the thread pool, or nullptr to run on the calling thread
+     * @return - a matrix with the result of multiplication
+     */
+    Matrix multiply(const Matrix &other, ThreadPool *pool) const;
+
+    /**
+     * @brief multiples two matrices into a result matrix, reusing its array when it is big enough
+     * @param other - the matrix to multiply with the current matrix
+     * @param temp - the matrix to write the result into (not the current matrix or other)
+     * @param pool - the thread pool, or nullptr to run on the calling thread
+     * @return - the result matrix
+     */
+    Matrix &multiply(const Matrix &other, Matrix &temp, ThreadPool *pool) const;
+
+    /**
+     * @brief assigns and adds the other matrix to the current matrix
+     * @param other - the other matrix
+     * @return - the current matrix after the add and assignment
+     */
+    Matrix &operator+=(const Matrix &other);
+
+    /**
+     * @brief assigns and adds an expression to the current matrix, in one pass
+     * @param expr - the expression, with the sizes of the current matrix
+     * @return - the current matrix after the add and assignment
+     */
+    template <typename E>
+    Matrix &operator+=(const MatrixExpr<E> &expr)
+    {
+        if ((_dims.rows != expr.self().getRows()) || (_dims.cols != expr.self().getCols()))
+        {
+            _wrongSizesAssignAdd();
+        }
+        evaluateMatrixExpr(MatrixSumExpr<Matrix, E>(*this, expr.self()), asView());
+        return *this;
+    }
+
+    /**
+     * @brief adds a column vector to every column of the current matrix (bias broadcast)
+     * @param vec - the column vector, with the same number of rows as the current matrix
+     * @return - the current matrix after the addition
+     */
+    Matrix &addColumnVector(const Matrix &vec);
+
+    /**
+     * @brief returns the element in the i row, j column. the index is checked only in the builds
+     *        with MLP_BOUNDS_CHECK (debug and sanitize), a release build indexes without a branch
+     * @param i - the row
+     * @param j - the column
+     * @return  - the element in the matrix
+     */
+    float &operator()(const int i, const int j)
+    {
+#ifdef MLP_BOUNDS_CHECK
+        _checkIndex(i, j);
+#endif
+        return _2DArray[i * _stride + j];
+    }
+
+    /**
+     * @brief returns the element in the i row, j column. the index is checked only in the builds
+     *        with MLP_BOUNDS_CHECK (debug and sanitize), a release build indexes without a branch
+     * @param i - the row
+     * @param j - the column
+     * @return  - the element in the matrix (const)
+     */
+    const float &operator()(const int i, const int j) const
+    {
+#ifdef MLP_BOUNDS_CHECK
+        _checkIndex(i, j);
+#endif
+        return _2DArray[i * _stride + j];
+    }
+
+    /**
+     * @brief returns the element in the i index, counting the cells row after row (the padding
+     *        of the rows of a padded matrix is skipped, so the index means the same cell in
+     *        every layout). the index is checked only in the builds with MLP_BOUNDS_CHECK
+     *        (debug and sanitize)
+     * @param i the index
+     * @return the element (non const)
+     */
+    float &operator[](const int i)
+    {
+#ifdef MLP_BOUNDS_CHECK
+        _checkIndex(i);
+#endif
+        return _2DArray[isPacked() ? i : ((i / _dims.cols) * _stride + i % _dims.cols)];
+    }
+
+    /**
+     * @brief returns the element in the i index, counting the cells row after row (the padding
+     *        of the rows of a padded matrix is skipped, so the index means the same cell in
+     *        every layout). the index is checked only in the builds with MLP_BOUNDS_CHECK
+     *        (debug and sanitize)
+     * @param i the index
+     * @return the element (const)
+     */
+    const float &operator[](const int i) const
+    {
+#ifdef MLP_BOUNDS_CHECK
+        _checkIndex(i);
+#endif
+        return _2DArray[isPacked() ? i : ((i / _dims.cols) * _stride + i % _dims.cols)];
+    }
+
+    /**
+     * @brief returns the element in the i row, j column, checked in every build. prints an
+     *        error and exits if the index is out of the matrix
+     * @param i - the row
+     * @param j - the column
+     * @return  - the element in the matrix
+     */
+    float &at(const int i, const int j);
+
+    /**
+     * @brief returns the element in the i row, j column, checked in every build. prints an
+     *        error and exits if the index is out of the matrix
+     * @param i - the row
+     * @param j - the column
+     * @return  - the element in the matrix (const)
+     */
+    const float &at(const int i, const int j) const;
+
+    /**
+     * @brief returns the first cell of a row, for loops that go over the row with a pointer.
+     *        the row is checked only in the builds with MLP_BOUNDS_CHECK
+     * @param i - the row
+     * @return the first cell of the row (non const)
+     */
+    float *row(const int i)
+    {
+#ifdef MLP_BOUNDS_CHECK
+        _checkIndex(i, 0);
+#endif
+        return _2DArray + i * _stride;
+    }
+
+    /**
+     * @brief returns the first cell of a row, for loops that go over the row with a pointer.
+     *        the row is checked only in the builds with MLP_BOUNDS_CHECK
+     * @param i - the row
+     * @return the first cell of the row (const)
+     */
+    const float *row(const int i) const
+    {
+#ifdef MLP_BOUNDS_CHECK
+        _checkIndex(i, 0);
+#endif
+        return _2DArray + i * _stride;
+    }
+
+    /**
+     * @brief returns an iterator to the first cell, the cells go row after row as they are
+     *        stored (with the padding of the rows of a padded matrix)
+     * @return the iterator (non const)
+     */
+    float *begin()
+    {
+        return _2DArray;
+    }
+
+    /**
+     * @brief returns an iterator to the first cell, the cells go row after row as they are
+     *        stored (with the padding of the rows of a padded matrix)
+     * @return the iterator (const)
+     */
+    const float *begin() const
+    {
+        return _2DArray;
+    }
+
+    /**
+     * @brief returns an iterator past the last cell
+     * @return the iterator (non const)
+     */
+    float *end()
+    {
+        return _2DArray + _size;
+    }
+
+    /**
+     * @brief returns an iterator past the last cell
+     * @return the iterator (const)
+     */
+    const float *end() const
+    {
+        return _2DArray + _size;
+    }
+
+    /**
+     * @brief assigns the information of other matrix into the current matrix
+     * @param other - the other matrix
+     * @return the current matrix
+     */
+    Matrix &operator=(const Matrix &other);
+
+    /**
+     * @brief moves the information of other matrix into the current matrix, without copying
+     * @param other - the other matrix, gets the array of the current matrix
+     * @return the current matrix
+     */
+    Matrix &operator=(Matrix &&other) noexcept;
+
+    /**
+     * @brief evaluates an expression into the current matrix, in one pass. the current array is
+     *        reused when it is big enough, and the expression may read the current matrix
+     *        (a = scalar * a + b). a padded matrix stays padded
+     * @param expr - the expression
+     * @return the current matrix
+     */
+    template <typename E>
+    Matrix &operator=(const MatrixExpr<E> &expr)
+    {
+        int rows = expr.self().getRows();
+        int cols = expr.self().getCols();
+
+        // a view or a small array gets a new array of the same layout, the expression reads
+        // the old one
+        if ((!_owner) || (rows * _strideOf(cols, _padded) > _capacity))
+        {
+            Matrix result(rows, cols, _padded ? LayoutPadded : LayoutPacked);
+            evaluateMatrixExpr(expr.self(), result.asView());
+            return *this = std::move(result);
+        }
+        resize(rows, cols);
+        evaluateMatrixExpr(expr.self(), asView());
+        return *this;
+    }
+
+    /**
+     * @brief changes the dimensions of the matrix. allocates only when the matrix has fewer cells
+     *        than needed, the values of the cells are not kept
+     * @param rows - the new number of rows
+     * @param cols - the new number of cols
+     * @return the current matrix
+     */
+    Matrix &resize(int rows, int cols);
+
+    /**
+     * @brief returns the number of rows of the array
+     * @return the number of rows
+     */
+    int &getRows()
+    {
+        return _dims.rows;
+    }
+
+    /**
+     * @brief returns the number of cols of the array
+     * @return the number of cols
+     */
+    int &getCols()
+    {
+        return _dims.cols;
+    }
+
+    /**
+     * @brief returns the number of rows of the array
+     * @return the number of rows
+     */
+    const int &getRows() const
+    {
+        return _dims.rows;
+    }
+
+    /**
+     * @brief returns the number of cols of the array
+     * @return the number of cols
+     */
+    const int &getCols() const
+    {
+        return _dims.cols;
+    }
+
+    /**
+     * @brief returns the distance between two rows of the array, the cols of a packed matrix
+     * @return the stride
+     */
+    int getStride() const
+    {
+        return _stride;
+    }
+
+    /**
+     * @brief returns true if the rows follow one another with no padding, so the cells are
+     *        getRows()*getCols() floats one after the other
+     * @return true for a packed matrix
+     */
+    bool isPacked() const
+    {
+        return _stride == _dims.cols;
+    }
+
+    /**
+     * @brief returns the array of the matrix, row after row with the stride
+     * @return the array (non const)
+     */
+    float *data()
+    {
+        return _2DArray;
+    }
+
+    /**
+     * @brief returns the array of the matrix, row after row with the stride
+     * @return the array (const)
+     */
+    const float *data() const
+    {
+        return _2DArray;
+    }
+
+    /**
+     * @brief prints the matrix array
+     */
+    void plainPrint() const;
+
+    /**
+     * @brief represents the matrix as a column vector
+     * @return the current matrix represented as column vector
+     */
+    Matrix &vectorize();
+
+    /**
+     * @brief prints the matrix according to a condition
+     * @param out - ostream object
+     * @param mat - the matrix to print
+     * @return - ostream object
+     */
+    friend std::ostream &operator<<(std::ostream &out, Matrix &mat);
+
+    /**
+     * @brief reads data into mat
+     * @param is - ifstream object
+     * @param mat - the matrix to save the data into
+     */
+    friend std::istream& operator>>(std::istream& is, Matrix& mat);
+
+private:
+    void _checkIndex(int i, int j) const;
+    void _checkIndex(int i) const;
+    [[noreturn]] static void _wrongSizesAssignAdd();
+    static int _strideOf(int cols, bool padded);
+    static float *_allocate(int cells);
+    void _copyRows(const Matrix &other);
+    MatrixDims _dims;
+    float *_2DArray;
+    int _size;     // the number of cells stored, with the padding of the rows
+    int _capacity; // the number of cells allocated, at least _size
+    int _stride;   // the distance between two rows, at least the cols
+    bool _padded;  // true if the rows are padded to MATRIX_ALIGNMENT
+    bool _owner;   // false for a view, whose array is not freed
+};
+
+// the members of MatrixExpr that evaluate it, they need the whole Matrix
+
+template <typename E>
+Matrix MatrixExpr<E>::eval() const
+{
+    return Matrix(self());
+}
+
+template <typename E>
+Matrix MatrixExpr<E>::vectorize() const
+{
+    Matrix result = eval();
+    result.vectorize();
+    return result;
+}
+
+template <typename E>
+void MatrixExpr<E>::plainPrint() const
+{
+    eval().plainPrint();
+}
+
+template <typename E>
+Matrix MatrixExpr<E>::operator*(const Matrix &other) const
+{
+    return eval() * other;
+}
+
+#endif //MATRIX_H
+
+
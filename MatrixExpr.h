@@ -0,0 +1,366 @@
+
+//MatrixExpr.h
+
+#ifndef MATRIXEXPR_H
+#define MATRIXEXPR_H
+
+#include "MatrixView.h"
+
+class Matrix;
+
+/**
+ * @brief prints a different sizes error and exits, the failure of an expression whose matrices
+ *        do not have the same sizes
+ */
+[[noreturn]] void matrixExprWrongSizes();
+
+/**
+ * @brief the base of the element-wise matrix expressions (a + b, scalar * a and their chains).
+ *        an expression is not computed where it is written: it builds a small tree of nodes,
+ *        and the matrix it is assigned to evaluates the tree in one pass over its cells, with
+ *        no temporary matrices. a node holds references to its matrices, so an expression must
+ *        be evaluated in the statement that builds it, and not kept in an auto variable
+ * @tparam E - the type of the node (the expression derives from MatrixExpr<E>)
+ */
+template <typename E>
+class MatrixExpr
+{
+public:
+    /**
+     * @brief returns the node as its own type
+     * @return the node
+     */
+    const E& self() const
+    {
+        return static_cast<const E&>(*this);
+    }
+
+    // the members of Matrix that a result of a + b or scalar * a had before the expressions, so
+    // a caller that used them on the result still compiles. every one evaluates the expression
+    // into a new matrix first (see Matrix.h)
+
+    /**
+     * @brief evaluates the expression into a new matrix
+     * @return the matrix
+     */
+    Matrix eval() const;
+
+    /**
+     * @brief evaluates the expression and represents it as a column vector
+     * @return the result as a column vector
+     */
+    Matrix vectorize() const;
+
+    /**
+     * @brief evaluates the expression and prints it, like Matrix::plainPrint
+     */
+    void plainPrint() const;
+
+    /**
+     * @brief evaluates the expression and multiples it with a matrix
+     * @param other - the matrix to multiply with the result of the expression
+     * @return - a matrix with the result of multiplication
+     */
+    Matrix operator*(const Matrix &other) const;
+};
+
+/**
+ * @brief how a node keeps one of its operands: a node by value (it is a small temporary of the
+ *        statement), a matrix by reference
+ * @tparam E - the type of the operand
+ */
+template <typename E>
+struct MatrixExprStorage
+{
+    typedef E type;
+};
+
+template <>
+struct MatrixExprStorage<Matrix>
+{
+    typedef const Matrix& type;
+};
+
+/**
+ * @brief the node of left + right
+ * @tparam L - the type of the left operand
+ * @tparam R - the type of the right operand
+ */
+template <typename L, typename R>
+class MatrixSumExpr : public MatrixExpr<MatrixSumExpr<L, R>>
+{
+public:
+    /**
+     * @brief constructor for a sum. prints an error and exits if the sizes are different
+     * @param left - the left operand
+     * @param right - the right operand
+     */
+    MatrixSumExpr(const L& left, const R& right): _left(left), _right(right)
+    {
+        if ((left.getRows() != right.getRows()) || (left.getCols() != right.getCols()))
+        {
+            matrixExprWrongSizes();
+        }
+    }
+
+    /**
+     * @brief returns the number of rows of the result
+     * @return the number of rows
+     */
+    int getRows() const
+    {
+        return _left.getRows();
+    }
+
+    /**
+     * @brief returns the number of cols of the result
+     * @return the number of cols
+     */
+    int getCols() const
+    {
+        return _left.getCols();
+    }
+
+    /**
+     * @brief returns true if all the matrices of the expression are packed, so the cells can be
+     *        read by a flat index
+     * @return true if the matrices are packed
+     */
+    bool isPacked() const
+    {
+        return _left.isPacked() && _right.isPacked();
+    }
+
+    /**
+     * @brief returns the cell in the i index of the result, when the matrices are packed
+     * @param i - the index, row after row
+     * @return the cell
+     */
+    float operator[](int i) const
+    {
+        return _left[i] + _right[i];
+    }
+
+    /**
+     * @brief returns the cell in the i row, j column of the result
+     * @param i - the row
+     * @param j - the column
+     * @return the cell
+     */
+    float operator()(int i, int j) const
+    {
+        return _left(i, j) + _right(i, j);
+    }
+
+    /**
+     * @brief returns the left operand
+     * @return the left operand
+     */
+    const L& left() const
+    {
+        return _left;
+    }
+
+    /**
+     * @brief returns the right operand
+     * @return the right operand
+     */
+    const R& right() const
+    {
+        return _right;
+    }
+
+private:
+    typename MatrixExprStorage<L>::type _left;
+    typename MatrixExprStorage<R>::type _right;
+};
+
+/**
+ * @brief the node of scalar * expr
+ * @tparam E - the type of the scaled operand
+ */
+template <typename E>
+class MatrixScaledExpr : public MatrixExpr<MatrixScaledExpr<E>>
+{
+public:
+    /**
+     * @brief constructor for a scaled expression
+     * @param expr - the operand
+     * @param scalar - the scalar
+     */
+    MatrixScaledExpr(const E& expr, float scalar): _expr(expr), _scalar(scalar)
+    {
+    }
+
+    /**
+     * @brief returns the number of rows of the result
+     * @return the number of rows
+     */
+    int getRows() const
+    {
+        return _expr.getRows();
+    }
+
+    /**
+     * @brief returns the number of cols of the result
+     * @return the number of cols
+     */
+    int getCols() const
+    {
+        return _expr.getCols();
+    }
+
+    /**
+     * @brief returns true if all the matrices of the expression are packed, so the cells can be
+     *        read by a flat index
+     * @return true if the matrices are packed
+     */
+    bool isPacked() const
+    {
+        return _expr.isPacked();
+    }
+
+    /**
+     * @brief returns the cell in the i index of the result, when the matrices are packed
+     * @param i - the index, row after row
+     * @return the cell
+     */
+    float operator[](int i) const
+    {
+        return _expr[i] * _scalar;
+    }
+
+    /**
+     * @brief returns the cell in the i row, j column of the result
+     * @param i - the row
+     * @param j - the column
+     * @return the cell
+     */
+    float operator()(int i, int j) const
+    {
+        return _expr(i, j) * _scalar;
+    }
+
+    /**
+     * @brief returns the scaled operand
+     * @return the operand
+     */
+    const E& expr() const
+    {
+        return _expr;
+    }
+
+    /**
+     * @brief returns the scalar
+     * @return the scalar
+     */
+    float scalar() const
+    {
+        return _scalar;
+    }
+
+private:
+    typename MatrixExprStorage<E>::type _expr;
+    float _scalar;
+};
+
+/**
+ * @brief adds two matrices or expressions, lazily
+ * @param left - the left operand
+ * @param right - the right operand
+ * @return the expression of the sum
+ */
+template <typename L, typename R>
+MatrixSumExpr<L, R> operator+(const MatrixExpr<L>& left, const MatrixExpr<R>& right)
+{
+    return MatrixSumExpr<L, R>(left.self(), right.self());
+}
+
+/**
+ * @brief multiples a matrix or an expression by a scalar, lazily
+ * @param expr - the operand
+ * @param scalar - the scalar
+ * @return the expression of the product
+ */
+template <typename E>
+MatrixScaledExpr<E> operator*(const MatrixExpr<E>& expr, float scalar)
+{
+    return MatrixScaledExpr<E>(expr.self(), scalar);
+}
+
+/**
+ * @brief multiples a scalar by a matrix or an expression, lazily
+ * @param scalar - the scalar
+ * @param expr - the operand
+ * @return the expression of the product
+ */
+template <typename E>
+MatrixScaledExpr<E> operator*(float scalar, const MatrixExpr<E>& expr)
+{
+    return MatrixScaledExpr<E>(expr.self(), scalar);
+}
+
+/**
+ * @brief evaluates an expression into a matrix, in one loop over the cells that the compiler
+ *        inlines the whole tree into. packed matrices are gone over by a flat index, padded ones
+ *        row by row
+ * @param expr - the expression
+ * @param out - the matrix to write into, of the sizes of the expression. it may be a matrix of
+ *        the expression (every cell is read before it is written)
+ */
+template <typename E>
+void evaluateMatrixExpr(const E& expr, MatrixView out)
+{
+    if (expr.isPacked() && out.isContiguous())
+    {
+        float* cells = out.data();
+        int size = out.getRows() * out.getCols();
+        for (int i = 0; i < size; i++)
+        {
+            cells[i] = expr[i];
+        }
+        return;
+    }
+    for (int i = 0; i < out.getRows(); i++)
+    {
+        float* row = out.row(i);
+        for (int j = 0; j < out.getCols(); j++)
+        {
+            row[j] = expr(i, j);
+        }
+    }
+}
+
+// the shapes that have a simd kernel of their own (see SimdKernels.h) are evaluated with it
+
+/**
+ * @brief evaluates a + b with simdAdd
+ * @param expr - the expression
+ * @param out - the matrix to write into
+ */
+void evaluateMatrixExpr(const MatrixSumExpr<Matrix, Matrix>& expr, MatrixView out);
+
+/**
+ * @brief evaluates scalar * a with simdScale
+ * @param expr - the expression
+ * @param out - the matrix to write into
+ */
+void evaluateMatrixExpr(const MatrixScaledExpr<Matrix>& expr, MatrixView out);
+
+/**
+ * @brief evaluates scalar * a + b with simdScaleAdd
+ * @param expr - the expression
+ * @param out - the matrix to write into
+ */
+void evaluateMatrixExpr(const MatrixSumExpr<MatrixScaledExpr<Matrix>, Matrix>& expr,
+                        MatrixView out);
+
+/**
+ * @brief evaluates b + scalar * a with simdScaleAdd
+ * @param expr - the expression
+ * @param out - the matrix to write into
+ */
+void evaluateMatrixExpr(const MatrixSumExpr<Matrix, MatrixScaledExpr<Matrix>>& expr,
+                        MatrixView out);
+
+#endif //MATRIXEXPR_H
@@ -0,0 +1,220 @@
+
+//MatrixView.h
+
+#ifndef MATRIXVIEW_H
+#define MATRIXVIEW_H
+
+#include <type_traits>
+
+// the accessors of Matrix and MatrixView check their bounds only when MLP_BOUNDS_CHECK is
+// defined: in every build without NDEBUG (debug, sanitize), or when it is set by hand. a
+// release build indexes without a branch, so the loops over the cells can vectorize
+#if !defined(NDEBUG) && !defined(MLP_BOUNDS_CHECK)
+#define MLP_BOUNDS_CHECK
+#endif
+
+/**
+ * @brief prints an out of bounds error and exits, the failure of a checked accessor
+ */
+[[noreturn]] void matrixOutOfBounds();
+
+/**
+ * @brief class that represents a view of a row-major matrix in memory it does not own: a
+ *        pointer to the first cell, the rows, the cols and the stride (the distance between
+ *        two rows, at least the cols). a view is as cheap to copy as a pointer, and slicing it
+ *        gives views of the same memory: some of the rows, some of the cols (a sub-batch of
+ *        images, one per col) or a block. the memory must outlive the view
+ * @tparam T - float for a view that writes, const float for a read-only view
+ */
+template <typename T>
+class BasicMatrixView
+{
+public:
+    /**
+     * @brief constructs an empty view
+     */
+    BasicMatrixView(): _data(nullptr), _rows(0), _cols(0), _stride(0)
+    {
+    }
+
+    /**
+     * @brief constructor for a view of contiguous rows
+     * @param data - the first cell
+     * @param rows - the number of rows
+     * @param cols - the number of cols
+     */
+    BasicMatrixView(T* data, int rows, int cols): _data(data), _rows(rows), _cols(cols),
+                                                  _stride(cols)
+    {
+    }
+
+    /**
+     * @brief constructor for a view
+     * @param data - the first cell
+     * @param rows - the number of rows
+     * @param cols - the number of cols
+     * @param stride - the distance between two rows, at least cols
+     */
+    BasicMatrixView(T* data, int rows, int cols, int stride): _data(data), _rows(rows),
+                                                              _cols(cols), _stride(stride)
+    {
+    }
+
+    /**
+     * @brief converts a view that writes into a read-only view
+     * @param other - the view
+     */
+    template <typename U, typename = typename std::enable_if<
+              std::is_convertible<U*, T*>::value>::type>
+    BasicMatrixView(const BasicMatrixView<U>& other): _data(other.data()),
+                                                      _rows(other.getRows()),
+                                                      _cols(other.getCols()),
+                                                      _stride(other.getStride())
+    {
+    }
+
+    /**
+     * @brief returns the first cell
+     * @return the first cell
+     */
+    T* data() const
+    {
+        return _data;
+    }
+
+    /**
+     * @brief returns the number of rows
+     * @return the number of rows
+     */
+    int getRows() const
+    {
+        return _rows;
+    }
+
+    /**
+     * @brief returns the number of cols
+     * @return the number of cols
+     */
+    int getCols() const
+    {
+        return _cols;
+    }
+
+    /**
+     * @brief returns the distance between two rows
+     * @return the stride
+     */
+    int getStride() const
+    {
+        return _stride;
+    }
+
+    /**
+     * @brief returns true if the rows follow one another with no gap, like a Matrix
+     * @return true if the stride is the cols (or there is one row)
+     */
+    bool isContiguous() const
+    {
+        return (_stride == _cols) || (_rows <= 1);
+    }
+
+    /**
+     * @brief returns the element in the i row, j column
+     * @param i - the row
+     * @param j - the column
+     * @return the element
+     */
+    T& operator()(int i, int j) const
+    {
+#ifdef MLP_BOUNDS_CHECK
+        _check(i, j, 1, 1);
+#endif
+        return _data[(long)i * _stride + j];
+    }
+
+    /**
+     * @brief returns the first cell of a row
+     * @param i - the row
+     * @return the first cell of the row
+     */
+    T* row(int i) const
+    {
+#ifdef MLP_BOUNDS_CHECK
+        _check(i, 0, 1, 0);
+#endif
+        return _data + (long)i * _stride;
+    }
+
+    /**
+     * @brief returns a view of some of the rows, they must lie inside the view
+     * @param from - the first row
+     * @param count - the number of rows
+     * @return the view of the rows
+     */
+    BasicMatrixView rowRange(int from, int count) const
+    {
+#ifdef MLP_BOUNDS_CHECK
+        _check(from, 0, count, 0);
+#endif
+        return BasicMatrixView(_data + (long)from * _stride, count, _cols, _stride);
+    }
+
+    /**
+     * @brief returns a view of some of the cols (a sub-batch of images), they must lie inside
+     *        the view
+     * @param from - the first col
+     * @param count - the number of cols
+     * @return the view of the cols
+     */
+    BasicMatrixView colRange(int from, int count) const
+    {
+#ifdef MLP_BOUNDS_CHECK
+        _check(0, from, 0, count);
+#endif
+        return BasicMatrixView(_data + from, _rows, count, _stride);
+    }
+
+    /**
+     * @brief returns a view of a block, it must lie inside the view
+     * @param i - the first row
+     * @param j - the first col
+     * @param rows - the number of rows
+     * @param cols - the number of cols
+     * @return the view of the block
+     */
+    BasicMatrixView block(int i, int j, int rows, int cols) const
+    {
+#ifdef MLP_BOUNDS_CHECK
+        _check(i, j, rows, cols);
+#endif
+        return BasicMatrixView(_data + (long)i * _stride + j, rows, cols, _stride);
+    }
+
+private:
+    /**
+     * @brief checks that a block of rows*cols cells from the i row, j column lies inside the
+     *        view. prints an error and exits if it does not
+     * @param i - the first row
+     * @param j - the first col
+     * @param rows - the number of rows
+     * @param cols - the number of cols
+     */
+    void _check(int i, int j, int rows, int cols) const
+    {
+        if ((i < 0) || (j < 0) || (rows < 0) || (cols < 0) || (i + rows > _rows) ||
+            (j + cols > _cols))
+        {
+            matrixOutOfBounds();
+        }
+    }
+
+    T* _data;
+    int _rows;
+    int _cols;
+    int _stride; // the distance between two rows
+};
+
+typedef BasicMatrixView<float> MatrixView;
+typedef BasicMatrixView<const float> ConstMatrixView;
+
+#endif //MATRIXVIEW_H
@@ -1,114 +1,717 @@
-/**
-* @file   MlpNetwork.cpp
-* @brief a program that implements MlpNetwork.h. represents and creates a mlpnetwork
-* @section DESCRIPTION a program that implements MlpNetwork.h.
-*/
-
-// -------------------------------------- includes ------------------------------------------------
-#include "MlpNetwork.h"
-
-#define ERROR_WRONG_SIZE_WEIGHTS "Error: different sizes weights matrix"
-#define ERROR_WRONG_SIZE_BIASES  "Error: different sizes biases matrix"
-
-// ------------------------------------------- function declaration -------------------------------
-
-/**
- * @brief constructor for mlpnetwork
- * @param weights an array of weights matrices
- * @param biases an array of biases matrices
- */
-MlpNetwork::MlpNetwork(Matrix weights[], Matrix biases[]):_denseArr
-                  {
-                       Dense(weights[0], biases[0], Relu),
-                       Dense(weights[1], biases[1], Relu),
-                       Dense(weights[2], biases[2], Relu),
-                       Dense(weights[3], biases[3], Softmax)
-                  }
-{
-    if (!(_checkSizeOfWeightsMatrix(weights)))
-    {
-        std::cerr << ERROR_WRONG_SIZE_WEIGHTS << std::endl;
-        exit(EXIT_FAILURE);
-    }
-
-    if (!(_checkSizeOfBiasMatrix(biases)))
-    {
-        std::cerr << ERROR_WRONG_SIZE_BIASES << std::endl;
-        exit(EXIT_FAILURE);
-    }
-}
-
-bool MlpNetwork::_checkSizeOfWeightsMatrix(Matrix weights[])
-{
-    // Checks for each matrix in the weights array if her size matches the needed size according
-    // to the number of the dense
-    for (int index = 0; index < MLP_SIZE; index++)
-    {
-        Matrix weightsByIndex = weights[index];
-        MatrixDims matDims = weightsDims[index];
-
-        if ((weightsByIndex.getRows() != matDims.rows) || (weightsByIndex.getCols() != matDims.cols))
-        {
-            return false;
-        }
-    }
-    return true;
-}
-
-bool MlpNetwork::_checkSizeOfBiasMatrix(Matrix biases[])
-{
-    // Checks for each matrix in the weights array if her size matches the needed size according
-    // to the number of the dense
-    for (int index = 0; index < MLP_SIZE; index++)
-    {
-        Matrix biasByIndex = biases[index];
-        MatrixDims matDims = biasDims[index];
-
-        if ((biasByIndex.getRows() != matDims.rows) || (biasByIndex.getCols() != matDims.cols))
-        {
-            return false;
-        }
-    }
-    return true;
-}
-
-
-/**
- * @brief Gets a vector representing an image
- *        performs the mlpnetwork's functions on the input vector
- *        returns a digit struct with the number on the picture
- * @param inputVector - the input vector, at size 784*1.
- * @return digit struct with the probability and index of the number in the picture
- */
-Digit MlpNetwork::operator()(Matrix inputVector)
-{
-    // check the size of input
-
-    Matrix inputForNextDense = inputVector; // the input vector
-
-    // Goes over the denses in the network, for each dense performs activation function
-    for (Dense& i : _denseArr)
-    {
-        inputForNextDense = i(inputForNextDense);
-    }
-
-    float maxProbability = 0;
-    unsigned int maxIndex = 0;
-
-    // Goes over the matrix and saves the index with the highest probability
-    // the index represents the number that is on the input picture
-    for (int i = 0; i < inputForNextDense.getRows() * inputForNextDense.getCols(); i++)
-    {
-        if (inputForNextDense[i] > maxProbability)
-        {
-            maxProbability = inputForNextDense[i];
-            maxIndex = i;
-        }
-    }
-
-    Digit newDigit;
-    newDigit.probability = maxProbability; // the probability
-    newDigit.value = maxIndex; // the number in the array represents the picture received
-
-    return newDigit;
-}
+/**
+* @file   MlpNetwork.cpp
+* @brief a program that implements MlpNetwork.h. represents and creates a mlpnetwork
+* @section DESCRIPTION a program that implements MlpNetwork.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "MlpNetwork.h"
+#include "Gemm.h"
+#include "InferenceWorkspace.h"
+#include "Profiler.h"
+#include "SimdKernels.h"
+#include <algorithm>
+#include <cstdlib>
+
+#define ERROR_WRONG_SIZE_WEIGHTS "Error: different sizes weights matrix"
+#define ERROR_WRONG_SIZE_BIASES  "Error: different sizes biases matrix"
+#define ERROR_WRONG_SIZE_INPUT   "Error: different sizes input matrix"
+#define ERROR_WRONG_LAYERS       "Error: the sizes of the denses do not chain"
+#define ERROR_ALLOCATION         "Error: memory allocation didn't work"
+#define ERROR_WRONG_K            "Error: k must be between 1 and the number of classes"
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief rounds a number of floats up to whole cache lines, so every array (and every row of
+ *        the weights) of the slab starts on one
+ * @param size - the number of floats
+ * @return the rounded number of floats
+ */
+static size_t alignFloats(size_t size)
+{
+    return ((size + MATRIX_ALIGNMENT_FLOATS - 1) / MATRIX_ALIGNMENT_FLOATS) *
+           MATRIX_ALIGNMENT_FLOATS;
+}
+
+/**
+ * @brief returns the number of floats the panels of a dense take in the panels of a network,
+ *        rounded up to whole cache lines
+ * @param rows - the rows of the weights
+ * @param cols - the cols of the weights
+ * @return the number of floats
+ */
+static size_t panelsFloats(int rows, int cols)
+{
+    return alignFloats(packedPanelsSize(rows, cols));
+}
+
+/**
+ * @brief allocates an array of floats on cache lines, prints an error and exits if it fails
+ * @param floats - the number of floats, a multiple of MATRIX_ALIGNMENT_FLOATS
+ * @return the array
+ */
+static float* allocateFloats(size_t floats)
+{
+    float* array = (float*)std::aligned_alloc(MATRIX_ALIGNMENT, sizeof(float) * floats);
+
+    // Checks if the memory allocation worked
+    if (array == nullptr)
+    {
+        std::cerr << ERROR_ALLOCATION << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+/**
+ * @brief returns a pointer to panels the network does not own (like those of a mapped model
+ *        file), which frees nothing and allocates no count
+ * @param panels - the panels, or nullptr for none
+ * @return the pointer
+ */
+static std::shared_ptr<const float> unownedPanels(const float* panels)
+{
+    return std::shared_ptr<const float>(std::shared_ptr<const float>(), panels);
+}
+
+/**
+ * @brief constructor for mlpnetwork
+ * @param weights an array of weights matrices
+ * @param biases an array of biases matrices
+ */
+MlpNetwork::MlpNetwork(Matrix weights[], Matrix biases[]): _slab(nullptr), _panels(nullptr),
+                                                           _maxRows(0),
+                                                           _pool(nullptr), _quantized(false),
+                                                           _fastExp(false),
+                                                           _softmaxOutput(false)
+{
+    // Checks for each dense that its matrices match the default network
+    for (int index = 0; index < MLP_SIZE; index++)
+    {
+        if ((weights[index].getRows() != weightsDims[index].rows) ||
+            (weights[index].getCols() != weightsDims[index].cols))
+        {
+            std::cerr << ERROR_WRONG_SIZE_WEIGHTS << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if ((biases[index].getRows() != biasDims[index].rows) ||
+            (biases[index].getCols() != biasDims[index].cols))
+        {
+            std::cerr << ERROR_WRONG_SIZE_BIASES << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    const ActivationType activations[MLP_SIZE] = {Relu, Relu, Relu, Softmax};
+    _buildSlab(weights, biases, activations, MLP_SIZE);
+}
+
+/**
+ * @brief constructor for a mlpnetwork of any depth. the weights and biases are copied into
+ *        the slab. prints an error and exits if the sizes of the denses do not chain
+ * @param weights - the weights of every dense, the cols of each are the rows of the previous
+ * @param biases - the biases of every dense, rows*1
+ * @param activations - the activation of every dense
+ * @param layerCount - the number of denses
+ */
+MlpNetwork::MlpNetwork(const Matrix weights[], const Matrix biases[],
+                       const ActivationType activations[], int layerCount):
+            _slab(nullptr), _panels(nullptr), _maxRows(0), _pool(nullptr), _quantized(false),
+            _fastExp(false), _softmaxOutput(false)
+{
+    if (layerCount <= 0)
+    {
+        std::cerr << ERROR_WRONG_LAYERS << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Checks for each dense that its bias fits it and its input is the output of the previous
+    for (int index = 0; index < layerCount; index++)
+    {
+        if ((biases[index].getRows() != weights[index].getRows()) ||
+            (biases[index].getCols() != 1) ||
+            ((index > 0) && (weights[index].getCols() != weights[index - 1].getRows())))
+        {
+            std::cerr << ERROR_WRONG_LAYERS << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    _buildSlab(weights, biases, activations, layerCount);
+}
+
+/**
+ * @brief constructor for mlpnetwork from a mapped model file, of the depth and widths the file
+ *        describes. the mapping is the slab: the denses run on views into it and on its panels
+ *        without copying the weights, so the model file must outlive the network
+ * @param model - the model file
+ */
+MlpNetwork::MlpNetwork(const ModelFile& model): _slab(nullptr), _panels(nullptr), _maxRows(0),
+                                                _pool(nullptr), _quantized(false),
+                                                _fastExp(false), _softmaxOutput(false)
+{
+    // the model file checked that the sizes of its denses chain
+    _layers.reserve(model.getLayerCount());
+    for (int index = 0; index < model.getLayerCount(); index++)
+    {
+        _layers.emplace_back(model.getWeights(index), model.getBias(index),
+                             model.getActivation(index), unownedPanels(model.getPanels(index)));
+    }
+    _checkLayers();
+}
+
+/**
+ * @brief constructor for a mlpnetwork on weights it does not own: the denses run on the views
+ *        and the panels without copying, so the memory of the views must outlive the network,
+ *        the panels are held by the denses. a network built on the views and the panels of
+ *        the denses of another network is a replica that shares all its weights. prints an
+ *        error and exits if a bias is not contiguous or the sizes do not chain
+ * @param weights - the weights of every dense, the cols of each are the rows of the previous
+ * @param biases - the biases of every dense, rows*1
+ * @param activations - the activation of every dense
+ * @param layerCount - the number of denses
+ * @param panels - the packed panels of every dense (see Dense::getPanels), or nullptr for
+ *        denses that pack their own
+ */
+MlpNetwork::MlpNetwork(const ConstMatrixView weights[], const ConstMatrixView biases[],
+                       const ActivationType activations[], int layerCount,
+                       const std::shared_ptr<const float> panels[]):
+                       _slab(nullptr), _panels(nullptr), _maxRows(0), _pool(nullptr),
+                       _quantized(false), _fastExp(false), _softmaxOutput(false)
+{
+    // Checks that the denses can run on the views as they are and that their sizes chain
+    _layers.reserve(layerCount);
+    for (int index = 0; index < layerCount; index++)
+    {
+        if ((!biases[index].isContiguous()) ||
+            (biases[index].getRows() != weights[index].getRows()) ||
+            (biases[index].getCols() != 1) ||
+            ((index > 0) && (weights[index].getCols() != weights[index - 1].getRows())))
+        {
+            std::cerr << ERROR_WRONG_LAYERS << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        _layers.emplace_back(Matrix::view(weights[index].data(), weights[index].getRows(),
+                                          weights[index].getCols(), weights[index].getStride()),
+                             Matrix::view(biases[index].data(), biases[index].getRows(), 1),
+                             activations[index], (panels != nullptr) ? panels[index] : nullptr);
+    }
+    _checkLayers();
+}
+
+/**
+ * @brief destructor for mlpnetwork
+ */
+MlpNetwork::~MlpNetwork()
+{
+    std::free(_slab);
+}
+
+/**
+ * @brief returns the number of denses
+ * @return the number of denses
+ */
+int MlpNetwork::getLayerCount() const
+{
+    return (int)_layers.size();
+}
+
+/**
+ * @brief returns a dense of the network
+ * @param layer - the index of the dense
+ * @return the dense
+ */
+const Dense& MlpNetwork::getLayer(int layer) const
+{
+    if ((layer < 0) || (layer >= (int)_layers.size()))
+    {
+        std::cerr << ERROR_WRONG_LAYERS << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return _layers[layer];
+}
+
+/**
+ * @brief returns the size of an input (an image), the cols of the first dense
+ * @return the size of the input
+ */
+int MlpNetwork::getInputSize() const
+{
+    return _layers.front().getWeights().getCols();
+}
+
+/**
+ * @brief returns the size of an output (the number of classes), the rows of the last dense
+ * @return the size of the output
+ */
+int MlpNetwork::getOutputSize() const
+{
+    return _layers.back().getWeights().getRows();
+}
+
+/**
+ * @brief copies the weights and biases into one aligned slab, the arrays of every dense one
+ *        after the other and each row of the weights on its own cache lines, makes the denses
+ *        views into it and packs their panels
+ * @param weights - the weights of every dense
+ * @param biases - the biases of every dense
+ * @param activations - the activation of every dense
+ * @param layerCount - the number of denses
+ */
+void MlpNetwork::_buildSlab(const Matrix weights[], const Matrix biases[],
+                            const ActivationType activations[], int layerCount)
+{
+    size_t floats = 0;
+    size_t panelFloats = 0;
+    for (int index = 0; index < layerCount; index++)
+    {
+        floats += weights[index].getRows() * alignFloats(weights[index].getCols()) +
+                  alignFloats(weights[index].getRows());
+        panelFloats += panelsFloats(weights[index].getRows(), weights[index].getCols());
+    }
+    _slab = allocateFloats(floats);
+    _panels = std::shared_ptr<float>(allocateFloats(panelFloats), std::free);
+
+    // the rows of the weights are padded with zeros to whole cache lines, so the vector loads
+    // of the kernels never straddle two lines
+    simdFill(_slab, 0, (int)floats);
+    float* next = _slab;
+    float* panels = _panels.get();
+    _layers.reserve(layerCount);
+    for (int index = 0; index < layerCount; index++)
+    {
+        int rows = weights[index].getRows();
+        int cols = weights[index].getCols();
+        int stride = (int)alignFloats(cols);
+        float* w = next;
+        float* bias = w + (size_t)rows * stride;
+        next = bias + alignFloats(rows);
+        for (int i = 0; i < rows; i++)
+        {
+            simdCopy(weights[index].row(i), w + (size_t)i * stride, cols);
+        }
+        for (int i = 0; i < rows; i++)
+        {
+            bias[i] = biases[index](i, 0); // a padded bias has one cell in every row it pads
+        }
+
+        // the dense is given its place in the panels, which are packed once all are built
+        _layers.emplace_back(Matrix::view(w, rows, cols, stride), Matrix::view(bias, rows, 1),
+                             activations[index], std::shared_ptr<const float>(_panels, panels));
+        panels += panelsFloats(rows, cols);
+    }
+    _packPanels();
+    _checkLayers();
+}
+
+/**
+ * @brief packs the panels of every dense of the slab one after the other into one aligned
+ *        array, allocated again if a half precision let it go, and gives the denses their
+ *        panels. a dense holds the array through a pointer to its own panels
+ */
+void MlpNetwork::_packPanels()
+{
+    if (_panels == nullptr)
+    {
+        size_t floats = 0;
+        for (const Dense& dense : _layers)
+        {
+            floats += panelsFloats(dense.getWeights().getRows(), dense.getWeights().getCols());
+        }
+        _panels = std::shared_ptr<float>(allocateFloats(floats), std::free);
+    }
+
+    float* next = _panels.get();
+    for (Dense& dense : _layers)
+    {
+        const Matrix& w = dense.getWeights();
+        packPanels(w.asView(), dense.getBias().data(), next);
+        dense.setPanels(std::shared_ptr<const float>(_panels, next));
+        next += panelsFloats(w.getRows(), w.getCols());
+    }
+}
+
+/**
+ * @brief checks that the network has a dense and finds the largest output of a dense, which
+ *        the buffers of the workspace must hold, and sizes the calling thread's workspace for
+ *        it. prints an error and exits if it is empty
+ */
+void MlpNetwork::_checkLayers()
+{
+    if (_layers.empty())
+    {
+        std::cerr << ERROR_WRONG_LAYERS << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    for (const Dense& dense : _layers)
+    {
+        _maxRows = std::max(_maxRows, dense.getWeights().getRows());
+    }
+    _softmaxOutput = (_layers.back().getActivation().getActivationType() == Softmax);
+
+    // the thread that builds the network is the one that usually runs it, one image of it
+    // then runs without allocating from the first call
+    InferenceWorkspace::local().reserve(_maxRows, 1);
+}
+
+/**
+ * @brief Gets a vector representing an image
+ *        performs the mlpnetwork's functions on the input vector
+ *        returns a digit struct with the number on the picture
+ * @param inputVector - the input vector, at size getInputSize()*1.
+ * @return digit struct with the probability and index of the number in the picture
+ */
+Digit MlpNetwork::operator()(const Matrix& inputVector)
+{
+    PROFILE_SCOPE(ProfileNetwork);
+    if (inputVector.getRows() * inputVector.getCols() != getInputSize())
+    {
+        std::cerr << ERROR_WRONG_SIZE_INPUT << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // a packed image is read in place as a column, the rows of a padded one are copied one
+    // after the other into the workspace first
+    const float* input = inputVector.data();
+    if (!inputVector.isPacked())
+    {
+        float* packed = InferenceWorkspace::local().getInputBuffer(getInputSize());
+        for (int i = 0; i < inputVector.getRows(); i++)
+        {
+            simdCopy(inputVector.row(i), packed + (long)i * inputVector.getCols(),
+                     inputVector.getCols());
+        }
+        input = packed;
+    }
+    const float* probabilities = _forward(ConstMatrixView(input, getInputSize(), 1), _pool);
+    Digit digit;
+    _topOfColumn(probabilities, 1, 0, 1, &digit);
+    return digit;
+}
+
+/**
+ * @brief classifies a batch of images at once, every dense performs one matrix product
+ *        for the whole batch instead of one per image
+ * @param images - the input matrix, at size getInputSize()*N, every column is one image
+ * @return a digit struct for every column of the input, in the same order
+ */
+std::vector<Digit> MlpNetwork::classifyBatch(const Matrix& images)
+{
+    // the top class of every image with its probability
+    return classify(images, OutputTopK, 1).digits;
+}
+
+/**
+ * @brief classifies a batch of images at once
+ * @param images - an array of images, each of getInputSize() values
+ * @param count - the number of images in the array
+ * @return a digit struct for every image, in the same order
+ */
+std::vector<Digit> MlpNetwork::classifyBatch(const Matrix images[], int count)
+{
+    int imageSize = getInputSize();
+    Matrix batch(imageSize, count);
+
+    // Copies every image into its column of the batch, row by row (an image may be padded)
+    float* columns = batch.data();
+    for (int j = 0; j < count; j++)
+    {
+        const Matrix& image = images[j];
+        if (image.getRows() * image.getCols() != imageSize)
+        {
+            std::cerr << ERROR_WRONG_SIZE_INPUT << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        for (int r = 0; r < image.getRows(); r++)
+        {
+            const float* row = image.row(r);
+            float* column = columns + (long)r * image.getCols() * count + j;
+            for (int c = 0; c < image.getCols(); c++)
+            {
+                column[(long)c * count] = row[c];
+            }
+        }
+    }
+    return classifyBatch(batch);
+}
+
+/**
+ * @brief classifies a batch of images (or one image) in an output mode. prints an error
+ *        and exits if k is not between 1 and getOutputSize()
+ * @param images - the input matrix, at size getInputSize()*N, every column is one image
+ * @param mode - what to compute for every image
+ * @param k - the number of classes of every image, the argmax mode always has 1
+ * @param result - the result, its arrays are reused
+ */
+void MlpNetwork::classify(const Matrix& images, OutputMode mode, int k, Classification& result)
+{
+    PROFILE_SCOPE(ProfileBatch);
+    if (images.getRows() != getInputSize())
+    {
+        std::cerr << ERROR_WRONG_SIZE_INPUT << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if ((k < 1) || (k > getOutputSize()))
+    {
+        std::cerr << ERROR_WRONG_K << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    result.images = images.getCols();
+    result.k = (mode == OutputArgmax) ? 1 : k;
+    result.digits.resize((size_t)result.images * result.k);
+    result.probabilities.resize((mode == OutputDistribution) ?
+                                (size_t)result.images * getOutputSize() : 0);
+
+    if ((_pool == nullptr) || (images.getCols() == 1))
+    {
+        _classifyColumns(images, 0, images.getCols(), mode, result, _pool);
+        return;
+    }
+
+    // Splits the images between the threads, each thread runs the whole network on its part
+    int grain = (images.getCols() + _pool->getNumThreads() - 1) / _pool->getNumThreads();
+    _pool->parallelFor(0, images.getCols(), grain, [&](int from, int to)
+    {
+        _classifyColumns(images, from, to, mode, result, nullptr);
+    });
+}
+
+/**
+ * @brief classifies a batch of images (or one image) in an output mode
+ * @param images - the input matrix, at size getInputSize()*N, every column is one image
+ * @param mode - what to compute for every image
+ * @param k - the number of classes of every image, the argmax mode always has 1
+ * @return the result
+ */
+Classification MlpNetwork::classify(const Matrix& images, OutputMode mode, int k)
+{
+    Classification result;
+    classify(images, mode, k, result);
+    return result;
+}
+
+/**
+ * @brief sets the thread pool the network runs on. a batch is split between the threads
+ *        by images, a single image is split by the rows of every dense
+ * @param pool - the thread pool (not owned), or nullptr to run on the calling thread
+ */
+void MlpNetwork::setThreadPool(ThreadPool* pool)
+{
+    _pool = pool;
+}
+
+/**
+ * @brief turns the int8 mode on or off. in int8 mode every dense runs on weights
+ *        quantized to 8 bits with a scale per row (a quarter of the memory traffic), and the
+ *        outputs are dequantized to floats before softmax. the quantized weights are
+ *        computed on the first call that turns the mode on
+ * @param quantized - true for the int8 mode, false for the float mode
+ */
+void MlpNetwork::setQuantized(bool quantized)
+{
+    if (quantized && _quantizedArr.empty())
+    {
+        _quantizedArr.reserve(_layers.size());
+        for (const Dense& dense : _layers)
+        {
+            _quantizedArr.emplace_back(dense);
+        }
+    }
+    _quantized = quantized;
+}
+
+/**
+ * @brief returns true if the network runs in the int8 mode
+ * @return true if quantized
+ */
+bool MlpNetwork::isQuantized() const
+{
+    return _quantized;
+}
+
+/**
+ * @brief sets how every dense stores the weights its products read: floats, or a half
+ *        precision that streams half the bytes and sums in floats (see WeightPrecision).
+ *        a half precision lets the float panels go and the float precision packs them
+ *        again. a replica holds the panels it was built on, so they are freed once neither
+ *        network runs on them. only the streamed panels shrink: the float weights stay in
+ *        the slab (the replicas read them too), the half panels are packed from them. the
+ *        int8 mode, when it is on, runs on its own weights
+ * @param precision - the precision
+ */
+void MlpNetwork::setWeightPrecision(WeightPrecision precision)
+{
+    // the panels of the slab are packed again before the denses are back in floats
+    if ((_slab != nullptr) && (_panels == nullptr) && (precision == PrecisionFloat))
+    {
+        _packPanels();
+    }
+    for (Dense& dense : _layers)
+    {
+        dense.setWeightPrecision(precision);
+    }
+
+    // the denses no longer read the float panels of the slab in a half precision, they and
+    // the network let them go. a replica built on them still holds them, they are freed with
+    // the last of its denses
+    if ((_panels != nullptr) && (precision != PrecisionFloat))
+    {
+        for (Dense& dense : _layers)
+        {
+            dense.setPanels(nullptr);
+        }
+        _panels.reset();
+    }
+}
+
+/**
+ * @brief returns how the denses store the weights their products read
+ * @return the precision
+ */
+WeightPrecision MlpNetwork::getWeightPrecision() const
+{
+    return _layers.front().getWeightPrecision();
+}
+
+/**
+ * @brief switches the softmax of the network to the fast exp (see simdExpFast), whose
+ *        relative error is below FAST_EXP_MAX_ERROR, or back to std::exp
+ * @param fastExp - true for the fast exp
+ */
+void MlpNetwork::setFastExp(bool fastExp)
+{
+    // the int8 denses are made from the float ones, so both are switched
+    for (Dense& dense : _layers)
+    {
+        dense.setFastExp(fastExp);
+    }
+    for (QuantizedDense& dense : _quantizedArr)
+    {
+        dense.setFastExp(fastExp);
+    }
+    _fastExp = fastExp;
+}
+
+/**
+ * @brief returns true if the softmax uses the fast exp
+ * @return true if the softmax uses the fast exp
+ */
+bool MlpNetwork::isFastExp() const
+{
+    return _fastExp;
+}
+
+/**
+ * @brief classifies the images in the cols [from, to) of a batch into their part of a result
+ * @param images - the input matrix, at size getInputSize()*N, every column is one image
+ * @param from - the first column
+ * @param to - one after the last column
+ * @param mode - what to compute for every image
+ * @param result - the result, sized for the whole batch
+ * @param pool - the thread pool for the denses, or nullptr to run on the calling thread
+ */
+void MlpNetwork::_classifyColumns(const Matrix& images, int from, int to, OutputMode mode,
+                                  Classification& result, ThreadPool* pool) const
+{
+    // the part of the batch is a view of its cols, the images are read where they are
+    ConstMatrixView part = images.asView().colRange(from, to - from);
+    int cols = part.getCols();
+
+    // argmax needs no probabilities, the output before softmax has the same order (a last
+    // dense of another activation runs it, see _forward)
+    const float* output = _forward(part, pool, mode != OutputArgmax);
+    int classes = getOutputSize();
+
+    for (int j = 0; j < cols; j++)
+    {
+        Digit* digits = result.digits.data() + (size_t)(from + j) * result.k;
+        _topOfColumn(output, cols, j, result.k, digits);
+        if (mode == OutputArgmax)
+        {
+            digits[0].probability = 0;
+        }
+        else if (mode == OutputDistribution)
+        {
+            float* probabilities = result.probabilities.data() + (size_t)(from + j) * classes;
+            for (int i = 0; i < classes; i++)
+            {
+                probabilities[i] = output[i * cols + j];
+            }
+        }
+    }
+}
+
+/**
+ * @brief runs the denses of the network on the input. the outputs of the denses are written
+ *        in turns into the two buffers of the calling thread's workspace, so a warm call does
+ *        not allocate
+ * @param input - the input, getInputSize() rows, one col per image. it may be a view of some
+ *        of the cols of a batch
+ * @param pool - the thread pool for the denses, or nullptr to run on the calling thread
+ * @param softmax - false to leave the output of the last dense before its softmax, when the
+ *        last dense is softmax (another activation may change the order, relu ties the
+ *        negative outputs, so it always runs)
+ * @return the output of the last dense, valid until the next call on this thread
+ */
+const float* MlpNetwork::_forward(ConstMatrixView input, ThreadPool* pool, bool softmax) const
+{
+    int cols = input.getCols();
+    InferenceWorkspace& workspace = InferenceWorkspace::local();
+    workspace.reserve(_maxRows, cols);
+
+    ConstMatrixView inputForNextDense = input;
+
+    // Goes over the denses in the network, each one writes into the buffer the previous one
+    // did not write into
+    for (int i = 0; i < (int)_layers.size(); i++)
+    {
+        PROFILE_LAYER(i);
+        MatrixView output(workspace.getBuffer(i), _layers[i].getWeights().getRows(), cols);
+        bool activate = softmax || (i + 1 < (int)_layers.size()) || !_softmaxOutput;
+        if (_quantized)
+        {
+            _quantizedArr[i].forward(inputForNextDense, output, pool, activate);
+        }
+        else
+        {
+            _layers[i].forward(inputForNextDense, output, pool, activate);
+        }
+        inputForNextDense = output;
+    }
+    return inputForNextDense.data();
+}
+
+/**
+ * @brief finds the k largest values in a column of the output of the network, the classes
+ *        with the highest probabilities
+ * @param values - the output of the last dense, getOutputSize() rows of cols floats
+ * @param cols - the number of cols in the output, one per image
+ * @param col - the column
+ * @param k - the number of classes to find
+ * @param digits - the array to write the k classes into, the largest value first
+ */
+void MlpNetwork::_topOfColumn(const float* values, int cols, int col, int k, Digit digits[]) const
+{
+    int found = 0;
+
+    // Goes over the column and keeps the k largest values so far in order, a value equal to
+    // one already kept goes after it so the lower class comes first
+    for (int i = 0; i < getOutputSize(); i++)
+    {
+        float value = values[i * cols + col];
+        if ((found == k) && !(value > digits[k - 1].probability))
+        {
+            continue;
+        }
+
+        int position = (found < k) ? found++ : (k - 1);
+        while ((position > 0) && (value > digits[position - 1].probability))
+        {
+            digits[position] = digits[position - 1];
+            position--;
+        }
+        digits[position].value = i; // the class, the number on the picture
+        digits[position].probability = value;
+    }
+}
@@ -1,51 +1,257 @@
-
-//MlpNetwork.h
-
-#ifndef MLPNETWORK_H
-#define MLPNETWORK_H
-
-#include "Matrix.h"
-#include "Dense.h"
-#include "Digit.h"
-
-#define MLP_SIZE 4
-
-const MatrixDims imgDims = {28, 28};
-const MatrixDims weightsDims[] = {{128, 784},
-                                  {64,  128},
-                                  {20,  64},
-                                  {10,  20}};
-const MatrixDims biasDims[] = {{128, 1},
-                               {64,  1},
-                               {20,  1},
-                               {10,  1}};
-
-/**
- * @brief class that represents a mlpnetwork
- */
-class MlpNetwork
-{
-public:
-
-    /**
-     * @brief constructor for mlpnetwork
-     * @param weights an array of weights matrices
-     * @param biases an array of biases matrices
-     */
-    MlpNetwork(Matrix weights[], Matrix biases[]);
-
-    /**
-     * @brief Gets a vector representing an image
-     *        performs the mlpnetwork's functions on the input vector
-     *        returns a digit struct with the number on the picture
-     * @param inputVector - the input vector, at size 784*1.
-     * @return digit struct with the probability and index of the number in the picture
-     */
-    Digit operator()(Matrix inputVector);
-private:
-    bool _checkSizeOfWeightsMatrix(Matrix weights[]);
-    bool _checkSizeOfBiasMatrix(Matrix biases[]);
-    Dense _denseArr[MLP_SIZE]; // the array of the four denses
-};
-
-#endif // MLPNETWORK_H
+
+//MlpNetwork.h
+
+#ifndef MLPNETWORK_H
+#define MLPNETWORK_H
+
+#include "Matrix.h"
+#include "Dense.h"
+#include "QuantizedDense.h"
+#include "Digit.h"
+#include "ModelFile.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <vector>
+
+#define MLP_SIZE 4 // the number of denses of the default network
+
+// the sizes of the default network, the network of the weights and biases files. a network
+// from a model file may have any depth and widths
+constexpr MatrixDims imgDims = {28, 28};
+constexpr MatrixDims weightsDims[] = {{128, 784},
+                                      {64,  128},
+                                      {20,  64},
+                                      {10,  20}};
+constexpr MatrixDims biasDims[] = {{128, 1},
+                                   {64,  1},
+                                   {20,  1},
+                                   {10,  1}};
+
+/**
+ * @enum OutputMode
+ * @brief Indicator of what a classification returns, the less it returns the less it computes.
+ */
+enum OutputMode
+{
+    OutputArgmax,       // the class only: softmax keeps the order, so a last dense of softmax
+                        // skips it (no exp at all) and the probability is not computed (it is 0)
+    OutputTopK,         // the k most probable classes with their probabilities
+    OutputDistribution  // the top k, and the probability of every class
+};
+
+/**
+ * @struct Classification
+ * @brief the result of classifying a batch in an output mode. its arrays are reused by the
+ *        next classification into it, so a warm classification does not allocate
+ */
+typedef struct Classification
+{
+    int images = 0;                   // the number of images
+    int k = 0;                        // the classes of every image in digits
+    std::vector<Digit> digits;        // k per image, the most probable first
+    std::vector<float> probabilities; // every class of every image, image after image
+                                      // (distribution mode only)
+} Classification;
+
+/**
+ * @brief class that represents a mlpnetwork: a chain of denses of any depth and widths, every
+ *        one relu but the last (softmax, or as the model file says). the weights and biases of
+ *        all the denses lie in one aligned slab, in the order they run
+ */
+class MlpNetwork
+{
+public:
+
+    /**
+     * @brief constructor for mlpnetwork
+     * @param weights an array of weights matrices
+     * @param biases an array of biases matrices
+     */
+    MlpNetwork(Matrix weights[], Matrix biases[]);
+
+    /**
+     * @brief constructor for a mlpnetwork of any depth. the weights and biases are copied into
+     *        the slab. prints an error and exits if the sizes of the denses do not chain
+     * @param weights - the weights of every dense, the cols of each are the rows of the previous
+     * @param biases - the biases of every dense, rows*1
+     * @param activations - the activation of every dense
+     * @param layerCount - the number of denses
+     */
+    MlpNetwork(const Matrix weights[], const Matrix biases[], const ActivationType activations[],
+               int layerCount);
+
+    /**
+     * @brief constructor for mlpnetwork from a mapped model file, of the depth and widths the file
+     *        describes. the mapping is the slab: the denses run on views into it and on its panels
+     *        without copying the weights, so the model file must outlive the network
+     * @param model - the model file
+     */
+    explicit MlpNetwork(const ModelFile& model);
+
+    /**
+     * @brief constructor for a mlpnetwork on weights it does not own: the denses run on the views
+     *        and the panels without copying, so the memory of the views must outlive the network,
+     *        the panels are held by the denses. a network built on the views and the panels of
+     *        the denses of another network is a replica that shares all its weights. prints an
+     *        error and exits if a bias is not contiguous or the sizes do not chain
+     * @param weights - the weights of every dense, the cols of each are the rows of the previous
+     * @param biases - the biases of every dense, rows*1
+     * @param activations - the activation of every dense
+     * @param layerCount - the number of denses
+     * @param panels - the packed panels of every dense (see Dense::getPanels), or nullptr for
+     *        denses that pack their own
+     */
+    MlpNetwork(const ConstMatrixView weights[], const ConstMatrixView biases[],
+               const ActivationType activations[], int layerCount,
+               const std::shared_ptr<const float> panels[] = nullptr);
+
+    /**
+     * @brief destructor for mlpnetwork
+     */
+    ~MlpNetwork();
+
+    MlpNetwork(const MlpNetwork&) = delete;
+    MlpNetwork& operator=(const MlpNetwork&) = delete;
+
+    /**
+     * @brief returns the number of denses
+     * @return the number of denses
+     */
+    int getLayerCount() const;
+
+    /**
+     * @brief returns a dense of the network
+     * @param layer - the index of the dense
+     * @return the dense
+     */
+    const Dense& getLayer(int layer) const;
+
+    /**
+     * @brief returns the size of an input (an image), the cols of the first dense
+     * @return the size of the input
+     */
+    int getInputSize() const;
+
+    /**
+     * @brief returns the size of an output (the number of classes), the rows of the last dense
+     * @return the size of the output
+     */
+    int getOutputSize() const;
+
+    /**
+     * @brief Gets a vector representing an image
+     *        performs the mlpnetwork's functions on the input vector
+     *        returns a digit struct with the number on the picture
+     * @param inputVector - the input vector, at size getInputSize()*1.
+     * @return digit struct with the probability and index of the number in the picture
+     */
+    Digit operator()(const Matrix& inputVector);
+
+    /**
+     * @brief classifies a batch of images at once, every dense performs one matrix product
+     *        for the whole batch instead of one per image
+     * @param images - the input matrix, at size getInputSize()*N, every column is one image
+     * @return a digit struct for every column of the input, in the same order
+     */
+    std::vector<Digit> classifyBatch(const Matrix& images);
+
+    /**
+     * @brief classifies a batch of images at once
+     * @param images - an array of images, each of getInputSize() values
+     * @param count - the number of images in the array
+     * @return a digit struct for every image, in the same order
+     */
+    std::vector<Digit> classifyBatch(const Matrix images[], int count);
+
+    /**
+     * @brief classifies a batch of images (or one image) in an output mode. prints an error
+     *        and exits if k is not between 1 and getOutputSize()
+     * @param images - the input matrix, at size getInputSize()*N, every column is one image
+     * @param mode - what to compute for every image
+     * @param k - the number of classes of every image, the argmax mode always has 1
+     * @param result - the result, its arrays are reused
+     */
+    void classify(const Matrix& images, OutputMode mode, int k, Classification& result);
+
+    /**
+     * @brief classifies a batch of images (or one image) in an output mode
+     * @param images - the input matrix, at size getInputSize()*N, every column is one image
+     * @param mode - what to compute for every image
+     * @param k - the number of classes of every image, the argmax mode always has 1
+     * @return the result
+     */
+    Classification classify(const Matrix& images, OutputMode mode, int k = 1);
+
+    /**
+     * @brief sets the thread pool the network runs on. a batch is split between the threads
+     *        by images, a single image is split by the rows of every dense
+     * @param pool - the thread pool (not owned), or nullptr to run on the calling thread
+     */
+    void setThreadPool(ThreadPool* pool);
+
+    /**
+     * @brief turns the int8 mode on or off. in int8 mode every dense runs on weights
+     *        quantized to 8 bits with a scale per row (a quarter of the memory traffic), and the
+     *        outputs are dequantized to floats before softmax. the quantized weights are
+     *        computed on the first call that turns the mode on
+     * @param quantized - true for the int8 mode, false for the float mode
+     */
+    void setQuantized(bool quantized);
+
+    /**
+     * @brief returns true if the network runs in the int8 mode
+     * @return true if quantized
+     */
+    bool isQuantized() const;
+
+    /**
+     * @brief sets how every dense stores the weights its products read: floats, or a half
+     *        precision that streams half the bytes and sums in floats (see WeightPrecision).
+     *        a half precision lets the float panels go and the float precision packs them
+     *        again. a replica holds the panels it was built on, so they are freed once neither
+     *        network runs on them. only the streamed panels shrink: the float weights stay in
+     *        the slab (the replicas read them too), the half panels are packed from them. the
+     *        int8 mode, when it is on, runs on its own weights
+     * @param precision - the precision
+     */
+    void setWeightPrecision(WeightPrecision precision);
+
+    /**
+     * @brief returns how the denses store the weights their products read
+     * @return the precision
+     */
+    WeightPrecision getWeightPrecision() const;
+
+    /**
+     * @brief switches the softmax of the network to the fast exp (see simdExpFast), whose
+     *        relative error is below FAST_EXP_MAX_ERROR, or back to std::exp
+     * @param fastExp - true for the fast exp
+     */
+    void setFastExp(bool fastExp);
+
+    /**
+     * @brief returns true if the softmax uses the fast exp
+     * @return true if the softmax uses the fast exp
+     */
+    bool isFastExp() const;
+private:
+    void _buildSlab(const Matrix weights[], const Matrix biases[],
+                    const ActivationType activations[], int layerCount);
+    void _packPanels();
+    void _checkLayers();
+    void _topOfColumn(const float* values, int cols, int col, int k, Digit digits[]) const;
+    const float* _forward(ConstMatrixView input, ThreadPool* pool, bool softmax = true) const;
+    void _classifyColumns(const Matrix& images, int from, int to, OutputMode mode,
+                          Classification& result, ThreadPool* pool) const;
+    std::vector<Dense> _layers; // the denses, in the order they run
+    float* _slab;               // the weights and biases of the denses, nullptr when mapped
+    std::shared_ptr<float> _panels; // the panels of the denses of the slab, none in half precision
+    int _maxRows;               // the largest output of a dense
+    ThreadPool* _pool;          // the thread pool to run on, nullptr for the calling thread
+    std::vector<QuantizedDense> _quantizedArr; // the int8 denses, empty until first needed
+    bool _quantized;            // true to run on the int8 denses
+    bool _fastExp;              // true if the softmax uses the fast exp
+    bool _softmaxOutput;        // true if the last dense is softmax, which argmax skips
+};
+
+#endif // MLPNETWORK_H
@@ -0,0 +1,340 @@
+/**
+* @file   ModelFile.cpp
+* @brief a program that implements ModelFile.h. maps a model file with mmap and gives views of
+ *       its weights, and writes model files.
+* @section DESCRIPTION a program that implements ModelFile.h.
+ *          the layout of a file: the header, the layers, then for every dense its weights, its
+ *          bias and its panels, each padded to the alignment.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "ModelFile.h"
+#include "Gemm.h"
+#include "SimdKernels.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STR_OPEN_MODEL_ERR      "Error: cannot open model file "
+#define STR_MAP_MODEL_ERR       "Error: cannot map model file "
+#define STR_WRITE_MODEL_ERR     "Error: cannot write model file "
+#define STR_INVALID_MODEL_ERR   "Error: invalid model file "
+#define STR_MODEL_VERSION_ERR   "Error: unsupported model file version "
+#define STR_MODEL_CHECKSUM_ERR  "Error: wrong checksum in model file "
+#define STR_MODEL_ENDIAN_ERR    "Error: model files are only supported on little endian hosts"
+#define STR_MODEL_LAYER_ERR     "Error: no such layer in the model"
+#define FNV_OFFSET_BASIS 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief computes the 64 bit FNV-1a hash of bytes
+ * @param data - the bytes
+ * @param size - the number of bytes
+ * @return the hash
+ */
+static uint64_t fnv1a(const char* data, size_t size)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * @brief rounds a size up to a multiple of the alignment
+ * @param size - the size
+ * @param alignment - the alignment, a power of two
+ * @return the rounded size
+ */
+static uint64_t alignUp(uint64_t size, uint64_t alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * @brief prints an error about a model file and exits
+ * @param message - the error
+ * @param path - the path of the file
+ */
+static void modelError(const char* message, const std::string& path)
+{
+    std::cerr << message << path << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief checks that an array of floats lies inside the file and starts at the alignment
+ * @param offset - where the array starts
+ * @param count - the number of floats
+ * @param alignment - the alignment of the file
+ * @param fileSize - the size of the file
+ * @return true if the array is valid
+ */
+static bool validArray(uint64_t offset, uint64_t count, uint64_t alignment, uint64_t fileSize)
+{
+    return (offset % alignment == 0) && (offset <= fileSize) &&
+           (count * sizeof(float) <= fileSize - offset);
+}
+
+/**
+ * @brief maps a model file and checks its header, its layers and (optionally) its checksum.
+ *        prints an error and exits if the file is not a valid model
+ * @param path - the path of the file
+ * @param verifyChecksum - true to check the checksum, which reads the whole file once
+ */
+ModelFile::ModelFile(const std::string& path, bool verifyChecksum): _data(nullptr), _size(0),
+                                                                  _header(nullptr),
+                                                                  _layers(nullptr)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+    std::cerr << STR_MODEL_ENDIAN_ERR << std::endl;
+    exit(EXIT_FAILURE);
+#endif
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        modelError(STR_OPEN_MODEL_ERR, path);
+    }
+
+    struct stat info;
+    if ((fstat(fd, &info) != 0) || ((size_t)info.st_size < sizeof(ModelHeader)))
+    {
+        close(fd);
+        modelError(STR_INVALID_MODEL_ERR, path);
+    }
+    _size = (size_t)info.st_size;
+
+    // the mapping is shared, so every process that maps the file reads the same pages
+    void* mapping = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        modelError(STR_MAP_MODEL_ERR, path);
+    }
+    _data = (const char*)mapping;
+    _header = (const ModelHeader*)_data;
+    _layers = (const ModelLayer*)(_data + sizeof(ModelHeader));
+
+    // Checks the header
+    if (std::memcmp(_header->magic, MODEL_MAGIC, MODEL_MAGIC_SIZE) != 0)
+    {
+        modelError(STR_INVALID_MODEL_ERR, path);
+    }
+    if (_header->version != MODEL_VERSION)
+    {
+        modelError(STR_MODEL_VERSION_ERR, path);
+    }
+    uint64_t alignment = _header->alignment;
+    if ((_header->fileSize != _size) || (_header->layerCount == 0) ||
+        (alignment < sizeof(float)) || ((alignment & (alignment - 1)) != 0) ||
+        (_header->layerCount > (_size - sizeof(ModelHeader)) / sizeof(ModelLayer)))
+    {
+        modelError(STR_INVALID_MODEL_ERR, path);
+    }
+
+    // Checks that the arrays of every layer are inside the file and that the layers connect
+    for (uint32_t i = 0; i < _header->layerCount; i++)
+    {
+        const ModelLayer& layer = _layers[i];
+        if ((layer.rows == 0) || (layer.cols == 0) || (layer.activation > Softmax) ||
+            !validArray(layer.weightsOffset, (uint64_t)layer.rows * layer.cols, alignment, _size) ||
+            !validArray(layer.biasOffset, layer.rows, alignment, _size) ||
+            ((layer.panelRows == PANEL_ROWS) &&
+             !validArray(layer.panelsOffset, packedPanelsSize((int)layer.rows, (int)layer.cols),
+                         alignment, _size)) ||
+            ((i > 0) && (layer.cols != _layers[i - 1].rows)))
+        {
+            modelError(STR_INVALID_MODEL_ERR, path);
+        }
+    }
+
+    if (verifyChecksum &&
+        (fnv1a(_data + sizeof(ModelHeader), _size - sizeof(ModelHeader)) != _header->checksum))
+    {
+        modelError(STR_MODEL_CHECKSUM_ERR, path);
+    }
+}
+
+/**
+ * @brief destructor for model file, unmaps it. the views it gave become invalid
+ */
+ModelFile::~ModelFile()
+{
+    munmap((void*)_data, _size);
+}
+
+/**
+ * @brief returns the number of denses in the model
+ * @return the number of denses
+ */
+int ModelFile::getLayerCount() const
+{
+    return (int)_header->layerCount;
+}
+
+/**
+ * @brief returns the dimensions of the weights of a dense
+ * @param layer - the index of the dense
+ * @return the dimensions
+ */
+MatrixDims ModelFile::getWeightsDims(int layer) const
+{
+    const ModelLayer& entry = _layer(layer);
+    return {(int)entry.rows, (int)entry.cols};
+}
+
+/**
+ * @brief returns the activation type of a dense
+ * @param layer - the index of the dense
+ * @return the activation type
+ */
+ActivationType ModelFile::getActivation(int layer) const
+{
+    return (ActivationType)_layer(layer).activation;
+}
+
+/**
+ * @brief returns a read-only view of the weights of a dense
+ * @param layer - the index of the dense
+ * @return the weights matrix, valid while the model file is
+ */
+Matrix ModelFile::getWeights(int layer) const
+{
+    const ModelLayer& entry = _layer(layer);
+    return Matrix::view((const float*)(_data + entry.weightsOffset), (int)entry.rows,
+                        (int)entry.cols);
+}
+
+/**
+ * @brief returns a read-only view of the bias of a dense
+ * @param layer - the index of the dense
+ * @return the bias matrix (rows*1), valid while the model file is
+ */
+Matrix ModelFile::getBias(int layer) const
+{
+    const ModelLayer& entry = _layer(layer);
+    return Matrix::view((const float*)(_data + entry.biasOffset), (int)entry.rows, 1);
+}
+
+/**
+ * @brief returns the weights and the bias of a dense packed into panels (see packPanels in
+ *        Gemm.h), which the dense runs on without packing them again
+ * @param layer - the index of the dense
+ * @return the packedPanelsSize floats of the panels, valid while the model file is, or
+ *         nullptr if the file was packed with other PANEL_ROWS than this build
+ */
+const float* ModelFile::getPanels(int layer) const
+{
+    const ModelLayer& entry = _layer(layer);
+    if (entry.panelRows != PANEL_ROWS)
+    {
+        return nullptr;
+    }
+    return (const float*)(_data + entry.panelsOffset);
+}
+
+/**
+ * @brief returns the description of a dense, exits if there is no such dense
+ * @param layer - the index of the dense
+ * @return the description
+ */
+const ModelLayer& ModelFile::_layer(int layer) const
+{
+    if ((layer < 0) || (layer >= (int)_header->layerCount))
+    {
+        std::cerr << STR_MODEL_LAYER_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return _layers[layer];
+}
+
+/**
+ * @brief writes a model file, with the panels of every dense packed for this build
+ * @param path - the path of the file
+ * @param weights - the weights matrix of every dense
+ * @param biases - the bias matrix of every dense
+ * @param activations - the activation type of every dense
+ * @param layerCount - the number of denses
+ */
+void ModelFile::write(const std::string& path, const Matrix weights[], const Matrix biases[],
+                      const ActivationType activations[], int layerCount)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+    std::cerr << STR_MODEL_ENDIAN_ERR << std::endl;
+    exit(EXIT_FAILURE);
+#endif
+
+    uint64_t offset = alignUp(sizeof(ModelHeader) + layerCount * sizeof(ModelLayer),
+                              MODEL_ALIGNMENT);
+    std::vector<ModelLayer> layers(layerCount);
+
+    // Goes over the denses and places their arrays one after the other
+    for (int i = 0; i < layerCount; i++)
+    {
+        if ((biases[i].getRows() * biases[i].getCols() != weights[i].getRows()) ||
+            ((i > 0) && (weights[i].getCols() != weights[i - 1].getRows())))
+        {
+            modelError(STR_INVALID_MODEL_ERR, path);
+        }
+
+        ModelLayer& layer = layers[i];
+        layer.rows = (uint32_t)weights[i].getRows();
+        layer.cols = (uint32_t)weights[i].getCols();
+        layer.activation = (uint32_t)activations[i];
+        layer.panelRows = PANEL_ROWS;
+        layer.weightsOffset = offset;
+        offset = alignUp(offset + (uint64_t)layer.rows * layer.cols * sizeof(float),
+                         MODEL_ALIGNMENT);
+        layer.biasOffset = offset;
+        offset = alignUp(offset + layer.rows * sizeof(float), MODEL_ALIGNMENT);
+        layer.panelsOffset = offset;
+        offset = alignUp(offset + packedPanelsSize(weights[i].getRows(), weights[i].getCols()) *
+                         sizeof(float), MODEL_ALIGNMENT);
+    }
+
+    std::vector<char> file(offset, 0);
+    std::memcpy(file.data() + sizeof(ModelHeader), layers.data(),
+                layerCount * sizeof(ModelLayer));
+    // Goes over the denses and copies their cells, the rows of a padded matrix without the
+    // padding, then packs their panels from the copies
+    for (int i = 0; i < layerCount; i++)
+    {
+        for (uint32_t r = 0; r < layers[i].rows; r++)
+        {
+            std::memcpy(file.data() + layers[i].weightsOffset +
+                        (size_t)r * layers[i].cols * sizeof(float), weights[i].row(r),
+                        layers[i].cols * sizeof(float));
+        }
+        float* bias = (float*)(file.data() + layers[i].biasOffset);
+        for (uint32_t r = 0; r < layers[i].rows; r++)
+        {
+            bias[r] = biases[i][r];
+        }
+        packPanels(weights[i].asView(), bias, (float*)(file.data() + layers[i].panelsOffset));
+    }
+
+    ModelHeader header;
+    std::memcpy(header.magic, MODEL_MAGIC, MODEL_MAGIC_SIZE);
+    header.version = MODEL_VERSION;
+    header.layerCount = (uint32_t)layerCount;
+    header.alignment = MODEL_ALIGNMENT;
+    header.fileSize = offset;
+    header.checksum = fnv1a(file.data() + sizeof(ModelHeader), offset - sizeof(ModelHeader));
+    std::memcpy(file.data(), &header, sizeof(ModelHeader));
+
+    std::ofstream os(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!os.write(file.data(), (std::streamsize)file.size()))
+    {
+        modelError(STR_WRITE_MODEL_ERR, path);
+    }
+}
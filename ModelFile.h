@@ -0,0 +1,135 @@
+
+//ModelFile.h
+
+#ifndef MODELFILE_H
+#define MODELFILE_H
+
+#include "Activation.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define MODEL_MAGIC "MLPM"
+#define MODEL_MAGIC_SIZE 4
+#define MODEL_VERSION 2 // 2 added the packed panels of every dense
+#define MODEL_ALIGNMENT 64 // every array in the file starts at a multiple of this
+
+/**
+ * @struct ModelHeader
+ * @brief the header at the start of a model file. all the numbers are little endian
+ */
+typedef struct ModelHeader
+{
+    char magic[MODEL_MAGIC_SIZE]; // MODEL_MAGIC, not null terminated
+    uint32_t version;             // MODEL_VERSION
+    uint32_t layerCount;          // the number of ModelLayer entries after the header
+    uint32_t alignment;           // the alignment of the arrays, a power of two
+    uint64_t fileSize;            // the size of the whole file in bytes
+    uint64_t checksum;            // FNV-1a of every byte after the header
+} ModelHeader;
+
+/**
+ * @struct ModelLayer
+ * @brief the description of one dense in a model file, right after the header
+ */
+typedef struct ModelLayer
+{
+    uint32_t rows;          // the rows of the weights (the size of the output)
+    uint32_t cols;          // the cols of the weights (the size of the input)
+    uint32_t activation;    // the ActivationType of the dense
+    uint32_t panelRows;     // the PANEL_ROWS the panels were packed with
+    uint64_t weightsOffset; // where the rows*cols floats of the weights start in the file
+    uint64_t biasOffset;    // where the rows floats of the bias start in the file
+    uint64_t panelsOffset;  // where the weights and the bias packed by packPanels start
+} ModelLayer;
+
+static_assert(sizeof(ModelHeader) == 32, "the model header must have no padding");
+static_assert(sizeof(ModelLayer) == 40, "the model layer must have no padding");
+
+/**
+ * @brief class that represents a model file mapped into memory. the weights are never copied:
+ *        the matrices and the panels it gives are read-only views into the mapping, so
+ *        processes that load the same file share its pages
+ */
+class ModelFile
+{
+public:
+    /**
+     * @brief maps a model file and checks its header, its layers and (optionally) its checksum.
+     *        prints an error and exits if the file is not a valid model
+     * @param path - the path of the file
+     * @param verifyChecksum - true to check the checksum, which reads the whole file once
+     */
+    explicit ModelFile(const std::string& path, bool verifyChecksum = true);
+
+    /**
+     * @brief destructor for model file, unmaps it. the views it gave become invalid
+     */
+    ~ModelFile();
+
+    ModelFile(const ModelFile&) = delete;
+    ModelFile& operator=(const ModelFile&) = delete;
+
+    /**
+     * @brief returns the number of denses in the model
+     * @return the number of denses
+     */
+    int getLayerCount() const;
+
+    /**
+     * @brief returns the dimensions of the weights of a dense
+     * @param layer - the index of the dense
+     * @return the dimensions
+     */
+    MatrixDims getWeightsDims(int layer) const;
+
+    /**
+     * @brief returns the activation type of a dense
+     * @param layer - the index of the dense
+     * @return the activation type
+     */
+    ActivationType getActivation(int layer) const;
+
+    /**
+     * @brief returns a read-only view of the weights of a dense
+     * @param layer - the index of the dense
+     * @return the weights matrix, valid while the model file is
+     */
+    Matrix getWeights(int layer) const;
+
+    /**
+     * @brief returns a read-only view of the bias of a dense
+     * @param layer - the index of the dense
+     * @return the bias matrix (rows*1), valid while the model file is
+     */
+    Matrix getBias(int layer) const;
+
+    /**
+     * @brief returns the weights and the bias of a dense packed into panels (see packPanels in
+     *        Gemm.h), which the dense runs on without packing them again
+     * @param layer - the index of the dense
+     * @return the packedPanelsSize floats of the panels, valid while the model file is, or
+     *         nullptr if the file was packed with other PANEL_ROWS than this build
+     */
+    const float* getPanels(int layer) const;
+
+    /**
+     * @brief writes a model file, with the panels of every dense packed for this build
+     * @param path - the path of the file
+     * @param weights - the weights matrix of every dense
+     * @param biases - the bias matrix of every dense
+     * @param activations - the activation type of every dense
+     * @param layerCount - the number of denses
+     */
+    static void write(const std::string& path, const Matrix weights[], const Matrix biases[],
+                      const ActivationType activations[], int layerCount);
+
+private:
+    const ModelLayer& _layer(int layer) const;
+    const char* _data;          // the mapping
+    size_t _size;               // the size of the mapping in bytes
+    const ModelHeader* _header; // the header, at the start of the mapping
+    const ModelLayer* _layers;  // the layers, right after the header
+};
+
+#endif //MODELFILE_H
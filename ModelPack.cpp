@@ -0,0 +1,92 @@
+/**
+* @file   ModelPack.cpp
+* @brief a program that packs the weights and biases files of a mlpnetwork into one model
+ *       file, which the mlpnetwork can map without copying (see ModelFile.h).
+* @section DESCRIPTION usage: modelpack model [--sizes=784,128,64,20,10] w1 .. wn b1 .. bn
+ *          the sizes are the input of the network and the output of every dense, without them
+ *          the network is the default one (weightsDims). every dense but the last is relu,
+ *          the last is softmax.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "BinaryReader.h"
+#include "MlpNetwork.h"
+#include "ModelFile.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define ARGS_COUNT_MIN 4
+#define MODEL_ARG 1
+#define SIZES_FLAG "--sizes="
+#define USAGE_MSG "Usage: modelpack model [--sizes=784,128,64,20,10] w1 .. wn b1 .. bn"
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief parses a comma separated list of sizes
+ * @param text - the list
+ * @return the sizes, empty if one of them is not positive
+ */
+static std::vector<int> parseSizes(const char* text)
+{
+    std::vector<int> sizes;
+    std::string list(text);
+    size_t start = 0;
+    while (start <= list.size())
+    {
+        size_t end = list.find(',', start);
+        end = (end == std::string::npos) ? list.size() : end;
+        int size = std::atoi(list.substr(start, end - start).c_str());
+        if (size <= 0)
+        {
+            return std::vector<int>();
+        }
+        sizes.push_back(size);
+        start = end + 1;
+    }
+    return sizes;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < ARGS_COUNT_MIN)
+    {
+        std::cerr << USAGE_MSG << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // the sizes of the default network, unless they are given
+    int firstFile = MODEL_ARG + 1;
+    std::vector<int> sizes(1, weightsDims[0].cols);
+    for (int i = 0; i < MLP_SIZE; i++)
+    {
+        sizes.push_back(weightsDims[i].rows);
+    }
+    if (std::strncmp(argv[firstFile], SIZES_FLAG, std::strlen(SIZES_FLAG)) == 0)
+    {
+        sizes = parseSizes(argv[firstFile] + std::strlen(SIZES_FLAG));
+        firstFile++;
+    }
+    int layers = (int)sizes.size() - 1;
+    if ((layers < 1) || (argc - firstFile != 2 * layers))
+    {
+        std::cerr << USAGE_MSG << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Matrix> weights(layers);
+    std::vector<Matrix> biases(layers);
+    std::vector<ActivationType> activations(layers);
+    for (int i = 0; i < layers; i++)
+    {
+        weights[i] = Matrix(sizes[i + 1], sizes[i]);
+        biases[i] = Matrix(sizes[i + 1], 1);
+        BinaryReader(argv[firstFile + i]).readMatrix(weights[i]);
+        BinaryReader(argv[firstFile + layers + i]).readMatrix(biases[i]);
+        activations[i] = (i == layers - 1) ? Softmax : Relu;
+    }
+
+    ModelFile::write(argv[MODEL_ARG], weights.data(), biases.data(), activations.data(), layers);
+    return EXIT_SUCCESS;
+}
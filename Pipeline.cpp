@@ -0,0 +1,253 @@
+/**
+* @file   Pipeline.cpp
+* @brief a program that implements Pipeline.h. overlaps decoding, inference and output
+* @section DESCRIPTION a program that implements Pipeline.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "Pipeline.h"
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#define STR_INVALID_WORKERS_ERR "Error: the pipeline needs at least one worker"
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief returns the smallest power of two that is at least a number
+ * @param value - the number
+ * @return the power of two
+ */
+static size_t nextPowerOfTwo(size_t value)
+{
+    size_t power = 1;
+    while (power < value)
+    {
+        power <<= 1;
+    }
+    return power;
+}
+
+/**
+ * @brief returns the seconds that passed since a time point
+ * @param start - the time point
+ * @return the seconds
+ */
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief adds the metrics of one thread to the metrics of its stage
+ * @param total - the metrics of the stage
+ * @param part - the metrics of the thread
+ */
+static void addStats(PipelineStats& total, const PipelineStats& part)
+{
+    total.items += part.items;
+    total.busySeconds += part.busySeconds;
+    total.waitInSeconds += part.waitInSeconds;
+    total.waitOutSeconds += part.waitOutSeconds;
+    total.queueSum += part.queueSum;
+    total.queueMax = (part.queueMax > total.queueMax) ? part.queueMax : total.queueMax;
+}
+
+/**
+ * @brief records the occupancy of a stage's input queue when it takes a batch
+ * @param stats - the metrics of the stage
+ * @param occupancy - the number of batches in the queue
+ */
+static void sampleQueue(PipelineStats& stats, size_t occupancy)
+{
+    stats.queueSum += occupancy;
+    stats.queueMax = (occupancy > stats.queueMax) ? occupancy : stats.queueMax;
+}
+
+/**
+ * @brief constructor for pipeline
+ * @param network - the network, shared by the workers (its own thread pool should be off)
+ * @param workers - the number of inference workers
+ * @param queueCapacity - the number of batches between two stages, a power of two (>= 2)
+ * @param mode - the output mode of the workers, the sink gets the top class of every image
+ *               (OutputArgmax when the probabilities are not needed)
+ */
+Pipeline::Pipeline(MlpNetwork& network, int workers, int queueCapacity, OutputMode mode):
+          _network(network), _workers(workers), _mode(mode),
+          // enough batches to fill both queues with one more in every thread
+          _items(2 * queueCapacity + workers + 2),
+          _free(nextPowerOfTwo(2 * queueCapacity + workers + 2)),
+          _decoded(queueCapacity), _inferred(queueCapacity)
+{
+    if (workers <= 0)
+    {
+        std::cerr << STR_INVALID_WORKERS_ERR << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    for (Item& item : _items)
+    {
+        _free.push(&item);
+    }
+}
+
+/**
+ * @brief runs the pipeline until the source ends and every batch reached the sink
+ * @param source - the decode stage
+ * @param sink - the output stage
+ */
+void Pipeline::run(const PipelineSource& source, const PipelineSink& sink)
+{
+    for (PipelineStats& stats : _stats)
+    {
+        stats = PipelineStats();
+    }
+
+    std::vector<PipelineStats> workerStats(_workers);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < _workers; i++)
+    {
+        workers.emplace_back(&Pipeline::_infer, this, std::ref(workerStats[i]));
+    }
+    std::thread output(&Pipeline::_output, this, std::cref(sink));
+
+    // the decode stage runs on the calling thread, it waits for a free batch when too many
+    // are in the pipeline and for room in the queue when the workers fall behind
+    PipelineStats& stats = _stats[DecodeStage];
+    for (long sequence = 0; ; sequence++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        Item* item = nullptr;
+        _free.pop(item);
+        stats.waitOutSeconds += secondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        bool produced = source(item->batch);
+        stats.busySeconds += secondsSince(start);
+        if (!produced)
+        {
+            _free.push(item);
+            break;
+        }
+        item->sequence = sequence;
+        stats.items++;
+
+        start = std::chrono::steady_clock::now();
+        _decoded.push(item);
+        stats.waitOutSeconds += secondsSince(start);
+    }
+
+    // Closes the queues from the front, every stage ends once its input queue is empty
+    _decoded.close();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    for (const PipelineStats& part : workerStats)
+    {
+        addStats(_stats[InferStage], part);
+    }
+    _inferred.close();
+    output.join();
+}
+
+/**
+ * @brief the loop of an inference worker
+ * @param stats - the metrics of the worker
+ */
+void Pipeline::_infer(PipelineStats& stats)
+{
+    Item* item = nullptr;
+    while (true)
+    {
+        auto start = std::chrono::steady_clock::now();
+        size_t occupancy = _decoded.size();
+        if (!_decoded.pop(item))
+        {
+            return;
+        }
+        stats.waitInSeconds += secondsSince(start);
+        sampleQueue(stats, occupancy);
+
+        start = std::chrono::steady_clock::now();
+        _network.classify(item->batch.images, _mode, 1, item->result);
+        stats.busySeconds += secondsSince(start);
+        stats.items++;
+
+        start = std::chrono::steady_clock::now();
+        _inferred.push(item);
+        stats.waitOutSeconds += secondsSince(start);
+    }
+}
+
+/**
+ * @brief the loop of the output stage. the workers finish batches out of order, so a batch
+ *        waits in a ring (indexed by its sequence) until every batch before it was output
+ * @param sink - the output stage
+ */
+void Pipeline::_output(const PipelineSink& sink)
+{
+    PipelineStats& stats = _stats[OutputStage];
+    std::vector<Item*> pending(_items.size(), nullptr);
+    long next = 0;
+    Item* item = nullptr;
+
+    while (true)
+    {
+        auto start = std::chrono::steady_clock::now();
+        size_t occupancy = _inferred.size();
+        if (!_inferred.pop(item))
+        {
+            return;
+        }
+        stats.waitInSeconds += secondsSince(start);
+        sampleQueue(stats, occupancy);
+        pending[item->sequence % pending.size()] = item;
+
+        // Goes over the batches that are ready in order
+        start = std::chrono::steady_clock::now();
+        while (pending[next % pending.size()] != nullptr)
+        {
+            Item* ready = pending[next % pending.size()];
+            pending[next % pending.size()] = nullptr;
+            sink(ready->batch, ready->result.digits);
+            _free.push(ready);
+            stats.items++;
+            next++;
+        }
+        stats.busySeconds += secondsSince(start);
+    }
+}
+
+/**
+ * @brief returns the metrics of a stage in the last run, the workers are summed
+ * @param stage - the stage
+ * @return the metrics
+ */
+const PipelineStats& Pipeline::getStats(PipelineStage stage) const
+{
+    return _stats[stage];
+}
+
+/**
+ * @brief prints the metrics of every stage
+ * @param out - the stream to print into
+ */
+void Pipeline::printStats(std::ostream& out) const
+{
+    static const char* const names[PIPELINE_STAGES] = {"decode", "infer", "output"};
+    char line[128];
+
+    std::snprintf(line, sizeof(line), "%-8s %8s %10s %10s %10s %10s %6s\n", "stage", "batches",
+                  "busy s", "wait in s", "wait out s", "mean queue", "max");
+    out << line;
+    for (int i = 0; i < PIPELINE_STAGES; i++)
+    {
+        const PipelineStats& stats = _stats[i];
+        double meanQueue = (stats.items > 0) ? (stats.queueSum / stats.items) : 0;
+        std::snprintf(line, sizeof(line), "%-8s %8ld %10.3f %10.3f %10.3f %10.2f %6zu\n",
+                      names[i], stats.items, stats.busySeconds, stats.waitInSeconds,
+                      stats.waitOutSeconds, meanQueue, stats.queueMax);
+        out << line;
+    }
+}
@@ -0,0 +1,116 @@
+
+//Pipeline.h
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "BoundedQueue.h"
+#include "IdxDataset.h"
+#include "MlpNetwork.h"
+#include <functional>
+#include <ostream>
+
+#define PIPELINE_STAGES 3
+
+/**
+ * @enum PipelineStage
+ * @brief Indicator of a stage of the pipeline.
+ */
+enum PipelineStage
+{
+    DecodeStage,
+    InferStage,
+    OutputStage
+};
+
+/**
+ * @struct PipelineStats
+ * @brief the metrics of one stage. the stage waits on the queue before it for work, and on
+ *        the queue after it when that queue is full (backpressure)
+ */
+typedef struct PipelineStats
+{
+    long items = 0;             // the number of batches the stage handled
+    double busySeconds = 0;     // the time spent on the batches
+    double waitInSeconds = 0;   // the time spent waiting for a batch
+    double waitOutSeconds = 0;  // the time spent waiting for room in the next queue
+    double queueSum = 0;        // the sum of the occupancy of the input queue, once per batch
+    size_t queueMax = 0;        // the highest occupancy of the input queue
+} PipelineStats;
+
+/**
+ * @brief the stage that produces the batches, it fills a batch and returns false at the end
+ */
+typedef std::function<bool(IdxBatch&)> PipelineSource;
+
+/**
+ * @brief the stage that consumes the results, it gets every batch with its digits, in the
+ *        order the source produced them
+ */
+typedef std::function<void(const IdxBatch&, const std::vector<Digit>&)> PipelineSink;
+
+/**
+ * @brief class that represents a classification pipeline: a decode stage (on the calling
+ *        thread), inference workers and an output stage run at the same time, connected by
+ *        bounded lock-free queues. a fixed set of batches goes around the pipeline, so it does
+ *        not allocate once warm, and a full queue stops the stage before it
+ */
+class Pipeline
+{
+public:
+    /**
+     * @brief constructor for pipeline
+     * @param network - the network, shared by the workers (its own thread pool should be off)
+     * @param workers - the number of inference workers
+     * @param queueCapacity - the number of batches between two stages, a power of two (>= 2)
+     * @param mode - the output mode of the workers, the sink gets the top class of every image
+     *               (OutputArgmax when the probabilities are not needed)
+     */
+    Pipeline(MlpNetwork& network, int workers, int queueCapacity,
+             OutputMode mode = OutputTopK);
+
+    /**
+     * @brief runs the pipeline until the source ends and every batch reached the sink
+     * @param source - the decode stage
+     * @param sink - the output stage
+     */
+    void run(const PipelineSource& source, const PipelineSink& sink);
+
+    /**
+     * @brief returns the metrics of a stage in the last run, the workers are summed
+     * @param stage - the stage
+     * @return the metrics
+     */
+    const PipelineStats& getStats(PipelineStage stage) const;
+
+    /**
+     * @brief prints the metrics of every stage
+     * @param out - the stream to print into
+     */
+    void printStats(std::ostream& out) const;
+
+private:
+    /**
+     * @struct Item
+     * @brief a batch that goes around the pipeline
+     */
+    typedef struct Item
+    {
+        long sequence = 0;          // the order of the batch in the source
+        IdxBatch batch;             // the images
+        Classification result;      // the result of the inference
+    } Item;
+
+    void _infer(PipelineStats& stats);
+    void _output(const PipelineSink& sink);
+    MlpNetwork& _network;
+    int _workers;
+    OutputMode _mode;
+    std::vector<Item> _items;              // every batch of the pipeline
+    BoundedQueue<Item*> _free;             // the batches no stage holds
+    BoundedQueue<Item*> _decoded;          // decode -> infer
+    BoundedQueue<Item*> _inferred;         // infer -> output
+    PipelineStats _stats[PIPELINE_STAGES]; // the metrics of the last run
+};
+
+#endif //PIPELINE_H
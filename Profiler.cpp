@@ -0,0 +1,372 @@
+/**
+* @file   Profiler.cpp
+* @brief a program that implements Profiler.h. every thread counts into its own counters,
+ *       which are registered so a dump can add up the counters of all the threads.
+* @section DESCRIPTION a program that implements Profiler.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "Profiler.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_TSC
+#endif
+
+#define NO_LAYER PROFILE_LAYERS // the slot of the sections that run outside any layer
+#define PROFILE_OUT_ENV "MLP_PROFILE_OUT"
+#define NANOS_PER_MILLI 1e6
+#define BYTES_PER_MB 1e6
+#define STR_PROFILE_OUT_ERR "Error: cannot write the profile into "
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @struct ProfileCounter
+ * @brief the counters of one section in one layer. only the owner thread adds to them, the
+ *        atomics let a dump read them at the same time
+ */
+typedef struct ProfileCounter
+{
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> histogram[PROFILE_BUCKETS] = {};
+} ProfileCounter;
+
+/**
+ * @struct ProfileThread
+ * @brief the counters of one thread
+ */
+typedef struct ProfileThread
+{
+    ProfileCounter counters[PROFILE_SECTIONS][PROFILE_LAYERS + 1];
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> allocatedBytes{0};
+    int layer = NO_LAYER; // the slot of the layer the thread runs
+} ProfileThread;
+
+/**
+ * @struct ProfileRegistry
+ * @brief the counters of the running threads, and the sum of the counters of the threads
+ *        that ended
+ */
+typedef struct ProfileRegistry
+{
+    std::mutex lock;
+    std::vector<ProfileThread*> threads;
+    ProfileThread ended;
+    uint64_t startTicks = Profiler::now();  // to convert ticks to nanoseconds
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+} ProfileRegistry;
+
+/**
+ * @brief returns the registry. it is never destroyed, so threads that end during the exit
+ *        can still add their counters to it
+ * @return the registry
+ */
+static ProfileRegistry& registry()
+{
+    static ProfileRegistry* instance = new ProfileRegistry();
+    return *instance;
+}
+
+/**
+ * @brief adds to a counter. only one thread writes a counter (its own thread, or a thread that
+ *        holds the lock of the registry), so a plain load and store are enough and cost no
+ *        locked instruction; the atomics only keep a dump from reading a torn value
+ * @param counter - the counter
+ * @param value - the value to add
+ */
+static inline void addTo(std::atomic<uint64_t>& counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+/**
+ * @brief adds the counters of one thread to another
+ * @param total - the counters to add to
+ * @param part - the counters to add
+ */
+static void addThread(ProfileThread& total, const ProfileThread& part)
+{
+    for (int s = 0; s < PROFILE_SECTIONS; s++)
+    {
+        for (int l = 0; l <= PROFILE_LAYERS; l++)
+        {
+            ProfileCounter& to = total.counters[s][l];
+            const ProfileCounter& from = part.counters[s][l];
+            addTo(to.calls, from.calls.load(std::memory_order_relaxed));
+            addTo(to.ticks, from.ticks.load(std::memory_order_relaxed));
+            addTo(to.bytes, from.bytes.load(std::memory_order_relaxed));
+            for (int b = 0; b < PROFILE_BUCKETS; b++)
+            {
+                addTo(to.histogram[b], from.histogram[b].load(std::memory_order_relaxed));
+            }
+        }
+    }
+    addTo(total.allocations, part.allocations.load(std::memory_order_relaxed));
+    addTo(total.allocatedBytes, part.allocatedBytes.load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief zeroes the counters of a thread
+ * @param thread - the counters
+ */
+static void clearThread(ProfileThread& thread)
+{
+    for (int s = 0; s < PROFILE_SECTIONS; s++)
+    {
+        for (int l = 0; l <= PROFILE_LAYERS; l++)
+        {
+            ProfileCounter& counter = thread.counters[s][l];
+            counter.calls = 0;
+            counter.ticks = 0;
+            counter.bytes = 0;
+            for (int b = 0; b < PROFILE_BUCKETS; b++)
+            {
+                counter.histogram[b] = 0;
+            }
+        }
+    }
+    thread.allocations = 0;
+    thread.allocatedBytes = 0;
+}
+
+/**
+ * @brief dumps the counters at exit, into the file in MLP_PROFILE_OUT or the standard error
+ */
+static void dumpAtExit()
+{
+    const char* path = std::getenv(PROFILE_OUT_ENV);
+    if (path == nullptr)
+    {
+        Profiler::dump(std::cerr);
+        return;
+    }
+    std::ofstream out(path);
+    if (!out)
+    {
+        std::cerr << STR_PROFILE_OUT_ERR << path << std::endl;
+        return;
+    }
+    Profiler::dump(out);
+}
+
+/**
+ * @brief class that registers the counters of a thread while it runs, and adds them to the
+ *        ended counters when it ends
+ */
+class ProfileThreadHolder
+{
+public:
+    /**
+     * @brief registers the counters, the first thread also sets up the dump at exit
+     */
+    ProfileThreadHolder()
+    {
+        static std::once_flag atExit;
+        std::call_once(atExit, []()
+        {
+            registry();
+            std::atexit(dumpAtExit);
+        });
+        std::lock_guard<std::mutex> guard(registry().lock);
+        registry().threads.push_back(&thread);
+    }
+
+    /**
+     * @brief adds the counters to the ended counters and unregisters them
+     */
+    ~ProfileThreadHolder()
+    {
+        ProfileRegistry& all = registry();
+        std::lock_guard<std::mutex> guard(all.lock);
+        addThread(all.ended, thread);
+        for (size_t i = 0; i < all.threads.size(); i++)
+        {
+            if (all.threads[i] == &thread)
+            {
+                all.threads.erase(all.threads.begin() + i);
+                break;
+            }
+        }
+    }
+
+    ProfileThread thread;
+};
+
+/**
+ * @brief returns the counters of the calling thread, registered on the first call
+ * @return the counters
+ */
+static ProfileThread& localThread()
+{
+    static thread_local ProfileThreadHolder holder;
+    return holder.thread;
+}
+
+/**
+ * @brief returns a percentile of a histogram, as the upper bound of its bucket
+ * @param counter - the counter with the histogram
+ * @param fraction - the percentile, in (0, 1]
+ * @return the upper bound in ticks
+ */
+static double histogramPercentile(const ProfileCounter& counter, double fraction)
+{
+    uint64_t calls = counter.calls.load(std::memory_order_relaxed);
+    uint64_t seen = 0;
+    for (int b = 0; b < PROFILE_BUCKETS; b++)
+    {
+        seen += counter.histogram[b].load(std::memory_order_relaxed);
+        if (seen >= fraction * calls)
+        {
+            return (double)(2ull << b);
+        }
+    }
+    return (double)(2ull << (PROFILE_BUCKETS - 1));
+}
+
+/**
+ * @brief returns the current time in ticks: the time stamp counter on x86, nanoseconds
+ *        elsewhere
+ * @return the ticks
+ */
+uint64_t Profiler::now()
+{
+#ifdef PROFILE_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * @brief adds a run of a section to the calling thread's counters
+ * @param section - the section
+ * @param ticks - the duration of the run
+ * @param bytes - the bytes the run moved
+ */
+void Profiler::record(ProfileSection section, uint64_t ticks, uint64_t bytes)
+{
+    ProfileThread& thread = localThread();
+    ProfileCounter& counter = thread.counters[section][thread.layer];
+    int bucket = (ticks == 0) ? 0 : (63 - __builtin_clzll(ticks));
+    addTo(counter.calls, 1);
+    addTo(counter.ticks, ticks);
+    addTo(counter.bytes, bytes);
+    addTo(counter.histogram[(bucket < PROFILE_BUCKETS) ? bucket : (PROFILE_BUCKETS - 1)], 1);
+}
+
+/**
+ * @brief adds an allocation to the calling thread's counters
+ * @param bytes - the size of the allocation
+ */
+void Profiler::countAllocation(uint64_t bytes)
+{
+    ProfileThread& thread = localThread();
+    addTo(thread.allocations, 1);
+    addTo(thread.allocatedBytes, bytes);
+}
+
+/**
+ * @brief sets the layer the calling thread runs, the sections are counted by layer
+ * @param layer - the index of the layer, -1 for none
+ * @return the layer it ran before
+ */
+int Profiler::setLayer(int layer)
+{
+    ProfileThread& thread = localThread();
+    int previous = (thread.layer == NO_LAYER) ? -1 : thread.layer;
+    if (layer < 0)
+    {
+        thread.layer = NO_LAYER;
+    }
+    else
+    {
+        thread.layer = (layer < PROFILE_LAYERS) ? layer : (PROFILE_LAYERS - 1);
+    }
+    return previous;
+}
+
+/**
+ * @brief prints the counters of all the threads: the calls, total and mean time and the
+ *        p50/p99 (from the histograms) of every section in every layer, and the allocations
+ * @param out - the stream to print into
+ */
+void Profiler::dump(std::ostream& out)
+{
+    static const char* const names[PROFILE_SECTIONS] = {"network", "batch", "dense", "product",
+                                                        "bias", "activation", "copy"};
+    ProfileRegistry& all = registry();
+    ProfileThread total;
+    double ticksPerNano = 1;
+    {
+        std::lock_guard<std::mutex> guard(all.lock);
+        addThread(total, all.ended);
+        for (const ProfileThread* thread : all.threads)
+        {
+            addThread(total, *thread);
+        }
+#ifdef PROFILE_TSC
+        double nanos = std::chrono::duration<double, std::nano>(
+                       std::chrono::steady_clock::now() - all.start).count();
+        ticksPerNano = (nanos > 0) ? ((now() - all.startTicks) / nanos) : 1;
+#endif
+    }
+
+    // the percentiles are the upper bounds of power-of-two buckets, so they are within 2x
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-10s %5s %10s %12s %12s %12s %12s %10s\n", "section",
+                  "layer", "calls", "total ms", "mean ns", "p50 ns <=", "p99 ns <=", "MB");
+    out << line;
+    for (int s = 0; s < PROFILE_SECTIONS; s++)
+    {
+        for (int l = 0; l <= PROFILE_LAYERS; l++)
+        {
+            const ProfileCounter& counter = total.counters[s][l];
+            uint64_t calls = counter.calls.load();
+            if (calls == 0)
+            {
+                continue;
+            }
+            double nanos = counter.ticks.load() / ticksPerNano;
+            std::string layer = (l == NO_LAYER) ? "-" : std::to_string(l);
+            std::snprintf(line, sizeof(line), "%-10s %5s %10llu %12.3f %12.1f %12.0f %12.0f "
+                          "%10.2f\n", names[s], layer.c_str(), (unsigned long long)calls,
+                          nanos / NANOS_PER_MILLI, nanos / calls,
+                          histogramPercentile(counter, 0.5) / ticksPerNano,
+                          histogramPercentile(counter, 0.99) / ticksPerNano,
+                          counter.bytes.load() / BYTES_PER_MB);
+            out << line;
+        }
+    }
+    std::snprintf(line, sizeof(line), "allocations %llu (%.2f MB)\n",
+                  (unsigned long long)total.allocations.load(),
+                  total.allocatedBytes.load() / BYTES_PER_MB);
+    out << line;
+}
+
+/**
+ * @brief zeroes the counters of all the threads. a counter a thread adds to at the same
+ *        time may keep its count from before, only the thread itself writes it without a lock
+ */
+void Profiler::reset()
+{
+    ProfileRegistry& all = registry();
+    std::lock_guard<std::mutex> guard(all.lock);
+    clearThread(all.ended);
+    for (ProfileThread* thread : all.threads)
+    {
+        clearThread(*thread);
+    }
+}
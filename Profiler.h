@@ -0,0 +1,163 @@
+
+//Profiler.h
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <ostream>
+
+#define PROFILE_LAYERS 16  // the layers timed apart, a deeper layer is counted with the last
+#define PROFILE_BUCKETS 40 // bucket b of a histogram counts the durations of [2^b, 2^(b+1)) ticks
+
+/**
+ * @enum ProfileSection
+ * @brief Indicator of a timed section of the hot path.
+ */
+enum ProfileSection
+{
+    ProfileNetwork,    // MlpNetwork::operator(), one image
+    ProfileBatch,      // MlpNetwork::classifyBatch
+    ProfileDense,      // one dense, with everything it does
+    ProfileProduct,    // the product of a dense (with the bias and relu when fused)
+    ProfileBias,       // the bias of a dense, when it is a pass of its own
+    ProfileActivation, // Activation on a matrix or an array
+    ProfileCopy,       // copies of matrices and of images into the batch layout
+    PROFILE_SECTIONS
+};
+
+/**
+ * @brief the instrumentation of the hot path. with MLP_PROFILE defined (make PROFILE=1) the
+ *        macros below time their scope and count into the calling thread's own counters, with
+ *        no locks or shared cache lines; without it they expand to nothing and cost nothing.
+ *        the counters of all the threads are added up when they are dumped, on demand with
+ *        Profiler::dump or at exit (into the file in MLP_PROFILE_OUT, or the standard error)
+ */
+#ifdef MLP_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(section) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(section, 0)
+#define PROFILE_SCOPE_BYTES(section, bytes) \
+        ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(section, bytes)
+#define PROFILE_LAYER(layer) ProfileLayerScope PROFILE_CONCAT(profileLayer, __LINE__)(layer)
+#define PROFILE_ALLOCATION(bytes) Profiler::countAllocation(bytes)
+#else
+#define PROFILE_SCOPE(section) ((void)0)
+#define PROFILE_SCOPE_BYTES(section, bytes) ((void)0)
+#define PROFILE_LAYER(layer) ((void)0)
+#define PROFILE_ALLOCATION(bytes) ((void)0)
+#endif
+
+/**
+ * @brief class that collects and prints the counters of the instrumentation
+ */
+class Profiler
+{
+public:
+    /**
+     * @brief returns the current time in ticks: the time stamp counter on x86, nanoseconds
+     *        elsewhere
+     * @return the ticks
+     */
+    static uint64_t now();
+
+    /**
+     * @brief adds a run of a section to the calling thread's counters
+     * @param section - the section
+     * @param ticks - the duration of the run
+     * @param bytes - the bytes the run moved
+     */
+    static void record(ProfileSection section, uint64_t ticks, uint64_t bytes);
+
+    /**
+     * @brief adds an allocation to the calling thread's counters
+     * @param bytes - the size of the allocation
+     */
+    static void countAllocation(uint64_t bytes);
+
+    /**
+     * @brief sets the layer the calling thread runs, the sections are counted by layer
+     * @param layer - the index of the layer, -1 for none
+     * @return the layer it ran before
+     */
+    static int setLayer(int layer);
+
+    /**
+     * @brief prints the counters of all the threads: the calls, total and mean time and the
+     *        p50/p99 (from the histograms) of every section in every layer, and the allocations
+     * @param out - the stream to print into
+     */
+    static void dump(std::ostream& out);
+
+    /**
+     * @brief zeroes the counters of all the threads. a counter a thread adds to at the same
+     *        time may keep its count from before, only the thread itself writes it without a lock
+     */
+    static void reset();
+};
+
+#ifdef MLP_PROFILE
+/**
+ * @brief class that times its scope as a run of a section
+ */
+class ProfileScope
+{
+public:
+    /**
+     * @brief starts timing
+     * @param section - the section
+     * @param bytes - the bytes the section moves
+     */
+    ProfileScope(ProfileSection section, uint64_t bytes): _section(section), _bytes(bytes),
+                                                          _start(Profiler::now())
+    {
+    }
+
+    /**
+     * @brief stops timing and records the run
+     */
+    ~ProfileScope()
+    {
+        Profiler::record(_section, Profiler::now() - _start, _bytes);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileSection _section;
+    uint64_t _bytes;
+    uint64_t _start;
+};
+
+/**
+ * @brief class that sets the layer of the calling thread for its scope
+ */
+class ProfileLayerScope
+{
+public:
+    /**
+     * @brief sets the layer
+     * @param layer - the index of the layer
+     */
+    explicit ProfileLayerScope(int layer): _previous(Profiler::setLayer(layer))
+    {
+    }
+
+    /**
+     * @brief restores the layer that was set before
+     */
+    ~ProfileLayerScope()
+    {
+        Profiler::setLayer(_previous);
+    }
+
+    ProfileLayerScope(const ProfileLayerScope&) = delete;
+    ProfileLayerScope& operator=(const ProfileLayerScope&) = delete;
+
+private:
+    int _previous;
+};
+#endif
+
+#endif //PROFILER_H
@@ -0,0 +1,118 @@
+/**
+* @file   QuantizeCompare.cpp
+* @brief a program that classifies the same images with the float model and with its reduced
+ *       precisions (the int8 mode, and the fp16 and bf16 weights) and reports how often each
+ *       agrees with the float model and how far their probabilities are.
+* @section DESCRIPTION usage: quantcompare w1 w2 w3 w4 b1 b2 b3 b4 images [count]
+ *          the weights and biases files are the ones the mlpnetwork gets, the images file holds
+ *          28*28 floats per image, one image after the other.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "BinaryReader.h"
+#include "MlpNetwork.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#define ARGS_COUNT_MIN 10
+#define ARGS_COUNT_MAX 11
+#define IMAGES_ARG 9
+#define COUNT_ARG 10
+#define USAGE_MSG "Usage: quantcompare w1 w2 w3 w4 b1 b2 b3 b4 images [count]"
+#define STR_READ_FILE_ERR "Error: cannot read file "
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief classifies the images with one mode of the network and prints how long the second
+ *        (warm) run took
+ * @param name - the name of the mode
+ * @param network - the network, already in the mode
+ * @param images - the images, one per column
+ * @return the digit of every image
+ */
+static std::vector<Digit> classify(const char* name, MlpNetwork& network, const Matrix& images)
+{
+    std::vector<Digit> digits = network.classifyBatch(images);
+    auto start = std::chrono::steady_clock::now();
+    digits = network.classifyBatch(images);
+    auto end = std::chrono::steady_clock::now();
+
+    double nanos = std::chrono::duration<double, std::nano>(end - start).count();
+    std::printf("%-8s %10.1f ns/image\n", name, nanos / images.getCols());
+    return digits;
+}
+
+/**
+ * @brief prints how often a reduced precision agrees with the float model and how far the
+ *        probabilities of their digits are
+ * @param name - the name of the precision
+ * @param floatDigits - the digits of the float model
+ * @param digits - the digits of the reduced precision
+ */
+static void report(const char* name, const std::vector<Digit>& floatDigits,
+                   const std::vector<Digit>& digits)
+{
+    // Goes over the images and compares the digit and its probability in the two precisions
+    int count = (int)floatDigits.size();
+    int agree = 0;
+    double sumDiff = 0;
+    double maxDiff = 0;
+    for (int j = 0; j < count; j++)
+    {
+        agree += (floatDigits[j].value == digits[j].value);
+        double diff = std::fabs(floatDigits[j].probability - digits[j].probability);
+        sumDiff += diff;
+        maxDiff = std::fmax(maxDiff, diff);
+    }
+    std::printf("%-8s agree %.2f%%, prob mean diff %.5f, max diff %.5f\n", name,
+                100.0 * agree / count, sumDiff / count, maxDiff);
+}
+
+int main(int argc, char* argv[])
+{
+    if ((argc < ARGS_COUNT_MIN) || (argc > ARGS_COUNT_MAX))
+    {
+        std::cerr << USAGE_MSG << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Matrix weights[MLP_SIZE];
+    Matrix biases[MLP_SIZE];
+    for (int i = 0; i < MLP_SIZE; i++)
+    {
+        weights[i] = Matrix(weightsDims[i].rows, weightsDims[i].cols);
+        biases[i] = Matrix(biasDims[i].rows, biasDims[i].cols);
+        BinaryReader(argv[i + 1]).readMatrix(weights[i]);
+        BinaryReader(argv[MLP_SIZE + i + 1]).readMatrix(biases[i]);
+    }
+
+    // Reads the images one after the other, into the columns of one batch
+    int imageSize = imgDims.rows * imgDims.cols;
+    BinaryReader reader(argv[IMAGES_ARG]);
+    int available = (int)(reader.getRemaining() / (long)(imageSize * sizeof(float)));
+    int count = (argc == ARGS_COUNT_MAX) ? std::atoi(argv[COUNT_ARG]) : available;
+    if ((count <= 0) || (count > available))
+    {
+        std::cerr << STR_READ_FILE_ERR << argv[IMAGES_ARG] << std::endl;
+        return EXIT_FAILURE;
+    }
+    Matrix images = reader.readImages(count, imageSize);
+
+    MlpNetwork network(weights, biases);
+    std::vector<Digit> floatDigits = classify("float", network, images);
+    network.setWeightPrecision(PrecisionHalf);
+    std::vector<Digit> halfDigits = classify("fp16", network, images);
+    network.setWeightPrecision(PrecisionBfloat16);
+    std::vector<Digit> bfloat16Digits = classify("bf16", network, images);
+    network.setWeightPrecision(PrecisionFloat);
+    network.setQuantized(true);
+    std::vector<Digit> int8Digits = classify("int8", network, images);
+
+    std::printf("images   %d\n", count);
+    report("fp16", floatDigits, halfDigits);
+    report("bf16", floatDigits, bfloat16Digits);
+    report("int8", floatDigits, int8Digits);
+    return EXIT_SUCCESS;
+}
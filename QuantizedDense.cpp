@@ -0,0 +1,187 @@
+/**
+* @file   QuantizedDense.cpp
+* @brief a program that implements QuantizedDense.h. a dense with 8 bit weights
+* @section DESCRIPTION a program that implements QuantizedDense.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+
+#include "QuantizedDense.h"
+#include "Profiler.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include <cmath>
+
+#define INT8_MAX_VALUE 127
+#define UINT8_MAX_VALUE 255
+#define SIGNED_ZERO_POINT 128        // the byte a zero input is stored as, when inputs are signed
+#define QUANTIZED_GRAIN_ROWS 32      // rows of the weights in one task of a parallel forward
+#define PARALLEL_MIN_WORK (1 << 16)  // the fewest multiply-adds worth splitting between threads
+#define ERROR_WRONG_SIZE_INPUT "Error: different sizes input matrix"
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief constructor for quantized dense, quantizes the weights of a float dense
+ * @param dense - the float dense
+ */
+QuantizedDense::QuantizedDense(const Dense& dense):_rows(dense.getWeights().getRows()),
+                                                   _cols(dense.getWeights().getCols()),
+                                                   _w((long)_rows * _cols),
+                                                   _scales(_rows),
+                                                   _sums(_rows),
+                                                   _bias(dense.getBias().data(),
+                                                         dense.getBias().data() + _rows),
+                                                   _act(dense.getActivation())
+{
+    const Matrix& w = dense.getWeights();
+
+    // Goes over the rows, every row is scaled so its largest absolute weight becomes 127
+    for (int i = 0; i < _rows; i++)
+    {
+        const float* row = w.row(i);
+        float maxAbs = 0;
+        for (int j = 0; j < _cols; j++)
+        {
+            maxAbs = std::fmax(maxAbs, std::fabs(row[j]));
+        }
+
+        float scale = (maxAbs > 0) ? (maxAbs / INT8_MAX_VALUE) : 1;
+        int32_t sum = 0;
+        for (int j = 0; j < _cols; j++)
+        {
+            long quantized = std::lround(row[j] / scale);
+            quantized = (quantized > INT8_MAX_VALUE) ? INT8_MAX_VALUE : quantized;
+            quantized = (quantized < -INT8_MAX_VALUE) ? -INT8_MAX_VALUE : quantized;
+            _w[(long)i * _cols + j] = (int8_t)quantized;
+            sum += (int32_t)quantized;
+        }
+        _scales[i] = scale;
+        _sums[i] = sum;
+    }
+}
+
+/**
+ * @brief returns the number of rows of the weights (the size of the output)
+ * @return the number of rows
+ */
+int QuantizedDense::getRows() const
+{
+    return _rows;
+}
+
+/**
+ * @brief returns the number of cols of the weights (the size of the input)
+ * @return the number of cols
+ */
+int QuantizedDense::getCols() const
+{
+    return _cols;
+}
+
+/**
+ * @brief switches the softmax of the dense to the fast exp, or back to std::exp
+ * @param fastExp - true for the fast exp
+ */
+void QuantizedDense::setFastExp(bool fastExp)
+{
+    _act.setFastExp(fastExp);
+}
+
+/**
+ * @brief performs the activation function on a row-major input array, writing straight
+ *        into a preallocated output array, like Dense::forward
+ * @param input - the input array, the cols of the weights matrix times cols floats
+ * @param cols - the number of cols in the input, one per image
+ * @param output - the output array, the rows of the weights matrix times cols floats
+ * @param pool - the thread pool, or nullptr to run on the calling thread
+ * @param softmax - false to leave the output before softmax (relu is always performed)
+ */
+void QuantizedDense::forward(const float* input, int cols, float* output, ThreadPool* pool,
+                             bool softmax) const
+{
+    forward(ConstMatrixView(input, _cols, cols), MatrixView(output, _rows, cols), pool, softmax);
+}
+
+/**
+ * @brief like the forward on arrays, on views of any stride, like Dense::forward
+ * @param input - the input, the cols of the weights matrix rows, one column per image
+ * @param output - the output, the rows of the weights matrix rows, as many cols as input
+ * @param pool - the thread pool, or nullptr to run on the calling thread
+ * @param softmax - false to leave the output before softmax (relu is always performed)
+ */
+void QuantizedDense::forward(ConstMatrixView input, MatrixView output, ThreadPool* pool,
+                             bool softmax) const
+{
+    PROFILE_SCOPE(ProfileDense);
+    if ((input.getRows() != _cols) || (output.getRows() != _rows) ||
+        (output.getCols() != input.getCols()))
+    {
+        std::cerr << ERROR_WRONG_SIZE_INPUT << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // the buffers of an image that is not contiguous, of the quantized image and of the sums,
+    // they only grow
+    static thread_local std::vector<float> image;
+    static thread_local std::vector<uint8_t> quantizedInput;
+    static thread_local std::vector<int32_t> sums;
+    quantizedInput.resize(_cols);
+    sums.resize(_rows);
+
+    bool relu = (_act.getActivationType() == Relu);
+
+    // Goes over the images, every one is quantized with its own scale
+    for (int c = 0; c < input.getCols(); c++)
+    {
+        // a col of a batch is strided, it is copied out so the kernels read it contiguously
+        const float* values = input.data() + c;
+        if (input.getStride() != 1)
+        {
+            image.resize(_cols);
+            for (int j = 0; j < _cols; j++)
+            {
+                image[j] = input(j, c);
+            }
+            values = image.data();
+        }
+
+        float min;
+        float max;
+        simdMinMax(values, _cols, &min, &max);
+
+        // an input with no negative values (after relu) uses the whole byte
+        int zeroPoint = (min >= 0) ? 0 : SIGNED_ZERO_POINT;
+        float maxAbs = std::fmax(max, -min);
+        float scale = (min >= 0) ? (max / UINT8_MAX_VALUE) : (maxAbs / INT8_MAX_VALUE);
+        scale = (scale > 0) ? scale : 1;
+        simdQuantizeBytes(values, _cols, 1 / scale, zeroPoint, quantizedInput.data());
+
+        const uint8_t* x = quantizedInput.data();
+        int32_t* y = sums.data();
+        if ((pool == nullptr) || ((long)_rows * _cols < PARALLEL_MIN_WORK))
+        {
+            simdGemvInt8(_rows, _cols, _w.data(), _cols, x, y);
+        }
+        else
+        {
+            pool->parallelFor(0, _rows, QUANTIZED_GRAIN_ROWS, [&](int from, int to)
+            {
+                simdGemvInt8(to - from, _cols, _w.data() + (long)from * _cols, _cols, x,
+                             y + from);
+            });
+        }
+
+        // Dequantizes the sums, the zero point added zeroPoint times the sum of every row
+        for (int i = 0; i < _rows; i++)
+        {
+            float value = (float)(y[i] - zeroPoint * _sums[i]) * _scales[i] * scale + _bias[i];
+            output(i, c) = (relu && (value < 0)) ? 0 : value;
+        }
+    }
+
+    if (!relu && softmax)
+    {
+        _act.apply(output);
+    }
+}
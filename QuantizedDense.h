@@ -0,0 +1,75 @@
+
+//QuantizedDense.h
+
+#ifndef QUANTIZEDDENSE_H
+#define QUANTIZEDDENSE_H
+
+#include "Dense.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief class that represents a dense with its weights quantized to 8 bits after training.
+ *        every row of the weights has its own scale (the largest absolute weight in it / 127),
+ *        the input is quantized on the fly per image, the products are summed in 32 bits and
+ *        the sums are dequantized to floats before the bias and the activation
+ */
+class QuantizedDense
+{
+public:
+    /**
+     * @brief constructor for quantized dense, quantizes the weights of a float dense
+     * @param dense - the float dense
+     */
+    explicit QuantizedDense(const Dense& dense);
+
+    /**
+     * @brief returns the number of rows of the weights (the size of the output)
+     * @return the number of rows
+     */
+    int getRows() const;
+
+    /**
+     * @brief returns the number of cols of the weights (the size of the input)
+     * @return the number of cols
+     */
+    int getCols() const;
+
+    /**
+     * @brief switches the softmax of the dense to the fast exp, or back to std::exp
+     * @param fastExp - true for the fast exp
+     */
+    void setFastExp(bool fastExp);
+
+    /**
+     * @brief performs the activation function on a row-major input array, writing straight
+     *        into a preallocated output array, like Dense::forward
+     * @param input - the input array, the cols of the weights matrix times cols floats
+     * @param cols - the number of cols in the input, one per image
+     * @param output - the output array, the rows of the weights matrix times cols floats
+     * @param pool - the thread pool, or nullptr to run on the calling thread
+     * @param softmax - false to leave the output before softmax (relu is always performed)
+     */
+    void forward(const float* input, int cols, float* output, ThreadPool* pool = nullptr,
+                 bool softmax = true) const;
+
+    /**
+     * @brief like the forward on arrays, on views of any stride, like Dense::forward
+     * @param input - the input, the cols of the weights matrix rows, one column per image
+     * @param output - the output, the rows of the weights matrix rows, as many cols as input
+     * @param pool - the thread pool, or nullptr to run on the calling thread
+     * @param softmax - false to leave the output before softmax (relu is always performed)
+     */
+    void forward(ConstMatrixView input, MatrixView output, ThreadPool* pool = nullptr,
+                 bool softmax = true) const;
+private:
+    int _rows;                    // the number of rows of the weights
+    int _cols;                    // the number of cols of the weights
+    std::vector<int8_t> _w;       // the quantized weights, row after row
+    std::vector<float> _scales;   // the scale of every row
+    std::vector<int32_t> _sums;   // the sum of the quantized weights of every row
+    std::vector<float> _bias;     // the bias, not quantized
+    Activation _act;              // the activation of the dense
+};
+
+#endif //QUANTIZEDDENSE_H
@@ -0,0 +1,64 @@
+/**
+* @file   Serve.cpp
+* @brief a program that runs an inference daemon: it serves a model to local clients on a
+ *       Unix domain socket, in micro-batches, until SIGINT or SIGTERM.
+* @section DESCRIPTION usage: server model socket [maxBatch] [maxDelayMicros]
+ *          the model is a model file (see ModelFile.h), the protocol is in InferenceServer.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "InferenceServer.h"
+#include <csignal>
+
+#define ARGS_COUNT_MIN 3
+#define ARGS_COUNT_MAX 5
+#define MODEL_ARG 1
+#define SOCKET_ARG 2
+#define BATCH_ARG 3
+#define DELAY_ARG 4
+#define DEFAULT_MAX_BATCH 32
+#define DEFAULT_MAX_DELAY_MICROS 200
+#define USAGE_MSG "Usage: server model socket [maxBatch] [maxDelayMicros]"
+
+static InferenceServer* runningServer = nullptr; // the server the signals stop
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief the handler of SIGINT and SIGTERM, stops the server
+ * @param signal - the signal
+ */
+static void stopServer(int signal)
+{
+    (void)signal;
+    if (runningServer != nullptr)
+    {
+        runningServer->stop();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if ((argc < ARGS_COUNT_MIN) || (argc > ARGS_COUNT_MAX))
+    {
+        std::cerr << USAGE_MSG << std::endl;
+        return EXIT_FAILURE;
+    }
+    int maxBatch = (argc > BATCH_ARG) ? std::atoi(argv[BATCH_ARG]) : DEFAULT_MAX_BATCH;
+    int maxDelay = (argc > DELAY_ARG) ? std::atoi(argv[DELAY_ARG]) : DEFAULT_MAX_DELAY_MICROS;
+
+    ModelFile model(argv[MODEL_ARG]);
+    MlpNetwork network(model);
+    InferenceServer server(network, argv[SOCKET_ARG], maxBatch, maxDelay);
+
+    runningServer = &server;
+    struct sigaction action = {};
+    action.sa_handler = stopServer;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    server.run();
+    runningServer = nullptr;
+    server.printStats(std::cout);
+    return EXIT_SUCCESS;
+}
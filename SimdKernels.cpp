@@ -0,0 +1,2520 @@
+/**
+* @file   SimdKernels.cpp
+* @brief a program that implements SimdKernels.h. every kernel has a scalar version and, on x86,
+ *       an sse4.2, avx2 and avx-512 version compiled with target attributes, so one binary runs
+ *       on every host. the version is chosen at runtime from cpuid.
+* @section DESCRIPTION a program that implements SimdKernels.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+
+#include "SimdKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MLP_X86
+#include <immintrin.h>
+#endif
+
+#define ISA_ENV_VAR              "MLP_ISA"
+#define STR_UNSUPPORTED_ISA_ERR  "Error: instruction set is not supported by this cpu: "
+#define STR_UNKNOWN_ISA_ERR      "Error: unknown instruction set in MLP_ISA: "
+#define ISA_LEVELS 4
+#define GEMV_ROWS 4
+
+// the fast exp: exp(x) = 2^n * exp(r) with n = round(x / ln2) and |r| <= ln2 / 2, exp(r) is a
+// degree 5 polynomial (the coefficients of cephes expf)
+#define EXP_MIN -87.0f               // exp of less is a denormal, the input is clamped
+#define EXP_MAX 88.0f                // exp of more overflows, the input is clamped
+#define EXP_LOG2E 1.44269504088896341f
+#define EXP_LN2_HI 0.693359375f      // ln2 split in two, so n * EXP_LN2_HI is exact
+#define EXP_LN2_LO -2.12194440e-4f
+#define EXP_P0 1.9875691500e-4f
+#define EXP_P1 1.3981999507e-3f
+#define EXP_P2 8.3334519073e-3f
+#define EXP_P3 4.1665795894e-2f
+#define EXP_P4 1.6666665459e-1f
+#define EXP_P5 5.0000001201e-1f
+#define FLOAT_EXPONENT_BIAS 127
+#define FLOAT_MANTISSA_BITS 23
+
+// the 16 bit floats: an ieee half has 5 bits of exponent (bias 15) and 10 of mantissa, a
+// bfloat16 is the top 16 bits of a float
+#define FLOAT_SIGN 0x80000000u
+#define FLOAT_INFINITY 0x7f800000u
+#define HALF_SIGN 0x8000u
+#define HALF_INFINITY 0x7c00u
+#define HALF_QUIET_NAN 0x0200u
+#define HALF_MANTISSA_BITS 10
+#define HALF_MANTISSA_MASK 0x03ffu
+#define HALF_DROPPED_BITS 13          // the bits of the float mantissa a half drops
+#define HALF_DROPPED_MASK 0x1fffu
+#define HALF_REBIAS 0x38000000u       // (127 - 15) << 23, the exponent biases of a float and half
+#define HALF_MIN_NORMAL 0x38800000u   // 2^-14 as a float, less is a denormal half
+#define HALF_OVERFLOW 0x477ff000u     // 65520 as a float, it and more round to infinity
+#define HALF_DENORMAL_BITS 24         // a denormal half counts steps of 2^-24
+#define HALF_BFLOAT16_QUIET_NAN 0x0040u
+
+#define TARGET_SSE42  __attribute__((target("sse4.2")))
+#define TARGET_AVX2   __attribute__((target("avx2,fma,f16c")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#define TARGET_VNNI   __attribute__((target("avx512f,avx512bw,avx512vnni")))
+#define TARGET_BF16   __attribute__((target("avx512f,avx512bf16")))
+
+/**
+ * @struct KernelTable
+ * @brief the kernels of one instruction set level
+ */
+typedef struct KernelTable
+{
+    void (*add)(const float* a, const float* b, float* out, int size);
+    void (*addInPlace)(float* a, const float* b, int size);
+    void (*scale)(const float* a, float scalar, float* out, int size);
+    void (*scaleAdd)(const float* a, float scalar, const float* b, float* out, int size);
+    void (*copy)(const float* src, float* dst, int size);
+    void (*fill)(float* dst, float value, int size);
+    void (*gemv)(int m, int k, const float* a, int lda, const float* x, const float* bias,
+                 bool relu, float* y);
+    void (*gemvInt8)(int m, int k, const int8_t* a, int lda, const uint8_t* x, int32_t* y);
+    void (*minMax)(const float* values, int size, float* min, float* max);
+    void (*quantizeBytes)(const float* values, int size, float inverseScale, int zeroPoint,
+                          uint8_t* out);
+    void (*panelTile)(int k, const float* panel, const float* b, int ldb, int cols, float* tile);
+    void (*gemmTile)(int k, const float* a, const float* b, float* c, int ldc, int rows, int cols,
+                     bool accumulate, const float* bias, bool relu);
+    void (*panelTileHalf)(int k, const uint16_t* panel, HalfFormat format, const float* b,
+                          int ldb, int cols, float* tile);
+    void (*floatToHalf)(const float* src, uint16_t* dst, int size, HalfFormat format);
+    void (*softmax)(float* values, int rows, int cols, int stride, bool fastExp);
+} KernelTable;
+
+// ------------------------------------------- scalar kernels -------------------------------------
+
+/**
+ * @brief finishes one output of a matrix-vector product: adds the bias and performs relu
+ * @param sum - the dot product of the row
+ * @param bias - the bias array, or nullptr for none
+ * @param i - the index of the row
+ * @param relu - true to perform relu on the result
+ * @return the output
+ */
+static inline float epilogue(float sum, const float* bias, int i, bool relu)
+{
+    if (bias != nullptr)
+    {
+        sum += bias[i];
+    }
+    return (relu && (sum < 0)) ? 0 : sum;
+}
+
+static void addScalar(const float* a, const float* b, float* out, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        out[i] = a[i] + b[i];
+    }
+}
+
+static void addInPlaceScalar(float* a, const float* b, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        a[i] += b[i];
+    }
+}
+
+static void scaleScalar(const float* a, float scalar, float* out, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        out[i] = a[i] * scalar;
+    }
+}
+
+static void scaleAddScalar(const float* a, float scalar, const float* b, float* out, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        out[i] = a[i] * scalar + b[i];
+    }
+}
+
+static void copyScalar(const float* src, float* dst, int size)
+{
+    std::memcpy(dst, src, sizeof(float) * size);
+}
+
+static void fillScalar(float* dst, float value, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        dst[i] = value;
+    }
+}
+
+static void gemvScalar(int m, int k, const float* a, int lda, const float* x, const float* bias,
+                       bool relu, float* y)
+{
+    int i = 0;
+
+    // Goes over GEMV_ROWS rows at a time so every load of x is used more than once
+    for (; i + GEMV_ROWS <= m; i += GEMV_ROWS)
+    {
+        const float* row0 = a + i * lda;
+        const float* row1 = row0 + lda;
+        const float* row2 = row1 + lda;
+        const float* row3 = row2 + lda;
+        float sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+
+        for (int kk = 0; kk < k; kk++)
+        {
+            float xValue = x[kk];
+            sum0 += row0[kk] * xValue;
+            sum1 += row1[kk] * xValue;
+            sum2 += row2[kk] * xValue;
+            sum3 += row3[kk] * xValue;
+        }
+        y[i] = epilogue(sum0, bias, i, relu);
+        y[i + 1] = epilogue(sum1, bias, i + 1, relu);
+        y[i + 2] = epilogue(sum2, bias, i + 2, relu);
+        y[i + 3] = epilogue(sum3, bias, i + 3, relu);
+    }
+
+    // the rows that are left
+    for (; i < m; i++)
+    {
+        const float* row = a + i * lda;
+        float sum = 0;
+        for (int kk = 0; kk < k; kk++)
+        {
+            sum += row[kk] * x[kk];
+        }
+        y[i] = epilogue(sum, bias, i, relu);
+    }
+}
+
+/**
+ * @brief adds one step of a panel to a tile: a column of weights times a row of b
+ * @param column - the PANEL_ROWS weights of the step
+ * @param bRow - the row of b of the step
+ * @param cols - the number of cols of the tile
+ * @param tile - the tile
+ */
+static inline void addStepScalar(const float* column, const float* bRow, int cols, float* tile)
+{
+    for (int j = 0; j < cols; j++)
+    {
+        float value = bRow[j];
+        float* out = tile + j * PANEL_ROWS;
+        for (int r = 0; r < PANEL_ROWS; r++)
+        {
+            out[r] += column[r] * value;
+        }
+    }
+}
+
+static void panelTileScalar(int k, const float* panel, const float* b, int ldb, int cols,
+                            float* tile)
+{
+    for (int j = 0; j < cols; j++)
+    {
+        for (int r = 0; r < PANEL_ROWS; r++)
+        {
+            tile[j * PANEL_ROWS + r] = panel[r];
+        }
+    }
+
+    // Goes over the steps of the panel, every step adds a column of weights times a row of b
+    const float* weights = panel + PANEL_ROWS;
+    for (int kk = 0; kk < k; kk++)
+    {
+        addStepScalar(weights + kk * PANEL_ROWS, b + (long)kk * ldb, cols, tile);
+    }
+}
+
+static void gemmTileScalar(int k, const float* a, const float* b, float* c, int ldc, int rows,
+                           int cols, bool accumulate, const float* bias, bool relu)
+{
+    float acc[GEMM_TILE_ROWS][GEMM_TILE_COLS] = {};
+
+    for (int kk = 0; kk < k; kk++)
+    {
+        for (int r = 0; r < GEMM_TILE_ROWS; r++)
+        {
+            float aValue = a[r];
+            for (int j = 0; j < GEMM_TILE_COLS; j++)
+            {
+                acc[r][j] += aValue * b[j];
+            }
+        }
+        a += GEMM_TILE_ROWS;
+        b += GEMM_TILE_COLS;
+    }
+
+    for (int r = 0; r < rows; r++)
+    {
+        float rowBias = (bias == nullptr) ? 0 : bias[r];
+        for (int j = 0; j < cols; j++)
+        {
+            float value = acc[r][j] + rowBias + (accumulate ? c[r * ldc + j] : 0);
+            c[r * ldc + j] = (relu && (value < 0)) ? 0 : value;
+        }
+    }
+}
+
+/**
+ * @brief converts a float to an ieee half, rounded to the nearest even. a float too large for
+ *        a half is infinity, a float too small is a denormal half or zero
+ * @param value - the float
+ * @return the bits of the half
+ */
+static uint16_t floatToIeeeHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (uint16_t)((bits >> 16) & HALF_SIGN);
+    uint32_t magnitude = bits & ~FLOAT_SIGN;
+
+    if (magnitude > FLOAT_INFINITY)
+    {
+        return sign | HALF_INFINITY | HALF_QUIET_NAN;
+    }
+    if (magnitude >= HALF_OVERFLOW)
+    {
+        return sign | HALF_INFINITY;
+    }
+    if (magnitude < HALF_MIN_NORMAL)
+    {
+        // a denormal half counts steps of 2^-24, the float times 2^24 is exact
+        return sign | (uint16_t)std::nearbyint(std::ldexp(std::fabs(value), HALF_DENORMAL_BITS));
+    }
+
+    // rebiases the exponent and rounds the mantissa from 23 to 10 bits, a carry goes into the
+    // exponent as it should
+    uint32_t half = (magnitude - HALF_REBIAS) >> HALF_DROPPED_BITS;
+    uint32_t rest = magnitude & HALF_DROPPED_MASK;
+    uint32_t middle = HALF_DROPPED_MASK / 2 + 1;
+    if ((rest > middle) || ((rest == middle) && (half & 1)))
+    {
+        half++;
+    }
+    return sign | (uint16_t)half;
+}
+
+/**
+ * @brief converts an ieee half to a float, exactly
+ * @param value - the bits of the half
+ * @return the float
+ */
+static float ieeeHalfToFloat(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & HALF_SIGN) << 16;
+    uint32_t exponent = (value & HALF_INFINITY) >> HALF_MANTISSA_BITS;
+    uint32_t mantissa = value & HALF_MANTISSA_MASK;
+
+    if (exponent == 0)
+    {
+        float denormal = std::ldexp((float)mantissa, -HALF_DENORMAL_BITS);
+        return sign ? -denormal : denormal;
+    }
+    uint32_t bits = (exponent == (HALF_INFINITY >> HALF_MANTISSA_BITS)) ?
+                    (sign | FLOAT_INFINITY | (mantissa << HALF_DROPPED_BITS)) :
+                    (sign | (((value & ~HALF_SIGN) << HALF_DROPPED_BITS) + HALF_REBIAS));
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/**
+ * @brief converts a float to a bfloat16 (its top 16 bits), rounded to the nearest even. a
+ *        denormal float is flushed to a zero of its sign, like the avx-512 bf16 instruction
+ *        does, so both give the same weights
+ * @param value - the float
+ * @return the bits of the bfloat16
+ */
+static uint16_t floatToBfloat16(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & ~FLOAT_SIGN) > FLOAT_INFINITY)
+    {
+        return (uint16_t)(bits >> 16) | HALF_BFLOAT16_QUIET_NAN;
+    }
+    if ((bits & FLOAT_INFINITY) == 0)
+    {
+        return (uint16_t)((bits & FLOAT_SIGN) >> 16);
+    }
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return (uint16_t)(bits >> 16);
+}
+
+/**
+ * @brief converts a bfloat16 to a float, exactly
+ * @param value - the bits of the bfloat16
+ * @return the float
+ */
+static inline float bfloat16ToFloat(uint16_t value)
+{
+    uint32_t bits = (uint32_t)value << 16;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static void floatToHalfScalar(const float* src, uint16_t* dst, int size, HalfFormat format)
+{
+    for (int i = 0; i < size; i++)
+    {
+        dst[i] = (format == HalfIeee) ? floatToIeeeHalf(src[i]) : floatToBfloat16(src[i]);
+    }
+}
+
+/**
+ * @brief like panelTileScalar on a panel of 16 bit weights (see simdPanelTileHalf), every step
+ *        is widened to floats before it is added
+ */
+template <HalfFormat FORMAT>
+static void panelTileHalfScalarAs(int k, const uint16_t* panel, const float* b, int ldb, int cols,
+                                  float* tile)
+{
+    float bias[PANEL_ROWS];
+    std::memcpy(bias, panel, sizeof(bias));
+    for (int j = 0; j < cols; j++)
+    {
+        for (int r = 0; r < PANEL_ROWS; r++)
+        {
+            tile[j * PANEL_ROWS + r] = bias[r];
+        }
+    }
+
+    const uint16_t* weights = panel + PANEL_HALF_BIAS;
+    for (int kk = 0; kk < k; kk++)
+    {
+        float column[PANEL_ROWS];
+        for (int r = 0; r < PANEL_ROWS; r++)
+        {
+            uint16_t weight = weights[kk * PANEL_ROWS + r];
+            column[r] = (FORMAT == HalfIeee) ? ieeeHalfToFloat(weight) : bfloat16ToFloat(weight);
+        }
+        addStepScalar(column, b + (long)kk * ldb, cols, tile);
+    }
+}
+
+static void panelTileHalfScalar(int k, const uint16_t* panel, HalfFormat format, const float* b,
+                                int ldb, int cols, float* tile)
+{
+    if (format == HalfIeee)
+    {
+        panelTileHalfScalarAs<HalfIeee>(k, panel, b, ldb, cols, tile);
+        return;
+    }
+    panelTileHalfScalarAs<HalfBfloat16>(k, panel, b, ldb, cols, tile);
+}
+
+static void gemvInt8Scalar(int m, int k, const int8_t* a, int lda, const uint8_t* x, int32_t* y)
+{
+    for (int i = 0; i < m; i++)
+    {
+        const int8_t* row = a + i * lda;
+        int32_t sum = 0;
+        for (int kk = 0; kk < k; kk++)
+        {
+            sum += (int32_t)row[kk] * (int32_t)x[kk];
+        }
+        y[i] = sum;
+    }
+}
+
+static void minMaxScalar(const float* values, int size, float* min, float* max)
+{
+    float low = values[0];
+    float high = values[0];
+    for (int i = 1; i < size; i++)
+    {
+        low = std::fmin(low, values[i]);
+        high = std::fmax(high, values[i]);
+    }
+    *min = low;
+    *max = high;
+}
+
+/**
+ * @brief quantizes one float to a byte (see simdQuantizeBytes), nearbyint rounds to the nearest
+ *        even like the conversion of the vector kernels
+ */
+static inline uint8_t quantizeByte(float value, float inverseScale, int zeroPoint)
+{
+    float quantized = std::nearbyint(value * inverseScale) + (float)zeroPoint;
+    return (uint8_t)std::fmin(std::fmax(quantized, 0.0f), (float)UINT8_MAX);
+}
+
+static void quantizeBytesScalar(const float* values, int size, float inverseScale, int zeroPoint,
+                                uint8_t* out)
+{
+    for (int i = 0; i < size; i++)
+    {
+        out[i] = quantizeByte(values[i], inverseScale, zeroPoint);
+    }
+}
+
+/**
+ * @brief the fast exp of one float, see simdExpFast
+ * @param x - the exponent
+ * @return e^x
+ */
+static inline float expFastScalar(float x)
+{
+    x = std::min(std::max(x, EXP_MIN), EXP_MAX);
+    float n = std::nearbyint(x * EXP_LOG2E);
+    float r = x - n * EXP_LN2_HI;
+    r = r - n * EXP_LN2_LO;
+
+    float p = EXP_P0;
+    p = p * r + EXP_P1;
+    p = p * r + EXP_P2;
+    p = p * r + EXP_P3;
+    p = p * r + EXP_P4;
+    p = p * r + EXP_P5;
+    p = p * r * r + r + 1;
+
+    // 2^n, built straight in the exponent bits
+    int32_t bits = ((int32_t)n + FLOAT_EXPONENT_BIAS) << FLOAT_MANTISSA_BITS;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+/**
+ * @brief performs std::exp on a few floats in place, the accurate mode of the vector softmax
+ *        kernels runs it on the lanes of one vector
+ * @param values - the floats
+ * @param count - the number of floats
+ */
+static inline void expLanes(float* values, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = std::exp(values[i]);
+    }
+}
+
+/**
+ * @brief performs softmax on one column of a row-major array, in place
+ * @param column - the first float of the column
+ * @param rows - the number of rows
+ * @param stride - the distance between two rows
+ * @param fastExp - true for the fast exp, false for std::exp
+ */
+static void softmaxColumnScalar(float* column, int rows, int stride, bool fastExp)
+{
+    float max = column[0];
+    for (int i = 1; i < rows; i++)
+    {
+        max = std::max(max, column[i * stride]);
+    }
+
+    float sum = 0;
+    for (int i = 0; i < rows; i++)
+    {
+        float shifted = column[i * stride] - max;
+        float e = fastExp ? expFastScalar(shifted) : std::exp(shifted);
+        column[i * stride] = e;
+        sum += e;
+    }
+
+    float division = 1 / sum;
+    for (int i = 0; i < rows; i++)
+    {
+        column[i * stride] *= division;
+    }
+}
+
+static void softmaxScalar(float* values, int rows, int cols, int stride, bool fastExp)
+{
+    for (int j = 0; j < cols; j++)
+    {
+        softmaxColumnScalar(values + j, rows, stride, fastExp);
+    }
+}
+
+#ifdef MLP_X86
+
+// ------------------------------------------- sse4.2 kernels -------------------------------------
+
+TARGET_SSE42 static inline float horizontalSum128(__m128 v)
+{
+    v = _mm_hadd_ps(v, v);
+    v = _mm_hadd_ps(v, v);
+    return _mm_cvtss_f32(v);
+}
+
+/**
+ * @brief loads the first count floats of a 4-float vector (0 < count < 4), the other lanes are 0.
+ *        sse has no masked load, so the tail is put together from single and double loads and
+ *        nothing past the count is read
+ */
+TARGET_SSE42 static inline __m128 loadTail128(const float* src, int count)
+{
+    if (count == 1)
+    {
+        return _mm_load_ss(src);
+    }
+    __m128 low = _mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)src));
+    return (count == 2) ? low : _mm_movelh_ps(low, _mm_load_ss(src + 2));
+}
+
+/**
+ * @brief stores the first count lanes of a 4-float vector (0 < count < 4), see loadTail128
+ */
+TARGET_SSE42 static inline void storeTail128(float* dst, __m128 v, int count)
+{
+    if (count == 1)
+    {
+        _mm_store_ss(dst, v);
+        return;
+    }
+    _mm_storel_epi64((__m128i*)dst, _mm_castps_si128(v));
+    if (count == 3)
+    {
+        _mm_store_ss(dst + 2, _mm_movehl_ps(v, v));
+    }
+}
+
+TARGET_SSE42 static void addSse42(const float* a, const float* b, float* out, int size)
+{
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    if (i < size)
+    {
+        int count = size - i;
+        storeTail128(out + i, _mm_add_ps(loadTail128(a + i, count), loadTail128(b + i, count)),
+                     count);
+    }
+}
+
+TARGET_SSE42 static void addInPlaceSse42(float* a, const float* b, int size)
+{
+    addSse42(a, b, a, size);
+}
+
+TARGET_SSE42 static void scaleSse42(const float* a, float scalar, float* out, int size)
+{
+    __m128 s = _mm_set1_ps(scalar);
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), s));
+    }
+    if (i < size)
+    {
+        int count = size - i;
+        storeTail128(out + i, _mm_mul_ps(loadTail128(a + i, count), s), count);
+    }
+}
+
+TARGET_SSE42 static void scaleAddSse42(const float* a, float scalar, const float* b, float* out,
+                                       int size)
+{
+    __m128 s = _mm_set1_ps(scalar);
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        __m128 scaled = _mm_mul_ps(_mm_loadu_ps(a + i), s);
+        _mm_storeu_ps(out + i, _mm_add_ps(scaled, _mm_loadu_ps(b + i)));
+    }
+    if (i < size)
+    {
+        int count = size - i;
+        __m128 scaled = _mm_mul_ps(loadTail128(a + i, count), s);
+        storeTail128(out + i, _mm_add_ps(scaled, loadTail128(b + i, count)), count);
+    }
+}
+
+TARGET_SSE42 static void copySse42(const float* src, float* dst, int size)
+{
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        _mm_storeu_ps(dst + i, _mm_loadu_ps(src + i));
+    }
+    if (i < size)
+    {
+        storeTail128(dst + i, loadTail128(src + i, size - i), size - i);
+    }
+}
+
+TARGET_SSE42 static void fillSse42(float* dst, float value, int size)
+{
+    __m128 v = _mm_set1_ps(value);
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        _mm_storeu_ps(dst + i, v);
+    }
+    if (i < size)
+    {
+        storeTail128(dst + i, v, size - i);
+    }
+}
+
+TARGET_SSE42 static void gemvSse42(int m, int k, const float* a, int lda, const float* x,
+                                   const float* bias, bool relu, float* y)
+{
+    // the tail of every row is a partial load, so no scalar loop is left over
+    int tail = k % 4;
+    int i = 0;
+    for (; i + GEMV_ROWS <= m; i += GEMV_ROWS)
+    {
+        const float* row0 = a + i * lda;
+        const float* row1 = row0 + lda;
+        const float* row2 = row1 + lda;
+        const float* row3 = row2 + lda;
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        __m128 acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+
+        int kk = 0;
+        for (; kk + 4 <= k; kk += 4)
+        {
+            __m128 xv = _mm_loadu_ps(x + kk);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(row0 + kk), xv));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(row1 + kk), xv));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(row2 + kk), xv));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_loadu_ps(row3 + kk), xv));
+        }
+        if (tail)
+        {
+            __m128 xv = loadTail128(x + kk, tail);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(loadTail128(row0 + kk, tail), xv));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(loadTail128(row1 + kk, tail), xv));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(loadTail128(row2 + kk, tail), xv));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(loadTail128(row3 + kk, tail), xv));
+        }
+        y[i] = epilogue(horizontalSum128(acc0), bias, i, relu);
+        y[i + 1] = epilogue(horizontalSum128(acc1), bias, i + 1, relu);
+        y[i + 2] = epilogue(horizontalSum128(acc2), bias, i + 2, relu);
+        y[i + 3] = epilogue(horizontalSum128(acc3), bias, i + 3, relu);
+    }
+
+    // the rows that are left
+    for (; i < m; i++)
+    {
+        const float* row = a + i * lda;
+        __m128 acc = _mm_setzero_ps();
+        int kk = 0;
+        for (; kk + 4 <= k; kk += 4)
+        {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(row + kk), _mm_loadu_ps(x + kk)));
+        }
+        if (tail)
+        {
+            acc = _mm_add_ps(acc, _mm_mul_ps(loadTail128(row + kk, tail),
+                                             loadTail128(x + kk, tail)));
+        }
+        y[i] = epilogue(horizontalSum128(acc), bias, i, relu);
+    }
+}
+
+/**
+ * @brief computes COLS cols of a panel tile (see simdPanelTile), the panel is 4 vectors a step
+ */
+template <int COLS>
+TARGET_SSE42 static void panelTileColsSse42(int k, const float* panel, const float* b, int ldb,
+                                            float* tile)
+{
+    __m128 acc[COLS][4];
+    for (int j = 0; j < COLS; j++)
+    {
+        for (int v = 0; v < 4; v++)
+        {
+            acc[j][v] = _mm_loadu_ps(panel + 4 * v);
+        }
+    }
+
+    const float* weights = panel + PANEL_ROWS;
+    for (int kk = 0; kk < k; kk++)
+    {
+        const float* column = weights + kk * PANEL_ROWS;
+        const float* bRow = b + (long)kk * ldb;
+        __m128 w[4];
+        for (int v = 0; v < 4; v++)
+        {
+            w[v] = _mm_loadu_ps(column + 4 * v);
+        }
+        for (int j = 0; j < COLS; j++)
+        {
+            __m128 value = _mm_set1_ps(bRow[j]);
+            for (int v = 0; v < 4; v++)
+            {
+                acc[j][v] = _mm_add_ps(acc[j][v], _mm_mul_ps(w[v], value));
+            }
+        }
+    }
+
+    for (int j = 0; j < COLS; j++)
+    {
+        for (int v = 0; v < 4; v++)
+        {
+            _mm_storeu_ps(tile + j * PANEL_ROWS + 4 * v, acc[j][v]);
+        }
+    }
+}
+
+TARGET_SSE42 static void panelTileSse42(int k, const float* panel, const float* b, int ldb,
+                                        int cols, float* tile)
+{
+    // two cols at a time: their 8 sums and the 4 vectors of a step fill the 16 registers
+    int j = 0;
+    for (; j + 2 <= cols; j += 2)
+    {
+        panelTileColsSse42<2>(k, panel, b + j, ldb, tile + j * PANEL_ROWS);
+    }
+    if (j < cols)
+    {
+        panelTileColsSse42<1>(k, panel, b + j, ldb, tile + j * PANEL_ROWS);
+    }
+}
+
+TARGET_SSE42 static inline int32_t horizontalSumInt128(__m128i v)
+{
+    v = _mm_hadd_epi32(v, v);
+    v = _mm_hadd_epi32(v, v);
+    return _mm_cvtsi128_si32(v);
+}
+
+TARGET_SSE42 static void gemvInt8Sse42(int m, int k, const int8_t* a, int lda, const uint8_t* x,
+                                       int32_t* y)
+{
+    // Goes over the rows, widening 8 bytes of the row and of x to 16 bits at a time, the
+    // multiply-add of pairs then gives 4 sums of 32 bits. the tail of x is read once into 8
+    // zeroed bytes, so the tail of a row needs only its own bytes and no scalar loop
+    int tail = k % 8;
+    int body = k - tail;
+    __m128i xTail = _mm_setzero_si128();
+    if (tail)
+    {
+        uint8_t bytes[8] = {0};
+        std::memcpy(bytes, x + body, tail);
+        xTail = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)bytes));
+    }
+    for (int i = 0; i < m; i++)
+    {
+        const int8_t* row = a + i * lda;
+        __m128i acc = _mm_setzero_si128();
+        for (int kk = 0; kk < body; kk += 8)
+        {
+            __m128i w = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)(row + kk)));
+            __m128i v = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(x + kk)));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(w, v));
+        }
+        if (tail)
+        {
+            int8_t bytes[8] = {0};
+            std::memcpy(bytes, row + body, tail);
+            __m128i w = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)bytes));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(w, xTail));
+        }
+        y[i] = horizontalSumInt128(acc);
+    }
+}
+
+/**
+ * @brief finds the smallest of the lanes of low and the largest of the lanes of high
+ */
+TARGET_SSE42 static inline void reduceMinMax128(__m128 low, __m128 high, float* min, float* max)
+{
+    low = _mm_min_ps(low, _mm_movehl_ps(low, low));
+    low = _mm_min_ss(low, _mm_shuffle_ps(low, low, 1));
+    high = _mm_max_ps(high, _mm_movehl_ps(high, high));
+    high = _mm_max_ss(high, _mm_shuffle_ps(high, high, 1));
+    *min = _mm_cvtss_f32(low);
+    *max = _mm_cvtss_f32(high);
+}
+
+TARGET_SSE42 static void minMaxSse42(const float* values, int size, float* min, float* max)
+{
+    // the lanes past the end of the array are the first float, so they change nothing
+    __m128 first = _mm_set1_ps(values[0]);
+    __m128 low = first;
+    __m128 high = first;
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        __m128 v = _mm_loadu_ps(values + i);
+        low = _mm_min_ps(v, low);
+        high = _mm_max_ps(v, high);
+    }
+    if (i < size)
+    {
+        __m128 mask = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_set1_epi32(size - i),
+                                                       _mm_setr_epi32(0, 1, 2, 3)));
+        __m128 v = _mm_blendv_ps(first, loadTail128(values + i, size - i), mask);
+        low = _mm_min_ps(v, low);
+        high = _mm_max_ps(v, high);
+    }
+    reduceMinMax128(low, high, min, max);
+}
+
+/**
+ * @brief quantizes 4 floats to 4 int32 lanes of bytes before they are packed, see
+ *        simdQuantizeBytes
+ */
+TARGET_SSE42 static inline __m128i quantizeLanesSse42(__m128 v, __m128 inverseScale,
+                                                      __m128i zeroPoint)
+{
+    return _mm_add_epi32(_mm_cvtps_epi32(_mm_mul_ps(v, inverseScale)), zeroPoint);
+}
+
+TARGET_SSE42 static void quantizeBytesSse42(const float* values, int size, float inverseScale,
+                                            int zeroPoint, uint8_t* out)
+{
+    __m128 scale = _mm_set1_ps(inverseScale);
+    __m128i zero = _mm_set1_epi32(zeroPoint);
+
+    // Goes over 16 floats at a time, packed with signed and then unsigned saturation
+    int i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        const float* v = values + i;
+        __m128i low = _mm_packs_epi32(quantizeLanesSse42(_mm_loadu_ps(v), scale, zero),
+                                      quantizeLanesSse42(_mm_loadu_ps(v + 4), scale, zero));
+        __m128i high = _mm_packs_epi32(quantizeLanesSse42(_mm_loadu_ps(v + 8), scale, zero),
+                                       quantizeLanesSse42(_mm_loadu_ps(v + 12), scale, zero));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(low, high));
+    }
+
+    // the floats that are left, 4 at a time and the last few as a partial vector
+    for (; i < size; i += 4)
+    {
+        int count = std::min(size - i, 4);
+        __m128 v = (count == 4) ? _mm_loadu_ps(values + i) : loadTail128(values + i, count);
+        __m128i lanes = quantizeLanesSse42(v, scale, zero);
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(lanes, lanes), lanes);
+        int32_t packed = _mm_cvtsi128_si32(bytes);
+        std::memcpy(out + i, &packed, count);
+    }
+}
+
+/**
+ * @brief the fast exp of 4 floats, see simdExpFast
+ */
+TARGET_SSE42 static inline __m128 expFastSse42(__m128 x)
+{
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(EXP_MIN)), _mm_set1_ps(EXP_MAX));
+    __m128 n = _mm_round_ps(_mm_mul_ps(x, _mm_set1_ps(EXP_LOG2E)),
+                            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(EXP_LN2_HI)));
+    r = _mm_sub_ps(r, _mm_mul_ps(n, _mm_set1_ps(EXP_LN2_LO)));
+
+    __m128 p = _mm_set1_ps(EXP_P0);
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_P1));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_P2));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_P3));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_P4));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_P5));
+    p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p, _mm_mul_ps(r, r)), r), _mm_set1_ps(1));
+
+    __m128i bits = _mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(FLOAT_EXPONENT_BIAS));
+    return _mm_mul_ps(p, _mm_castsi128_ps(_mm_slli_epi32(bits, FLOAT_MANTISSA_BITS)));
+}
+
+/**
+ * @brief loads count floats (0 < count <= 4) of the columns of softmaxColumnsSse42
+ */
+TARGET_SSE42 static inline __m128 loadLanes128(const float* src, int count)
+{
+    return (count == 4) ? _mm_loadu_ps(src) : loadTail128(src, count);
+}
+
+/**
+ * @brief stores count floats (0 < count <= 4) of the columns of softmaxColumnsSse42
+ */
+TARGET_SSE42 static inline void storeLanes128(float* dst, __m128 v, int count)
+{
+    if (count == 4)
+    {
+        _mm_storeu_ps(dst, v);
+        return;
+    }
+    storeTail128(dst, v, count);
+}
+
+/**
+ * @brief performs softmax on up to 4 columns at once, every lane normalizes a column of its own.
+ *        the lanes past the count are 0 and are never stored
+ * @param column - the first float of the first column
+ * @param rows - the number of rows
+ * @param stride - the distance between two rows
+ * @param count - the number of columns, 1 to 4
+ * @param fastExp - true for the fast exp, false for std::exp
+ */
+TARGET_SSE42 static void softmaxColumnsSse42(float* column, int rows, int stride, int count,
+                                             bool fastExp)
+{
+    __m128 max = loadLanes128(column, count);
+    for (int i = 1; i < rows; i++)
+    {
+        max = _mm_max_ps(max, loadLanes128(column + i * stride, count));
+    }
+
+    __m128 sum = _mm_setzero_ps();
+    for (int i = 0; i < rows; i++)
+    {
+        float* row = column + i * stride;
+        __m128 e = _mm_sub_ps(loadLanes128(row, count), max);
+        if (fastExp)
+        {
+            e = expFastSse42(e);
+        }
+        else
+        {
+            storeLanes128(row, e, count);
+            expLanes(row, count);
+            e = loadLanes128(row, count);
+        }
+        storeLanes128(row, e, count);
+        sum = _mm_add_ps(sum, e);
+    }
+
+    __m128 division = _mm_div_ps(_mm_set1_ps(1), sum);
+    for (int i = 0; i < rows; i++)
+    {
+        float* row = column + i * stride;
+        storeLanes128(row, _mm_mul_ps(loadLanes128(row, count), division), count);
+    }
+}
+
+TARGET_SSE42 static void softmaxSse42(float* values, int rows, int cols, int stride, bool fastExp)
+{
+    // Goes over the columns 4 at a time, the cols that are left are a partial vector
+    for (int j = 0; j < cols; j += 4)
+    {
+        softmaxColumnsSse42(values + j, rows, stride, std::min(4, cols - j), fastExp);
+    }
+}
+
+// ------------------------------------------- avx2 kernels ---------------------------------------
+
+TARGET_AVX2 static inline float horizontalSum256(__m256 v)
+{
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_hadd_ps(sum, sum);
+    sum = _mm_hadd_ps(sum, sum);
+    return _mm_cvtss_f32(sum);
+}
+
+/**
+ * @brief returns a mask of the first count lanes of an 8-float vector (count < 8), for the
+ *        masked loads and stores of the tails, so a tail needs no scalar loop
+ */
+TARGET_AVX2 static inline __m256i tailMask256(int count)
+{
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+TARGET_AVX2 static void addAvx2(const float* a, const float* b, float* out, int size)
+{
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    if (i < size)
+    {
+        __m256i mask = tailMask256(size - i);
+        __m256 sum = _mm256_add_ps(_mm256_maskload_ps(a + i, mask),
+                                   _mm256_maskload_ps(b + i, mask));
+        _mm256_maskstore_ps(out + i, mask, sum);
+    }
+}
+
+TARGET_AVX2 static void addInPlaceAvx2(float* a, const float* b, int size)
+{
+    addAvx2(a, b, a, size);
+}
+
+TARGET_AVX2 static void scaleAvx2(const float* a, float scalar, float* out, int size)
+{
+    __m256 s = _mm256_set1_ps(scalar);
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), s));
+    }
+    if (i < size)
+    {
+        __m256i mask = tailMask256(size - i);
+        _mm256_maskstore_ps(out + i, mask, _mm256_mul_ps(_mm256_maskload_ps(a + i, mask), s));
+    }
+}
+
+// the product is rounded before the add (no fma), so every level gives the same result
+TARGET_AVX2 static void scaleAddAvx2(const float* a, float scalar, const float* b, float* out,
+                                     int size)
+{
+    __m256 s = _mm256_set1_ps(scalar);
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        __m256 scaled = _mm256_mul_ps(_mm256_loadu_ps(a + i), s);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(scaled, _mm256_loadu_ps(b + i)));
+    }
+    if (i < size)
+    {
+        __m256i mask = tailMask256(size - i);
+        __m256 scaled = _mm256_mul_ps(_mm256_maskload_ps(a + i, mask), s);
+        _mm256_maskstore_ps(out + i, mask, _mm256_add_ps(scaled, _mm256_maskload_ps(b + i, mask)));
+    }
+}
+
+TARGET_AVX2 static void copyAvx2(const float* src, float* dst, int size)
+{
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        _mm256_storeu_ps(dst + i, _mm256_loadu_ps(src + i));
+    }
+    if (i < size)
+    {
+        __m256i mask = tailMask256(size - i);
+        _mm256_maskstore_ps(dst + i, mask, _mm256_maskload_ps(src + i, mask));
+    }
+}
+
+TARGET_AVX2 static void fillAvx2(float* dst, float value, int size)
+{
+    __m256 v = _mm256_set1_ps(value);
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        _mm256_storeu_ps(dst + i, v);
+    }
+    if (i < size)
+    {
+        _mm256_maskstore_ps(dst + i, tailMask256(size - i), v);
+    }
+}
+
+TARGET_AVX2 static void gemvAvx2(int m, int k, const float* a, int lda, const float* x,
+                                 const float* bias, bool relu, float* y)
+{
+    // the tail of every row is a masked load, so no scalar loop is left over
+    int tail = k % 8;
+    __m256i mask = tailMask256(tail);
+    int i = 0;
+    for (; i + GEMV_ROWS <= m; i += GEMV_ROWS)
+    {
+        const float* row0 = a + i * lda;
+        const float* row1 = row0 + lda;
+        const float* row2 = row1 + lda;
+        const float* row3 = row2 + lda;
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+
+        int kk = 0;
+        for (; kk + 8 <= k; kk += 8)
+        {
+            __m256 xv = _mm256_loadu_ps(x + kk);
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(row0 + kk), xv, acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(row1 + kk), xv, acc1);
+            acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(row2 + kk), xv, acc2);
+            acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(row3 + kk), xv, acc3);
+        }
+        if (tail)
+        {
+            __m256 xv = _mm256_maskload_ps(x + kk, mask);
+            acc0 = _mm256_fmadd_ps(_mm256_maskload_ps(row0 + kk, mask), xv, acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_maskload_ps(row1 + kk, mask), xv, acc1);
+            acc2 = _mm256_fmadd_ps(_mm256_maskload_ps(row2 + kk, mask), xv, acc2);
+            acc3 = _mm256_fmadd_ps(_mm256_maskload_ps(row3 + kk, mask), xv, acc3);
+        }
+        y[i] = epilogue(horizontalSum256(acc0), bias, i, relu);
+        y[i + 1] = epilogue(horizontalSum256(acc1), bias, i + 1, relu);
+        y[i + 2] = epilogue(horizontalSum256(acc2), bias, i + 2, relu);
+        y[i + 3] = epilogue(horizontalSum256(acc3), bias, i + 3, relu);
+    }
+
+    // the rows that are left
+    for (; i < m; i++)
+    {
+        const float* row = a + i * lda;
+        __m256 acc = _mm256_setzero_ps();
+        int kk = 0;
+        for (; kk + 8 <= k; kk += 8)
+        {
+            acc = _mm256_fmadd_ps(_mm256_loadu_ps(row + kk), _mm256_loadu_ps(x + kk), acc);
+        }
+        if (tail)
+        {
+            acc = _mm256_fmadd_ps(_mm256_maskload_ps(row + kk, mask),
+                                  _mm256_maskload_ps(x + kk, mask), acc);
+        }
+        y[i] = epilogue(horizontalSum256(acc), bias, i, relu);
+    }
+}
+
+/**
+ * @brief the steps of a float panel for the avx2 tile kernel
+ */
+typedef struct FloatStepsAvx2
+{
+    typedef float Element;
+
+    TARGET_AVX2 static inline __m256 load(const float* step)
+    {
+        return _mm256_loadu_ps(step);
+    }
+} FloatStepsAvx2;
+
+/**
+ * @brief the steps of an ieee half panel for the avx2 tile kernel, widened with f16c
+ */
+typedef struct HalfStepsAvx2
+{
+    typedef uint16_t Element;
+
+    TARGET_AVX2 static inline __m256 load(const uint16_t* step)
+    {
+        return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)step));
+    }
+} HalfStepsAvx2;
+
+/**
+ * @brief the steps of a bfloat16 panel for the avx2 tile kernel, widened by a shift
+ */
+typedef struct Bfloat16StepsAvx2
+{
+    typedef uint16_t Element;
+
+    TARGET_AVX2 static inline __m256 load(const uint16_t* step)
+    {
+        __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)step));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+    }
+} Bfloat16StepsAvx2;
+
+/**
+ * @brief computes COLS cols of a panel tile (see simdPanelTile), the panel is 2 vectors a step,
+ *        loaded by Steps. one col sums the even and the odd steps apart, so 4 sums are in flight
+ */
+template <typename Steps, int COLS>
+TARGET_AVX2 static void panelTileColsAvx2(int k, const typename Steps::Element* panel,
+                                          const float* b, int ldb, float* tile)
+{
+    constexpr int SETS = (COLS == 1) ? 2 : 1;
+    // the bias is floats in every format
+    constexpr int BIAS = PANEL_ROWS * (int)(sizeof(float) / sizeof(typename Steps::Element));
+    __m256 acc[SETS][COLS][2];
+    for (int s = 0; s < SETS; s++)
+    {
+        for (int j = 0; j < COLS; j++)
+        {
+            const float* bias = (const float*)panel;
+            acc[s][j][0] = (s == 0) ? _mm256_loadu_ps(bias) : _mm256_setzero_ps();
+            acc[s][j][1] = (s == 0) ? _mm256_loadu_ps(bias + 8) : _mm256_setzero_ps();
+        }
+    }
+
+    const typename Steps::Element* weights = panel + BIAS;
+    int kk = 0;
+    for (; kk + SETS <= k; kk += SETS)
+    {
+        for (int s = 0; s < SETS; s++)
+        {
+            const typename Steps::Element* column = weights + (kk + s) * PANEL_ROWS;
+            const float* bRow = b + (long)(kk + s) * ldb;
+            __m256 w0 = Steps::load(column);
+            __m256 w1 = Steps::load(column + 8);
+            for (int j = 0; j < COLS; j++)
+            {
+                __m256 value = _mm256_set1_ps(bRow[j]);
+                acc[s][j][0] = _mm256_fmadd_ps(w0, value, acc[s][j][0]);
+                acc[s][j][1] = _mm256_fmadd_ps(w1, value, acc[s][j][1]);
+            }
+        }
+    }
+    for (; kk < k; kk++)
+    {
+        const typename Steps::Element* column = weights + kk * PANEL_ROWS;
+        const float* bRow = b + (long)kk * ldb;
+        __m256 w0 = Steps::load(column);
+        __m256 w1 = Steps::load(column + 8);
+        for (int j = 0; j < COLS; j++)
+        {
+            __m256 value = _mm256_set1_ps(bRow[j]);
+            acc[0][j][0] = _mm256_fmadd_ps(w0, value, acc[0][j][0]);
+            acc[0][j][1] = _mm256_fmadd_ps(w1, value, acc[0][j][1]);
+        }
+    }
+
+    for (int j = 0; j < COLS; j++)
+    {
+        for (int s = 1; s < SETS; s++)
+        {
+            acc[0][j][0] = _mm256_add_ps(acc[0][j][0], acc[s][j][0]);
+            acc[0][j][1] = _mm256_add_ps(acc[0][j][1], acc[s][j][1]);
+        }
+        _mm256_storeu_ps(tile + j * PANEL_ROWS, acc[0][j][0]);
+        _mm256_storeu_ps(tile + j * PANEL_ROWS + 8, acc[0][j][1]);
+    }
+}
+
+/**
+ * @brief computes a panel tile (see simdPanelTile) of a panel whose steps are loaded by Steps
+ */
+template <typename Steps>
+TARGET_AVX2 static void panelTileStepsAvx2(int k, const typename Steps::Element* panel,
+                                           const float* b, int ldb, int cols, float* tile)
+{
+    // up to 4 cols at a time: their 8 sums, the 2 vectors of a step and b fit the 16 registers
+    for (int j = 0; j < cols; j += 4)
+    {
+        const float* bCols = b + j;
+        float* out = tile + j * PANEL_ROWS;
+        switch (std::min(cols - j, 4))
+        {
+            case 1:
+                panelTileColsAvx2<Steps, 1>(k, panel, bCols, ldb, out);
+                break;
+            case 2:
+                panelTileColsAvx2<Steps, 2>(k, panel, bCols, ldb, out);
+                break;
+            case 3:
+                panelTileColsAvx2<Steps, 3>(k, panel, bCols, ldb, out);
+                break;
+            default:
+                panelTileColsAvx2<Steps, 4>(k, panel, bCols, ldb, out);
+                break;
+        }
+    }
+}
+
+TARGET_AVX2 static void panelTileAvx2(int k, const float* panel, const float* b, int ldb,
+                                      int cols, float* tile)
+{
+    panelTileStepsAvx2<FloatStepsAvx2>(k, panel, b, ldb, cols, tile);
+}
+
+TARGET_AVX2 static void panelTileHalfAvx2(int k, const uint16_t* panel, HalfFormat format,
+                                          const float* b, int ldb, int cols, float* tile)
+{
+    if (format == HalfIeee)
+    {
+        panelTileStepsAvx2<HalfStepsAvx2>(k, panel, b, ldb, cols, tile);
+        return;
+    }
+    panelTileStepsAvx2<Bfloat16StepsAvx2>(k, panel, b, ldb, cols, tile);
+}
+
+TARGET_AVX2 static void gemmTileAvx2(int k, const float* a, const float* b, float* c, int ldc,
+                                     int rows, int cols, bool accumulate, const float* bias,
+                                     bool relu)
+{
+    // a row of the tile is 2 vectors, so the 8 sums, the 2 vectors of a step of b and the
+    // broadcast of a fit in the 16 registers
+    __m256 acc[GEMM_TILE_ROWS][2];
+    for (int r = 0; r < GEMM_TILE_ROWS; r++)
+    {
+        acc[r][0] = _mm256_setzero_ps();
+        acc[r][1] = _mm256_setzero_ps();
+    }
+    for (int kk = 0; kk < k; kk++)
+    {
+        __m256 b0 = _mm256_loadu_ps(b);
+        __m256 b1 = _mm256_loadu_ps(b + 8);
+        for (int r = 0; r < GEMM_TILE_ROWS; r++)
+        {
+            __m256 aValue = _mm256_broadcast_ss(a + r);
+            acc[r][0] = _mm256_fmadd_ps(aValue, b0, acc[r][0]);
+            acc[r][1] = _mm256_fmadd_ps(aValue, b1, acc[r][1]);
+        }
+        a += GEMM_TILE_ROWS;
+        b += GEMM_TILE_COLS;
+    }
+
+    // Goes over the rows to store, a partial vector of cols is a masked load and store
+    for (int r = 0; r < rows; r++)
+    {
+        __m256 rowBias = _mm256_set1_ps((bias == nullptr) ? 0 : bias[r]);
+        float* out = c + r * ldc;
+        for (int v = 0; (v < 2) && (8 * v < cols); v++)
+        {
+            int count = std::min(cols - 8 * v, 8);
+            __m256i mask = tailMask256(count);
+            __m256 value = _mm256_add_ps(acc[r][v], rowBias);
+            if (accumulate)
+            {
+                value = _mm256_add_ps(value, _mm256_maskload_ps(out + 8 * v, mask));
+            }
+            if (relu)
+            {
+                value = _mm256_max_ps(value, _mm256_setzero_ps());
+            }
+            if (count == 8)
+            {
+                _mm256_storeu_ps(out + 8 * v, value);
+            }
+            else
+            {
+                _mm256_maskstore_ps(out + 8 * v, mask, value);
+            }
+        }
+    }
+}
+
+TARGET_AVX2 static void floatToHalfAvx2(const float* src, uint16_t* dst, int size,
+                                        HalfFormat format)
+{
+    // avx2 has no bfloat16 conversion
+    if (format == HalfBfloat16)
+    {
+        floatToHalfScalar(src, dst, size, format);
+        return;
+    }
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i*)(dst + i), half);
+    }
+    floatToHalfScalar(src + i, dst + i, size - i, format);
+}
+
+TARGET_AVX2 static void gemvInt8Avx2(int m, int k, const int8_t* a, int lda, const uint8_t* x,
+                                     int32_t* y)
+{
+    // like the sse4.2 version, with 16 bytes at a time
+    for (int i = 0; i < m; i++)
+    {
+        const int8_t* row = a + i * lda;
+        __m256i acc = _mm256_setzero_si256();
+        int kk = 0;
+        for (; kk + 16 <= k; kk += 16)
+        {
+            __m256i w = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(row + kk)));
+            __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(x + kk)));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(w, v));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                     _mm256_extracti128_si256(acc, 1));
+        half = _mm_hadd_epi32(half, half);
+        half = _mm_hadd_epi32(half, half);
+        int32_t sum = _mm_cvtsi128_si32(half);
+        for (; kk < k; kk++)
+        {
+            sum += (int32_t)row[kk] * (int32_t)x[kk];
+        }
+        y[i] = sum;
+    }
+}
+
+TARGET_AVX2 static void minMaxAvx2(const float* values, int size, float* min, float* max)
+{
+    // the lanes past the end of the array are the first float, so they change nothing
+    __m256 first = _mm256_set1_ps(values[0]);
+    __m256 low = first;
+    __m256 high = first;
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        __m256 v = _mm256_loadu_ps(values + i);
+        low = _mm256_min_ps(v, low);
+        high = _mm256_max_ps(v, high);
+    }
+    if (i < size)
+    {
+        __m256i mask = tailMask256(size - i);
+        __m256 v = _mm256_blendv_ps(first, _mm256_maskload_ps(values + i, mask),
+                                    _mm256_castsi256_ps(mask));
+        low = _mm256_min_ps(v, low);
+        high = _mm256_max_ps(v, high);
+    }
+    reduceMinMax128(_mm_min_ps(_mm256_castps256_ps128(low), _mm256_extractf128_ps(low, 1)),
+                    _mm_max_ps(_mm256_castps256_ps128(high), _mm256_extractf128_ps(high, 1)),
+                    min, max);
+}
+
+/**
+ * @brief quantizes 8 floats to 8 int32 lanes of bytes before they are packed, see
+ *        simdQuantizeBytes
+ */
+TARGET_AVX2 static inline __m256i quantizeLanesAvx2(__m256 v, __m256 inverseScale,
+                                                    __m256i zeroPoint)
+{
+    return _mm256_add_epi32(_mm256_cvtps_epi32(_mm256_mul_ps(v, inverseScale)), zeroPoint);
+}
+
+TARGET_AVX2 static void quantizeBytesAvx2(const float* values, int size, float inverseScale,
+                                          int zeroPoint, uint8_t* out)
+{
+    __m256 scale = _mm256_set1_ps(inverseScale);
+    __m256i zero = _mm256_set1_epi32(zeroPoint);
+
+    // Goes over 32 floats at a time. the packs work within the 128 bit halves, so the 4 byte
+    // groups come out interleaved and are put back in order with one permute
+    int i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        const float* v = values + i;
+        __m256i low = _mm256_packs_epi32(quantizeLanesAvx2(_mm256_loadu_ps(v), scale, zero),
+                                         quantizeLanesAvx2(_mm256_loadu_ps(v + 8), scale, zero));
+        __m256i high = _mm256_packs_epi32(
+            quantizeLanesAvx2(_mm256_loadu_ps(v + 16), scale, zero),
+            quantizeLanesAvx2(_mm256_loadu_ps(v + 24), scale, zero));
+        __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(low, high),
+                                                    _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        _mm256_storeu_si256((__m256i*)(out + i), bytes);
+    }
+
+    // the floats that are left, 8 at a time and the last few as a masked load
+    for (; i < size; i += 8)
+    {
+        int count = std::min(size - i, 8);
+        __m256 v = _mm256_maskload_ps(values + i, tailMask256(count));
+        __m256i lanes = quantizeLanesAvx2(v, scale, zero);
+        __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(lanes),
+                                        _mm256_extracti128_si256(lanes, 1));
+        int64_t packed = _mm_cvtsi128_si64(_mm_packus_epi16(words, words));
+        std::memcpy(out + i, &packed, count);
+    }
+}
+
+/**
+ * @brief the fast exp of 8 floats, see simdExpFast
+ */
+TARGET_AVX2 static inline __m256 expFastAvx2(__m256 x)
+{
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_MIN)), _mm256_set1_ps(EXP_MAX));
+    __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(EXP_LOG2E)),
+                               _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(EXP_LN2_HI), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(EXP_LN2_LO), r);
+
+    __m256 p = _mm256_set1_ps(EXP_P0);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P1));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P2));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P3));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P4));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(EXP_P5));
+    p = _mm256_add_ps(_mm256_fmadd_ps(p, _mm256_mul_ps(r, r), r), _mm256_set1_ps(1));
+
+    __m256i bits = _mm256_add_epi32(_mm256_cvtps_epi32(n),
+                                    _mm256_set1_epi32(FLOAT_EXPONENT_BIAS));
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(_mm256_slli_epi32(bits, FLOAT_MANTISSA_BITS)));
+}
+
+TARGET_AVX2 static void softmaxAvx2(float* values, int rows, int cols, int stride, bool fastExp)
+{
+    int j = 0;
+
+    // Goes over the columns 8 at a time, every lane normalizes a column of its own
+    for (; j + 8 <= cols; j += 8)
+    {
+        float* column = values + j;
+        __m256 max = _mm256_loadu_ps(column);
+        for (int i = 1; i < rows; i++)
+        {
+            max = _mm256_max_ps(max, _mm256_loadu_ps(column + i * stride));
+        }
+
+        __m256 sum = _mm256_setzero_ps();
+        for (int i = 0; i < rows; i++)
+        {
+            float* row = column + i * stride;
+            __m256 e = _mm256_sub_ps(_mm256_loadu_ps(row), max);
+            if (fastExp)
+            {
+                e = expFastAvx2(e);
+            }
+            else
+            {
+                _mm256_storeu_ps(row, e);
+                expLanes(row, 8);
+                e = _mm256_loadu_ps(row);
+            }
+            _mm256_storeu_ps(row, e);
+            sum = _mm256_add_ps(sum, e);
+        }
+
+        __m256 division = _mm256_div_ps(_mm256_set1_ps(1), sum);
+        for (int i = 0; i < rows; i++)
+        {
+            float* row = column + i * stride;
+            _mm256_storeu_ps(row, _mm256_mul_ps(_mm256_loadu_ps(row), division));
+        }
+    }
+
+    // the cols that are left, one at a time
+    for (; j < cols; j++)
+    {
+        softmaxColumnScalar(values + j, rows, stride, fastExp);
+    }
+}
+
+// ------------------------------------------- avx-512 kernels ------------------------------------
+
+/**
+ * @brief returns a mask of the first count lanes of a 16-float vector (count < 16)
+ */
+TARGET_AVX512 static inline __mmask16 tailMask(int count)
+{
+    return (__mmask16)((1u << count) - 1);
+}
+
+/**
+ * @brief returns the sum of the 16 lanes of a vector
+ *        (the reduce intrinsics of gcc 12 trip -Wmaybe-uninitialized once inlined, bug 105593)
+ */
+TARGET_AVX512 static inline float horizontalSum512(__m512 v)
+{
+    float lanes[16];
+    _mm512_storeu_ps(lanes, v);
+
+    float sum = 0;
+    for (float lane : lanes)
+    {
+        sum += lane;
+    }
+    return sum;
+}
+
+TARGET_AVX512 static void addAvx512(const float* a, const float* b, float* out, int size)
+{
+    int i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        _mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+    }
+    if (i < size)
+    {
+        __mmask16 mask = tailMask(size - i);
+        __m512 sum = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, a + i),
+                                   _mm512_maskz_loadu_ps(mask, b + i));
+        _mm512_mask_storeu_ps(out + i, mask, sum);
+    }
+}
+
+TARGET_AVX512 static void addInPlaceAvx512(float* a, const float* b, int size)
+{
+    addAvx512(a, b, a, size);
+}
+
+TARGET_AVX512 static void scaleAvx512(const float* a, float scalar, float* out, int size)
+{
+    __m512 s = _mm512_set1_ps(scalar);
+    int i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(a + i), s));
+    }
+    if (i < size)
+    {
+        __mmask16 mask = tailMask(size - i);
+        _mm512_mask_storeu_ps(out + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, a + i), s));
+    }
+}
+
+TARGET_AVX512 static void scaleAddAvx512(const float* a, float scalar, const float* b, float* out,
+                                         int size)
+{
+    __m512 s = _mm512_set1_ps(scalar);
+    int i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m512 scaled = _mm512_mul_ps(_mm512_loadu_ps(a + i), s);
+        _mm512_storeu_ps(out + i, _mm512_add_ps(scaled, _mm512_loadu_ps(b + i)));
+    }
+    if (i < size)
+    {
+        __mmask16 mask = tailMask(size - i);
+        __m512 scaled = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, a + i), s);
+        _mm512_mask_storeu_ps(out + i, mask,
+                              _mm512_add_ps(scaled, _mm512_maskz_loadu_ps(mask, b + i)));
+    }
+}
+
+TARGET_AVX512 static void copyAvx512(const float* src, float* dst, int size)
+{
+    int i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        _mm512_storeu_ps(dst + i, _mm512_loadu_ps(src + i));
+    }
+    if (i < size)
+    {
+        __mmask16 mask = tailMask(size - i);
+        _mm512_mask_storeu_ps(dst + i, mask, _mm512_maskz_loadu_ps(mask, src + i));
+    }
+}
+
+TARGET_AVX512 static void fillAvx512(float* dst, float value, int size)
+{
+    __m512 v = _mm512_set1_ps(value);
+    int i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        _mm512_storeu_ps(dst + i, v);
+    }
+    if (i < size)
+    {
+        _mm512_mask_storeu_ps(dst + i, tailMask(size - i), v);
+    }
+}
+
+TARGET_AVX512 static void gemvAvx512(int m, int k, const float* a, int lda, const float* x,
+                                     const float* bias, bool relu, float* y)
+{
+    int tail = k % 16;
+    __mmask16 mask = tailMask(tail);
+    int i = 0;
+
+    for (; i + GEMV_ROWS <= m; i += GEMV_ROWS)
+    {
+        const float* row0 = a + i * lda;
+        const float* row1 = row0 + lda;
+        const float* row2 = row1 + lda;
+        const float* row3 = row2 + lda;
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        __m512 acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+
+        int kk = 0;
+        for (; kk + 16 <= k; kk += 16)
+        {
+            __m512 xv = _mm512_loadu_ps(x + kk);
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(row0 + kk), xv, acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(row1 + kk), xv, acc1);
+            acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(row2 + kk), xv, acc2);
+            acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(row3 + kk), xv, acc3);
+        }
+        if (tail)
+        {
+            __m512 xv = _mm512_maskz_loadu_ps(mask, x + kk);
+            acc0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, row0 + kk), xv, acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, row1 + kk), xv, acc1);
+            acc2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, row2 + kk), xv, acc2);
+            acc3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, row3 + kk), xv, acc3);
+        }
+        y[i] = epilogue(horizontalSum512(acc0), bias, i, relu);
+        y[i + 1] = epilogue(horizontalSum512(acc1), bias, i + 1, relu);
+        y[i + 2] = epilogue(horizontalSum512(acc2), bias, i + 2, relu);
+        y[i + 3] = epilogue(horizontalSum512(acc3), bias, i + 3, relu);
+    }
+
+    // the rows that are left
+    for (; i < m; i++)
+    {
+        const float* row = a + i * lda;
+        __m512 acc = _mm512_setzero_ps();
+        int kk = 0;
+        for (; kk + 16 <= k; kk += 16)
+        {
+            acc = _mm512_fmadd_ps(_mm512_loadu_ps(row + kk), _mm512_loadu_ps(x + kk), acc);
+        }
+        if (tail)
+        {
+            acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, row + kk),
+                                  _mm512_maskz_loadu_ps(mask, x + kk), acc);
+        }
+        y[i] = epilogue(horizontalSum512(acc), bias, i, relu);
+    }
+}
+
+
+// gcc 12 warns of the undefined source of the unmasked avx-512 intrinsics (the half widening,
+// and the exp next to masked ones) once they are inlined (the same bug 105593 as the reduce
+// intrinsics)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+/**
+ * @brief the steps of a float panel for the avx-512 tile kernel
+ */
+typedef struct FloatStepsAvx512
+{
+    typedef float Element;
+
+    TARGET_AVX512 static inline __m512 load(const float* step)
+    {
+        return _mm512_loadu_ps(step);
+    }
+} FloatStepsAvx512;
+
+/**
+ * @brief the steps of an ieee half panel for the avx-512 tile kernel
+ */
+typedef struct HalfStepsAvx512
+{
+    typedef uint16_t Element;
+
+    TARGET_AVX512 static inline __m512 load(const uint16_t* step)
+    {
+        return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)step));
+    }
+} HalfStepsAvx512;
+
+/**
+ * @brief the steps of a bfloat16 panel for the avx-512 tile kernel, widened by a shift
+ */
+typedef struct Bfloat16StepsAvx512
+{
+    typedef uint16_t Element;
+
+    TARGET_AVX512 static inline __m512 load(const uint16_t* step)
+    {
+        __m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)step));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16));
+    }
+} Bfloat16StepsAvx512;
+
+/**
+ * @brief computes COLS cols of a panel tile (see simdPanelTile), the panel is 1 vector a step,
+ *        loaded by Steps. few cols sum the steps in 2 or 4 sets apart, so at least 4 sums are
+ *        in flight
+ */
+template <typename Steps, int COLS>
+TARGET_AVX512 static void panelTileColsAvx512(int k, const typename Steps::Element* panel,
+                                              const float* b, int ldb, float* tile)
+{
+    constexpr int SETS = (COLS == 1) ? 4 : ((COLS == 2) ? 2 : 1);
+    // the bias is floats in every format
+    constexpr int BIAS = PANEL_ROWS * (int)(sizeof(float) / sizeof(typename Steps::Element));
+    __m512 acc[SETS][COLS];
+    for (int s = 0; s < SETS; s++)
+    {
+        for (int j = 0; j < COLS; j++)
+        {
+            acc[s][j] = (s == 0) ? _mm512_loadu_ps((const float*)panel) : _mm512_setzero_ps();
+        }
+    }
+
+    const typename Steps::Element* weights = panel + BIAS;
+    int kk = 0;
+    for (; kk + SETS <= k; kk += SETS)
+    {
+        for (int s = 0; s < SETS; s++)
+        {
+            __m512 w = Steps::load(weights + (kk + s) * PANEL_ROWS);
+            const float* bRow = b + (long)(kk + s) * ldb;
+            for (int j = 0; j < COLS; j++)
+            {
+                acc[s][j] = _mm512_fmadd_ps(w, _mm512_set1_ps(bRow[j]), acc[s][j]);
+            }
+        }
+    }
+    for (; kk < k; kk++)
+    {
+        __m512 w = Steps::load(weights + kk * PANEL_ROWS);
+        const float* bRow = b + (long)kk * ldb;
+        for (int j = 0; j < COLS; j++)
+        {
+            acc[0][j] = _mm512_fmadd_ps(w, _mm512_set1_ps(bRow[j]), acc[0][j]);
+        }
+    }
+
+    for (int j = 0; j < COLS; j++)
+    {
+        for (int s = 1; s < SETS; s++)
+        {
+            acc[0][j] = _mm512_add_ps(acc[0][j], acc[s][j]);
+        }
+        _mm512_storeu_ps(tile + j * PANEL_ROWS, acc[0][j]);
+    }
+}
+
+/**
+ * @brief computes a panel tile (see simdPanelTile) of a panel whose steps are loaded by Steps
+ */
+template <typename Steps>
+TARGET_AVX512 static void panelTileStepsAvx512(int k, const typename Steps::Element* panel,
+                                               const float* b, int ldb, int cols, float* tile)
+{
+    // up to 6 cols at a time: a step is 1 load and 6 broadcasts of b for 6 multiply-adds
+    for (int j = 0; j < cols; j += 6)
+    {
+        const float* bCols = b + j;
+        float* out = tile + j * PANEL_ROWS;
+        switch (std::min(cols - j, 6))
+        {
+            case 1:
+                panelTileColsAvx512<Steps, 1>(k, panel, bCols, ldb, out);
+                break;
+            case 2:
+                panelTileColsAvx512<Steps, 2>(k, panel, bCols, ldb, out);
+                break;
+            case 3:
+                panelTileColsAvx512<Steps, 3>(k, panel, bCols, ldb, out);
+                break;
+            case 4:
+                panelTileColsAvx512<Steps, 4>(k, panel, bCols, ldb, out);
+                break;
+            case 5:
+                panelTileColsAvx512<Steps, 5>(k, panel, bCols, ldb, out);
+                break;
+            default:
+                panelTileColsAvx512<Steps, 6>(k, panel, bCols, ldb, out);
+                break;
+        }
+    }
+}
+
+TARGET_AVX512 static void panelTileAvx512(int k, const float* panel, const float* b, int ldb,
+                                          int cols, float* tile)
+{
+    panelTileStepsAvx512<FloatStepsAvx512>(k, panel, b, ldb, cols, tile);
+}
+
+TARGET_AVX512 static void panelTileHalfAvx512(int k, const uint16_t* panel, HalfFormat format,
+                                              const float* b, int ldb, int cols, float* tile)
+{
+    if (format == HalfIeee)
+    {
+        panelTileStepsAvx512<HalfStepsAvx512>(k, panel, b, ldb, cols, tile);
+        return;
+    }
+    panelTileStepsAvx512<Bfloat16StepsAvx512>(k, panel, b, ldb, cols, tile);
+}
+
+/**
+ * @brief converts floats to bfloat16 with the avx-512 bf16 instruction, rounded to the nearest
+ *        even and with denormals flushed to zero like floatToBfloat16
+ */
+TARGET_BF16 static void floatToBfloat16Bf16(const float* src, uint16_t* dst, int size)
+{
+    int i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m256bh half = _mm512_cvtneps_pbh(_mm512_loadu_ps(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), (__m256i)half);
+    }
+    floatToHalfScalar(src + i, dst + i, size - i, HalfBfloat16);
+}
+
+TARGET_AVX512 static void gemmTileAvx512(int k, const float* a, const float* b, float* c,
+                                         int ldc, int rows, int cols, bool accumulate,
+                                         const float* bias, bool relu)
+{
+    // a row of the tile is one vector, a step is 1 load of b and 4 broadcasts of a
+    __m512 acc[GEMM_TILE_ROWS];
+    for (int r = 0; r < GEMM_TILE_ROWS; r++)
+    {
+        acc[r] = _mm512_setzero_ps();
+    }
+    for (int kk = 0; kk < k; kk++)
+    {
+        __m512 bStep = _mm512_loadu_ps(b);
+        for (int r = 0; r < GEMM_TILE_ROWS; r++)
+        {
+            acc[r] = _mm512_fmadd_ps(_mm512_set1_ps(a[r]), bStep, acc[r]);
+        }
+        a += GEMM_TILE_ROWS;
+        b += GEMM_TILE_COLS;
+    }
+
+    // Goes over the rows to store, the cols of a partial tile are masked
+    __mmask16 mask = tailMask(cols);
+    for (int r = 0; r < rows; r++)
+    {
+        __m512 value = _mm512_add_ps(acc[r], _mm512_set1_ps((bias == nullptr) ? 0 : bias[r]));
+        float* out = c + r * ldc;
+        if (accumulate)
+        {
+            value = _mm512_add_ps(value, _mm512_maskz_loadu_ps(mask, out));
+        }
+        if (relu)
+        {
+            value = _mm512_max_ps(value, _mm512_setzero_ps());
+        }
+        _mm512_mask_storeu_ps(out, mask, value);
+    }
+}
+
+TARGET_AVX512 static void minMaxAvx512(const float* values, int size, float* min, float* max)
+{
+    // the masked lanes of the tail keep the values they had
+    __m512 low = _mm512_set1_ps(values[0]);
+    __m512 high = low;
+    int i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m512 v = _mm512_loadu_ps(values + i);
+        low = _mm512_min_ps(v, low);
+        high = _mm512_max_ps(v, high);
+    }
+    if (i < size)
+    {
+        __mmask16 mask = tailMask(size - i);
+        __m512 v = _mm512_maskz_loadu_ps(mask, values + i);
+        low = _mm512_mask_min_ps(low, mask, v, low);
+        high = _mm512_mask_max_ps(high, mask, v, high);
+    }
+
+    // the lanes are stored and reduced like horizontalSum512, the extracts trip the same bug
+    float lows[16];
+    float highs[16];
+    _mm512_storeu_ps(lows, low);
+    _mm512_storeu_ps(highs, high);
+    float unused;
+    minMaxScalar(lows, 16, min, &unused);
+    minMaxScalar(highs, 16, &unused, max);
+}
+
+TARGET_AVX512 static void quantizeBytesAvx512(const float* values, int size, float inverseScale,
+                                              int zeroPoint, uint8_t* out)
+{
+    __m512 scale = _mm512_set1_ps(inverseScale);
+    __m512i zero = _mm512_set1_epi32(zeroPoint);
+
+    // Goes over 16 floats at a time, the negative lanes are clamped to 0 and the conversion to
+    // bytes saturates the rest at 255. the tail is a masked load and store
+    for (int i = 0; i < size; i += 16)
+    {
+        __mmask16 mask = tailMask(std::min(size - i, 16));
+        __m512 v = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, values + i), scale);
+        __m512i lanes = _mm512_add_epi32(_mm512_cvtps_epi32(v), zero);
+        lanes = _mm512_max_epi32(lanes, _mm512_setzero_si512());
+        _mm512_mask_cvtusepi32_storeu_epi8(out + i, mask, lanes);
+    }
+}
+
+TARGET_AVX512 static void floatToHalfAvx512(const float* src, uint16_t* dst, int size,
+                                            HalfFormat format)
+{
+    if (format == HalfBfloat16)
+    {
+        static const bool bf16 = hasBfloat16();
+        if (bf16)
+        {
+            floatToBfloat16Bf16(src, dst, size);
+        }
+        else
+        {
+            floatToHalfScalar(src, dst, size, format);
+        }
+        return;
+    }
+    int i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m256i half = _mm512_cvtps_ph(_mm512_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm256_storeu_si256((__m256i*)(dst + i), half);
+    }
+    floatToHalfScalar(src + i, dst + i, size - i, format);
+}
+
+/**
+ * @brief the fast exp of 16 floats, see simdExpFast
+ */
+TARGET_AVX512 static inline __m512 expFastAvx512(__m512 x)
+{
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(EXP_MIN)), _mm512_set1_ps(EXP_MAX));
+    __m512 n = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(EXP_LOG2E)),
+                                    _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(EXP_LN2_HI), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(EXP_LN2_LO), r);
+
+    __m512 p = _mm512_set1_ps(EXP_P0);
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P1));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P2));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P3));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P4));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(EXP_P5));
+    p = _mm512_add_ps(_mm512_fmadd_ps(p, _mm512_mul_ps(r, r), r), _mm512_set1_ps(1));
+
+    __m512i bits = _mm512_add_epi32(_mm512_cvtps_epi32(n),
+                                    _mm512_set1_epi32(FLOAT_EXPONENT_BIAS));
+    return _mm512_mul_ps(p, _mm512_castsi512_ps(_mm512_slli_epi32(bits, FLOAT_MANTISSA_BITS)));
+}
+
+/**
+ * @brief performs exp on the lanes of a mask of a vector, through a row of the array
+ * @param e - the vector
+ * @param row - the floats of the lanes, they are overwritten
+ * @param mask - the lanes
+ * @param count - the number of lanes in the mask
+ * @param fastExp - true for the fast exp, false for std::exp
+ * @return e^e
+ */
+TARGET_AVX512 static inline __m512 expAvx512(__m512 e, float* row, __mmask16 mask, int count,
+                                             bool fastExp)
+{
+    if (fastExp)
+    {
+        return expFastAvx512(e);
+    }
+    _mm512_mask_storeu_ps(row, mask, e);
+    expLanes(row, count);
+    return _mm512_maskz_loadu_ps(mask, row);
+}
+
+/**
+ * @brief performs softmax on up to 16 columns of a row-major array at once, one per lane
+ * @param column - the first float of the first column
+ * @param rows - the number of rows
+ * @param stride - the distance between two rows
+ * @param count - the number of columns, 16 or less
+ * @param fastExp - true for the fast exp, false for std::exp
+ */
+TARGET_AVX512 static void softmaxColumnsAvx512(float* column, int rows, int stride, int count,
+                                               bool fastExp)
+{
+    // the lanes out of the mask load zeros, so their sum is never zero
+    __mmask16 mask = (count == 16) ? (__mmask16)0xFFFF : tailMask(count);
+    __m512 max = _mm512_maskz_loadu_ps(mask, column);
+    for (int i = 1; i < rows; i++)
+    {
+        max = _mm512_max_ps(max, _mm512_maskz_loadu_ps(mask, column + i * stride));
+    }
+
+    __m512 sum = _mm512_setzero_ps();
+    for (int i = 0; i < rows; i++)
+    {
+        float* row = column + i * stride;
+        __m512 e = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, row), max);
+        e = expAvx512(e, row, mask, count, fastExp);
+        _mm512_mask_storeu_ps(row, mask, e);
+        sum = _mm512_add_ps(sum, e);
+    }
+
+    __m512 division = _mm512_div_ps(_mm512_set1_ps(1), sum);
+    for (int i = 0; i < rows; i++)
+    {
+        float* row = column + i * stride;
+        _mm512_mask_storeu_ps(row, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, row), division));
+    }
+}
+
+/**
+ * @brief performs softmax on a contiguous array (one column), 16 rows at a time
+ * @param values - the array
+ * @param size - the number of floats
+ * @param fastExp - true for the fast exp, false for std::exp
+ */
+TARGET_AVX512 static void softmaxVectorAvx512(float* values, int size, bool fastExp)
+{
+    __m512 maxLanes = _mm512_set1_ps(-INFINITY);
+    for (int i = 0; i < size; i += 16)
+    {
+        __mmask16 mask = (size - i >= 16) ? (__mmask16)0xFFFF : tailMask(size - i);
+        maxLanes = _mm512_mask_max_ps(maxLanes, mask, maxLanes,
+                                       _mm512_maskz_loadu_ps(mask, values + i));
+    }
+    float lanes[16];
+    _mm512_storeu_ps(lanes, maxLanes);
+    __m512 max = _mm512_set1_ps(*std::max_element(lanes, lanes + 16));
+
+    __m512 sum = _mm512_setzero_ps();
+    for (int i = 0; i < size; i += 16)
+    {
+        int count = std::min(size - i, 16);
+        __mmask16 mask = (count == 16) ? (__mmask16)0xFFFF : tailMask(count);
+        __m512 e = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, values + i), max);
+        e = expAvx512(e, values + i, mask, count, fastExp);
+        _mm512_mask_storeu_ps(values + i, mask, e);
+        sum = _mm512_mask_add_ps(sum, mask, sum, e);
+    }
+    scaleAvx512(values, 1 / horizontalSum512(sum), values, size);
+}
+
+TARGET_AVX512 static void softmaxAvx512(float* values, int rows, int cols, int stride,
+                                        bool fastExp)
+{
+    if ((cols == 1) && ((stride == 1) || (rows == 1)))
+    {
+        softmaxVectorAvx512(values, rows, fastExp);
+        return;
+    }
+
+    // Goes over the columns 16 at a time, every lane normalizes a column of its own
+    for (int j = 0; j < cols; j += 16)
+    {
+        softmaxColumnsAvx512(values + j, rows, stride, std::min(cols - j, 16), fastExp);
+    }
+}
+
+#pragma GCC diagnostic pop
+
+/**
+ * @brief returns the sum of the 16 lanes of an integer vector (see horizontalSum512)
+ */
+TARGET_AVX512 static inline int32_t horizontalSumInt512(__m512i v)
+{
+    int32_t lanes[16];
+    _mm512_storeu_si512(lanes, v);
+
+    int32_t sum = 0;
+    for (int32_t lane : lanes)
+    {
+        sum += lane;
+    }
+    return sum;
+}
+
+/**
+ * @brief like gemvInt8Avx2, with the vnni instruction that multiplies 64 unsigned bytes of x by
+ *        64 signed bytes of the row and adds every 4 products into 16 sums of 32 bits.
+ *        4 rows at a time so every load of x is used 4 times
+ */
+TARGET_VNNI static void gemvInt8Vnni(int m, int k, const int8_t* a, int lda, const uint8_t* x,
+                                     int32_t* y)
+{
+    int tail = k % 64;
+    __mmask64 mask = (tail == 0) ? 0 : (((__mmask64)1 << tail) - 1);
+    int i = 0;
+
+    for (; i + GEMV_ROWS <= m; i += GEMV_ROWS)
+    {
+        const int8_t* row0 = a + i * lda;
+        const int8_t* row1 = row0 + lda;
+        const int8_t* row2 = row1 + lda;
+        const int8_t* row3 = row2 + lda;
+        __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+        __m512i acc2 = _mm512_setzero_si512(), acc3 = _mm512_setzero_si512();
+
+        int kk = 0;
+        for (; kk + 64 <= k; kk += 64)
+        {
+            __m512i xv = _mm512_loadu_si512(x + kk);
+            acc0 = _mm512_dpbusd_epi32(acc0, xv, _mm512_loadu_si512(row0 + kk));
+            acc1 = _mm512_dpbusd_epi32(acc1, xv, _mm512_loadu_si512(row1 + kk));
+            acc2 = _mm512_dpbusd_epi32(acc2, xv, _mm512_loadu_si512(row2 + kk));
+            acc3 = _mm512_dpbusd_epi32(acc3, xv, _mm512_loadu_si512(row3 + kk));
+        }
+        if (tail)
+        {
+            __m512i xv = _mm512_maskz_loadu_epi8(mask, x + kk);
+            acc0 = _mm512_dpbusd_epi32(acc0, xv, _mm512_maskz_loadu_epi8(mask, row0 + kk));
+            acc1 = _mm512_dpbusd_epi32(acc1, xv, _mm512_maskz_loadu_epi8(mask, row1 + kk));
+            acc2 = _mm512_dpbusd_epi32(acc2, xv, _mm512_maskz_loadu_epi8(mask, row2 + kk));
+            acc3 = _mm512_dpbusd_epi32(acc3, xv, _mm512_maskz_loadu_epi8(mask, row3 + kk));
+        }
+        y[i] = horizontalSumInt512(acc0);
+        y[i + 1] = horizontalSumInt512(acc1);
+        y[i + 2] = horizontalSumInt512(acc2);
+        y[i + 3] = horizontalSumInt512(acc3);
+    }
+
+    // the rows that are left
+    for (; i < m; i++)
+    {
+        const int8_t* row = a + i * lda;
+        __m512i acc = _mm512_setzero_si512();
+        int kk = 0;
+        for (; kk + 64 <= k; kk += 64)
+        {
+            acc = _mm512_dpbusd_epi32(acc, _mm512_loadu_si512(x + kk),
+                                      _mm512_loadu_si512(row + kk));
+        }
+        if (tail)
+        {
+            acc = _mm512_dpbusd_epi32(acc, _mm512_maskz_loadu_epi8(mask, x + kk),
+                                      _mm512_maskz_loadu_epi8(mask, row + kk));
+        }
+        y[i] = horizontalSumInt512(acc);
+    }
+}
+
+
+#endif // MLP_X86
+
+// ------------------------------------------- dispatch -------------------------------------------
+
+static const KernelTable kernelTables[ISA_LEVELS] =
+{
+    {addScalar, addInPlaceScalar, scaleScalar, scaleAddScalar, copyScalar, fillScalar,
+     gemvScalar, gemvInt8Scalar, minMaxScalar, quantizeBytesScalar, panelTileScalar,
+     gemmTileScalar, panelTileHalfScalar, floatToHalfScalar, softmaxScalar},
+#ifdef MLP_X86
+    // sse4.2 has no half conversion, its 16 bit panels run on the scalar kernels. its 16
+    // registers do not hold a 4x16 tile with the loads of a step, so the tile runs on the
+    // scalar kernel too
+    {addSse42, addInPlaceSse42, scaleSse42, scaleAddSse42, copySse42, fillSse42, gemvSse42,
+     gemvInt8Sse42, minMaxSse42, quantizeBytesSse42, panelTileSse42, gemmTileScalar,
+     panelTileHalfScalar, floatToHalfScalar, softmaxSse42},
+    {addAvx2, addInPlaceAvx2, scaleAvx2, scaleAddAvx2, copyAvx2, fillAvx2, gemvAvx2, gemvInt8Avx2,
+     minMaxAvx2, quantizeBytesAvx2, panelTileAvx2, gemmTileAvx2, panelTileHalfAvx2,
+     floatToHalfAvx2, softmaxAvx2},
+    // avx512f alone has no byte or word instructions, vnni is checked on its own
+    {addAvx512, addInPlaceAvx512, scaleAvx512, scaleAddAvx512, copyAvx512, fillAvx512, gemvAvx512,
+     gemvInt8Avx2, minMaxAvx512, quantizeBytesAvx512, panelTileAvx512, gemmTileAvx512,
+     panelTileHalfAvx512, floatToHalfAvx512, softmaxAvx512}
+#else
+    {addScalar, addInPlaceScalar, scaleScalar, scaleAddScalar, copyScalar, fillScalar,
+     gemvScalar, gemvInt8Scalar, minMaxScalar, quantizeBytesScalar, panelTileScalar,
+     gemmTileScalar, panelTileHalfScalar, floatToHalfScalar, softmaxScalar},
+    {addScalar, addInPlaceScalar, scaleScalar, scaleAddScalar, copyScalar, fillScalar,
+     gemvScalar, gemvInt8Scalar, minMaxScalar, quantizeBytesScalar, panelTileScalar,
+     gemmTileScalar, panelTileHalfScalar, floatToHalfScalar, softmaxScalar},
+    {addScalar, addInPlaceScalar, scaleScalar, scaleAddScalar, copyScalar, fillScalar,
+     gemvScalar, gemvInt8Scalar, minMaxScalar, quantizeBytesScalar, panelTileScalar,
+     gemmTileScalar, panelTileHalfScalar, floatToHalfScalar, softmaxScalar}
+#endif
+};
+
+static const char* const isaNames[ISA_LEVELS] = {"scalar", "sse4.2", "avx2", "avx512"};
+
+static std::atomic<int> forcedLevel(-1); // the level set by setIsaLevel, -1 if none
+
+/**
+ * @brief returns the best instruction set supported by the cpu (checked with cpuid)
+ * @return the instruction set level
+ */
+IsaLevel detectIsaLevel()
+{
+#ifdef MLP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return IsaAvx512;
+    }
+    // the avx2 kernels also widen halves with f16c, which every avx2 cpu has
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+        __builtin_cpu_supports("f16c"))
+    {
+        return IsaAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return IsaSse42;
+    }
+#endif
+    return IsaScalar;
+}
+
+/**
+ * @brief returns the level to start with: the detected one, or the one in MLP_ISA
+ * @return the instruction set level
+ */
+static IsaLevel initialIsaLevel()
+{
+    IsaLevel detected = detectIsaLevel();
+    const char* requested = std::getenv(ISA_ENV_VAR);
+
+    if (requested == nullptr)
+    {
+        return detected;
+    }
+
+    for (int level = 0; level < ISA_LEVELS; level++)
+    {
+        if (std::strcmp(requested, isaNames[level]) == 0)
+        {
+            if (level > detected)
+            {
+                std::cerr << STR_UNSUPPORTED_ISA_ERR << requested << std::endl;
+                return detected;
+            }
+            return (IsaLevel)level;
+        }
+    }
+    std::cerr << STR_UNKNOWN_ISA_ERR << requested << std::endl;
+    return detected;
+}
+
+/**
+ * @brief returns the instruction set the kernels currently run with. on the first call it is
+ *        the detected level, unless the MLP_ISA environment variable
+ *        (scalar, sse4.2, avx2 or avx512) forces a lower one
+ * @return the instruction set level
+ */
+IsaLevel getIsaLevel()
+{
+    static const IsaLevel initialLevel = initialIsaLevel();
+    int level = forcedLevel.load(std::memory_order_relaxed);
+
+    return (level < 0) ? initialLevel : (IsaLevel)level;
+}
+
+/**
+ * @brief forces the kernels to run with the given instruction set (for benchmarking)
+ * @param level - the instruction set level
+ * @return true if the cpu supports the level and it was set, false otherwise
+ */
+bool setIsaLevel(IsaLevel level)
+{
+    if ((level < IsaScalar) || (level > detectIsaLevel()))
+    {
+        std::cerr << STR_UNSUPPORTED_ISA_ERR << isaLevelName(level) << std::endl;
+        return false;
+    }
+    forcedLevel.store(level, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief returns the name of an instruction set level
+ * @param level - the instruction set level
+ * @return the name of the level
+ */
+const char* isaLevelName(IsaLevel level)
+{
+    if ((level < IsaScalar) || (level >= ISA_LEVELS))
+    {
+        return "unknown";
+    }
+    return isaNames[level];
+}
+
+/**
+ * @brief returns the kernels of the current instruction set level
+ */
+static inline const KernelTable& kernels()
+{
+    return kernelTables[getIsaLevel()];
+}
+
+void simdAdd(const float* a, const float* b, float* out, int size)
+{
+    kernels().add(a, b, out, size);
+}
+
+void simdAddInPlace(float* a, const float* b, int size)
+{
+    kernels().addInPlace(a, b, size);
+}
+
+void simdAddColumnVector(float* a, const float* vec, int rows, int cols)
+{
+    if (cols == 1)
+    {
+        kernels().addInPlace(a, vec, rows);
+        return;
+    }
+
+    // Goes over the rows, each row gets the same value of vec in all of its cols
+    for (int i = 0; i < rows; i++)
+    {
+        float value = vec[i];
+        float* row = a + i * cols;
+        for (int j = 0; j < cols; j++)
+        {
+            row[j] += value;
+        }
+    }
+}
+
+void simdScale(const float* a, float scalar, float* out, int size)
+{
+    kernels().scale(a, scalar, out, size);
+}
+
+void simdScaleAdd(const float* a, float scalar, const float* b, float* out, int size)
+{
+    kernels().scaleAdd(a, scalar, b, out, size);
+}
+
+void simdCopy(const float* src, float* dst, int size)
+{
+    kernels().copy(src, dst, size);
+}
+
+void simdFill(float* dst, float value, int size)
+{
+    kernels().fill(dst, value, size);
+}
+
+void simdGemv(int m, int k, const float* a, int lda, const float* x, float* y)
+{
+    kernels().gemv(m, k, a, lda, x, nullptr, false, y);
+}
+
+void simdGemvBiasAct(int m, int k, const float* a, int lda, const float* x, const float* bias,
+                     bool relu, float* y)
+{
+    kernels().gemv(m, k, a, lda, x, bias, relu, y);
+}
+
+void simdPanelTile(int k, const float* panel, const float* b, int ldb, int cols, float* tile)
+{
+    kernels().panelTile(k, panel, b, ldb, cols, tile);
+}
+
+void simdGemmTile(int k, const float* a, const float* b, float* c, int ldc, int rows, int cols,
+                  bool accumulate, const float* bias, bool relu)
+{
+    kernels().gemmTile(k, a, b, c, ldc, rows, cols, accumulate, bias, relu);
+}
+
+void simdPanelTileHalf(int k, const uint16_t* panel, HalfFormat format, const float* b, int ldb,
+                       int cols, float* tile)
+{
+    kernels().panelTileHalf(k, panel, format, b, ldb, cols, tile);
+}
+
+void simdFloatToHalf(const float* src, uint16_t* dst, int size, HalfFormat format)
+{
+    kernels().floatToHalf(src, dst, size, format);
+}
+
+void simdSoftmax(float* values, int rows, int cols, bool fastExp)
+{
+    kernels().softmax(values, rows, cols, cols, fastExp);
+}
+
+void simdSoftmax(float* values, int rows, int cols, int stride, bool fastExp)
+{
+    kernels().softmax(values, rows, cols, stride, fastExp);
+}
+
+float simdExpFast(float x)
+{
+    return expFastScalar(x);
+}
+
+/**
+ * @brief returns true if the cpu has the avx-512 vnni byte dot product instruction
+ * @return true if vnni is supported
+ */
+bool hasVnni()
+{
+#ifdef MLP_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vnni");
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief returns true if the cpu has the avx-512 bf16 instructions
+ * @return true if avx-512 bf16 is supported
+ */
+bool hasBfloat16()
+{
+#ifdef MLP_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512bf16");
+#else
+    return false;
+#endif
+}
+
+void simdGemvInt8(int m, int k, const int8_t* a, int lda, const uint8_t* x, int32_t* y)
+{
+#ifdef MLP_X86
+    static const bool vnni = hasVnni();
+    if (vnni && (getIsaLevel() == IsaAvx512))
+    {
+        gemvInt8Vnni(m, k, a, lda, x, y);
+        return;
+    }
+#endif
+    kernels().gemvInt8(m, k, a, lda, x, y);
+}
+
+void simdMinMax(const float* values, int size, float* min, float* max)
+{
+    kernels().minMax(values, size, min, max);
+}
+
+void simdQuantizeBytes(const float* values, int size, float inverseScale, int zeroPoint,
+                       uint8_t* out)
+{
+    kernels().quantizeBytes(values, size, inverseScale, zeroPoint, out);
+}
@@ -0,0 +1,293 @@
+
+//SimdKernels.h
+
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include <cstdint>
+
+#define FAST_EXP_MAX_ERROR 2e-7f // the largest relative error of simdExpFast, on [-87, 88]
+#define PANEL_ROWS 16            // the rows of a packed panel of weights, one avx-512 vector
+#define PANEL_TILE_COLS 12       // the most cols of b one simdPanelTile computes
+#define PANEL_HALF_BIAS (2 * PANEL_ROWS) // the 16 bit slots of a 16 bit panel its float bias takes
+#define GEMM_TILE_ROWS 4         // the rows of a register tile of simdGemmTile
+#define GEMM_TILE_COLS 16        // the cols of a register tile of simdGemmTile
+
+/**
+ * @enum IsaLevel
+ * @brief Indicator of the instruction set the kernels run with, ordered from the weakest.
+ */
+enum IsaLevel
+{
+    IsaScalar,
+    IsaSse42,
+    IsaAvx2,
+    IsaAvx512
+};
+
+/**
+ * @enum HalfFormat
+ * @brief Indicator of a 16 bit float format: the ieee half (fp16) or bfloat16 (the top half of a
+ *        float, the range of a float with 8 bits of mantissa).
+ */
+enum HalfFormat
+{
+    HalfIeee,
+    HalfBfloat16
+};
+
+/**
+ * @brief returns the best instruction set supported by the cpu (checked with cpuid)
+ * @return the instruction set level
+ */
+IsaLevel detectIsaLevel();
+
+/**
+ * @brief returns the instruction set the kernels currently run with. on the first call it is
+ *        the detected level, unless the MLP_ISA environment variable
+ *        (scalar, sse4.2, avx2 or avx512) forces a lower one
+ * @return the instruction set level
+ */
+IsaLevel getIsaLevel();
+
+/**
+ * @brief forces the kernels to run with the given instruction set (for benchmarking)
+ * @param level - the instruction set level
+ * @return true if the cpu supports the level and it was set, false otherwise
+ */
+bool setIsaLevel(IsaLevel level);
+
+/**
+ * @brief returns the name of an instruction set level
+ * @param level - the instruction set level
+ * @return the name of the level
+ */
+const char* isaLevelName(IsaLevel level);
+
+/**
+ * @brief out[i] = a[i] + b[i]
+ * @param a - the first array
+ * @param b - the second array
+ * @param out - the result array (may be a or b)
+ * @param size - the number of elements
+ */
+void simdAdd(const float* a, const float* b, float* out, int size);
+
+/**
+ * @brief adds vec[i] to every element of row i of a row-major matrix (bias broadcast)
+ * @param a - the matrix
+ * @param vec - the vector, one element per row
+ * @param rows - the number of rows of a
+ * @param cols - the number of cols of a
+ */
+void simdAddColumnVector(float* a, const float* vec, int rows, int cols);
+
+/**
+ * @brief a[i] += b[i]
+ * @param a - the array to add into
+ * @param b - the array to add
+ * @param size - the number of elements
+ */
+void simdAddInPlace(float* a, const float* b, int size);
+
+/**
+ * @brief out[i] = a[i] * scalar
+ * @param a - the array
+ * @param scalar - the scalar
+ * @param out - the result array (may be a)
+ * @param size - the number of elements
+ */
+void simdScale(const float* a, float scalar, float* out, int size);
+
+/**
+ * @brief out[i] = a[i] * scalar + b[i], the scaled add of the matrix expressions in one pass
+ * @param a - the array to scale
+ * @param scalar - the scalar
+ * @param b - the array to add
+ * @param out - the result array (may be a or b)
+ * @param size - the number of elements
+ */
+void simdScaleAdd(const float* a, float scalar, const float* b, float* out, int size);
+
+/**
+ * @brief dst[i] = src[i]
+ * @param src - the source array
+ * @param dst - the destination array, must not overlap src
+ * @param size - the number of elements
+ */
+void simdCopy(const float* src, float* dst, int size);
+
+/**
+ * @brief dst[i] = value
+ * @param dst - the destination array
+ * @param value - the value to fill with
+ * @param size - the number of elements
+ */
+void simdFill(float* dst, float value, int size);
+
+/**
+ * @brief computes y = a * x for a row-major float matrix and a contiguous vector
+ * @param m - the number of rows of a and the size of y
+ * @param k - the number of cols of a and the size of x
+ * @param a - the matrix
+ * @param lda - the distance between two rows of a
+ * @param x - the input vector
+ * @param y - the result vector, overwritten
+ */
+void simdGemv(int m, int k, const float* a, int lda, const float* x, float* y);
+
+/**
+ * @brief computes y = act(a * x + bias) in one pass, the bias and relu are applied to every
+ *        output as soon as its dot product is done
+ * @param m - the number of rows of a and the size of y
+ * @param k - the number of cols of a and the size of x
+ * @param a - the matrix
+ * @param lda - the distance between two rows of a
+ * @param x - the input vector
+ * @param bias - the bias vector (m floats), or nullptr for none
+ * @param relu - true to perform relu on the outputs
+ * @param y - the result vector, overwritten
+ */
+void simdGemvBiasAct(int m, int k, const float* a, int lda, const float* x, const float* bias,
+                     bool relu, float* y);
+
+/**
+ * @brief computes a tile of a product from a packed panel of weights: the PANEL_ROWS rows of
+ *        the panel times the first cols cols of b, plus the bias of the rows. the panel holds
+ *        the bias and then the rows column by column, PANEL_ROWS floats a step (see packPanels
+ *        in Gemm.h), so it is read from start to end, one vector a step
+ * @param k - the number of cols of the panel and rows of b
+ * @param panel - the packed panel
+ * @param b - the right matrix
+ * @param ldb - the distance between two rows of b
+ * @param cols - the number of cols of b, at most PANEL_TILE_COLS
+ * @param tile - the result, PANEL_ROWS floats for every col of b, col after col, overwritten
+ */
+void simdPanelTile(int k, const float* panel, const float* b, int ldb, int cols, float* tile);
+
+/**
+ * @brief computes a GEMM_TILE_ROWS*GEMM_TILE_COLS register tile of a product of packed blocks
+ *        (see gemm in Gemm.h) and writes or adds it to c. the bias and relu, when given, are
+ *        applied before the tile is stored, so the result is written once
+ * @param k - the depth of the packed blocks
+ * @param a - a packed block of a, GEMM_TILE_ROWS floats a step
+ * @param b - a packed block of b, GEMM_TILE_COLS floats a step
+ * @param c - the first element of the tile in the result
+ * @param ldc - the distance between two rows of c
+ * @param rows - the number of rows of the tile to store, at most GEMM_TILE_ROWS
+ * @param cols - the number of cols of the tile to store, at most GEMM_TILE_COLS
+ * @param accumulate - true to add the tile to c, false to overwrite c
+ * @param bias - the bias of the rows of the tile, or nullptr for none
+ * @param relu - true to perform relu on the tile
+ */
+void simdGemmTile(int k, const float* a, const float* b, float* c, int ldc, int rows, int cols,
+                  bool accumulate, const float* bias, bool relu);
+
+/**
+ * @brief like simdPanelTile on a panel of 16 bit weights (see packHalfPanels in Gemm.h): every
+ *        step is widened to floats in the registers (f16c or avx-512 for the ieee half, a shift
+ *        for bfloat16) and the sums are floats. the bias is floats, in the first PANEL_HALF_BIAS
+ *        slots of the panel
+ * @param k - the number of cols of the panel and rows of b
+ * @param panel - the packed panel
+ * @param format - the format of the weights
+ * @param b - the right matrix
+ * @param ldb - the distance between two rows of b
+ * @param cols - the number of cols of b, at most PANEL_TILE_COLS
+ * @param tile - the result, PANEL_ROWS floats for every col of b, col after col, overwritten
+ */
+void simdPanelTileHalf(int k, const uint16_t* panel, HalfFormat format, const float* b, int ldb,
+                       int cols, float* tile);
+
+/**
+ * @brief converts floats to 16 bit floats, rounded to the nearest even: with f16c or avx-512 for
+ *        the ieee half and avx-512 bf16 for bfloat16 when the cpu has them, in software otherwise
+ * @param src - the floats
+ * @param dst - the 16 bit floats
+ * @param size - the number of elements
+ * @param format - the format to convert to
+ */
+void simdFloatToHalf(const float* src, uint16_t* dst, int size, HalfFormat format);
+
+/**
+ * @brief performs softmax on every column of a row-major array, in place. the max of every
+ *        column is subtracted before exp, so large values do not overflow. the columns are
+ *        normalized 4, 8 or 16 at a time (one per lane), so a batch of images is one pass over
+ *        the rows; a single column is normalized along its rows
+ * @param values - the array
+ * @param rows - the number of rows
+ * @param cols - the number of cols, one per image
+ * @param fastExp - true to use the polynomial of simdExpFast in the vector registers,
+ *                  false to use std::exp
+ */
+void simdSoftmax(float* values, int rows, int cols, bool fastExp);
+
+/**
+ * @brief performs softmax on every column of a row-major array whose rows are stride floats
+ *        apart (a view of some of the cols of a batch), in place, like simdSoftmax
+ * @param values - the first float of the first column
+ * @param rows - the number of rows
+ * @param cols - the number of cols, one per image
+ * @param stride - the distance between two rows, at least cols
+ * @param fastExp - true to use the polynomial of simdExpFast, false to use std::exp
+ */
+void simdSoftmax(float* values, int rows, int cols, int stride, bool fastExp);
+
+/**
+ * @brief a fast exp: e^x = 2^n * e^r with n = round(x / ln2) and |r| <= ln2 / 2, where e^r is
+ *        a polynomial of degree 5. its relative error is below FAST_EXP_MAX_ERROR, an input
+ *        out of [-87, 88] is clamped into it (the result never overflows or is a denormal)
+ * @param x - the exponent
+ * @return e^x
+ */
+float simdExpFast(float x);
+
+/**
+ * @brief returns true if the cpu has the avx-512 vnni byte dot product instruction
+ * @return true if vnni is supported
+ */
+bool hasVnni();
+
+/**
+ * @brief returns true if the cpu has the avx-512 bf16 instructions (the float to bfloat16
+ *        conversion)
+ * @return true if avx-512 bf16 is supported
+ */
+bool hasBfloat16();
+
+/**
+ * @brief computes y = a * x for a row-major matrix of signed bytes and a vector of unsigned
+ *        bytes, with 32 bit sums. runs on vnni when the level is avx512 and the cpu has it
+ * @param m - the number of rows of a and the size of y
+ * @param k - the number of cols of a and the size of x
+ * @param a - the matrix
+ * @param lda - the distance between two rows of a
+ * @param x - the input vector
+ * @param y - the result vector, overwritten
+ */
+void simdGemvInt8(int m, int k, const int8_t* a, int lda, const uint8_t* x, int32_t* y);
+
+/**
+ * @brief finds the smallest and the largest of an array of floats (the range an image is
+ *        quantized over)
+ * @param values - the floats
+ * @param size - the number of floats, at least 1
+ * @param min - set to the smallest float
+ * @param max - set to the largest float
+ */
+void simdMinMax(const float* values, int size, float* min, float* max);
+
+/**
+ * @brief quantizes floats to unsigned bytes: every float is multiplied by the inverse of the
+ *        scale, rounded to the nearest (even) integer, moved by the zero point and saturated to
+ *        0 to 255
+ * @param values - the floats
+ * @param size - the number of floats
+ * @param inverseScale - 1 over the scale of a byte
+ * @param zeroPoint - the byte a zero float is stored as
+ * @param out - the bytes, overwritten
+ */
+void simdQuantizeBytes(const float* values, int size, float inverseScale, int zeroPoint,
+                       uint8_t* out);
+
+#endif //SIMDKERNELS_H
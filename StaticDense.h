@@ -0,0 +1,82 @@
+
+//StaticDense.h
+
+#ifndef STATICDENSE_H
+#define STATICDENSE_H
+
+#include "Activation.h"
+#include "SimdKernels.h"
+#include "StaticMatrix.h"
+#include <cmath>
+
+/**
+ * @brief class that represents a dense whose dimensions and activation are known at compile
+ *        time. its weights live inside the object and it has no size checks or buffers
+ * @tparam In - the size of the input (the cols of the weights)
+ * @tparam Out - the size of the output (the rows of the weights)
+ * @tparam Act - the activation type
+ */
+template <int In, int Out, ActivationType Act>
+class StaticDense
+{
+public:
+    static constexpr int inputSize = In;
+    static constexpr int outputSize = Out;
+
+    /**
+     * @brief constructor for static dense, copies the dynamic weights and bias
+     * @param w - the weights matrix, at size Out*In
+     * @param bias - the bias matrix, at size Out*1
+     */
+    StaticDense(const Matrix& w, const Matrix& bias): _w(w), _bias(bias)
+    {
+    }
+
+    /**
+     * @brief performs the activation function on the input
+     * @param input - the input vector, In floats
+     * @param output - the output vector, Out floats
+     */
+    void operator()(const float* input, float* output) const
+    {
+        // the sizes are constants, so there are no checks and no buffers, only the kernel
+        simdGemvBiasAct(Out, In, _w.data(), In, input, _bias.data(), Act == Relu, output);
+
+        if (Act == Softmax)
+        {
+            _softMax(output);
+        }
+    }
+
+private:
+    /**
+     * @brief performs softmax function on the output, with the max subtracted before exp
+     * @param output - the output vector, Out floats
+     */
+    static void _softMax(float* output)
+    {
+        float max = output[0];
+        for (int i = 1; i < Out; i++)
+        {
+            max = (output[i] > max) ? output[i] : max;
+        }
+
+        float sum = 0;
+        for (int i = 0; i < Out; i++)
+        {
+            output[i] = std::exp(output[i] - max);
+            sum += output[i];
+        }
+
+        float division = 1 / sum;
+        for (int i = 0; i < Out; i++)
+        {
+            output[i] *= division;
+        }
+    }
+
+    StaticMatrix<Out, In> _w;      // the matrix of weights
+    StaticMatrix<Out, 1> _bias;    // the matrix of bias
+};
+
+#endif //STATICDENSE_H
@@ -0,0 +1,117 @@
+
+//StaticMatrix.h
+
+#ifndef STATICMATRIX_H
+#define STATICMATRIX_H
+
+#include "Matrix.h"
+#include <cstdlib>
+
+#define STR_STATIC_WRONG_SIZE_ERR "Error: different sizes for static matrix"
+
+/**
+ * @brief class that represents a matrix whose dimensions are known at compile time.
+ *        the cells are stored inside the object (64-byte aligned, row after row), so a big
+ *        matrix should not live on the stack
+ * @tparam R - the number of rows
+ * @tparam C - the number of cols
+ */
+template <int R, int C>
+class StaticMatrix
+{
+public:
+    static_assert((R > 0) && (C > 0), "a static matrix must have at least one cell");
+
+    static constexpr int rows = R;
+    static constexpr int cols = C;
+    static constexpr int size = R * C;
+
+    /**
+     * @brief constructs a matrix of zeros
+     */
+    StaticMatrix(): _data{}
+    {
+    }
+
+    /**
+     * @brief constructs a matrix with the values of a dynamic matrix of the same dimensions
+     * @param mat - the dynamic matrix
+     */
+    explicit StaticMatrix(const Matrix& mat)
+    {
+        if ((mat.getRows() != R) || (mat.getCols() != C))
+        {
+            std::cerr << STR_STATIC_WRONG_SIZE_ERR << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < size; i++)
+        {
+            _data[i] = mat[i];
+        }
+    }
+
+    /**
+     * @brief returns the element in the i row, j column (not checked)
+     * @param i - the row
+     * @param j - the column
+     * @return  - the element in the matrix
+     */
+    float& operator()(int i, int j)
+    {
+        return _data[i * C + j];
+    }
+
+    /**
+     * @brief returns the element in the i row, j column (not checked)
+     * @param i - the row
+     * @param j - the column
+     * @return  - the element in the matrix (const)
+     */
+    const float& operator()(int i, int j) const
+    {
+        return _data[i * C + j];
+    }
+
+    /**
+     * @brief returns the element in the array in the i index (not checked)
+     * @param i the index
+     * @return the element (non const)
+     */
+    float& operator[](int i)
+    {
+        return _data[i];
+    }
+
+    /**
+     * @brief returns the element in the array in the i index (not checked)
+     * @param i the index
+     * @return the element (const)
+     */
+    const float& operator[](int i) const
+    {
+        return _data[i];
+    }
+
+    /**
+     * @brief returns the array of the matrix, row after row
+     * @return the array (non const)
+     */
+    float* data()
+    {
+        return _data;
+    }
+
+    /**
+     * @brief returns the array of the matrix, row after row
+     * @return the array (const)
+     */
+    const float* data() const
+    {
+        return _data;
+    }
+
+private:
+    alignas(64) float _data[R * C];
+};
+
+#endif //STATICMATRIX_H
@@ -0,0 +1,95 @@
+/**
+* @file   StaticMlpNetwork.cpp
+* @brief a program that implements StaticMlpNetwork.h. the mlpnetwork with every dimension known
+ *       at compile time.
+* @section DESCRIPTION a program that implements StaticMlpNetwork.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+#include "StaticMlpNetwork.h"
+
+#define ERROR_WRONG_SIZE_INPUT "Error: different sizes input matrix"
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief constructor for static mlpnetwork, copies the weights and biases
+ * @param weights an array of weights matrices, at the sizes of weightsDims
+ * @param biases an array of biases matrices, at the sizes of biasDims
+ */
+StaticMlpNetwork::StaticMlpNetwork(Matrix weights[], Matrix biases[]):
+                  _dense0(weights[0], biases[0]),
+                  _dense1(weights[1], biases[1]),
+                  _dense2(weights[2], biases[2]),
+                  _dense3(weights[3], biases[3])
+{
+}
+
+/**
+ * @brief Gets a vector representing an image
+ *        performs the mlpnetwork's functions on the input vector
+ *        returns a digit struct with the number on the picture
+ * @param inputVector - the input vector, 784 floats
+ * @return digit struct with the probability and index of the number in the picture
+ */
+Digit StaticMlpNetwork::operator()(const float* inputVector) const
+{
+    // the outputs of the denses are small enough for the stack
+    float output0[weightsDims[0].rows];
+    float output1[weightsDims[1].rows];
+    float output2[weightsDims[2].rows];
+    float probabilities[weightsDims[3].rows];
+
+    _dense0(inputVector, output0);
+    _dense1(output0, output1);
+    _dense2(output1, output2);
+    _dense3(output2, probabilities);
+
+    float maxProbability = 0;
+    unsigned int maxIndex = 0;
+
+    // Goes over the output and saves the index with the highest probability
+    for (int i = 0; i < weightsDims[3].rows; i++)
+    {
+        if (probabilities[i] > maxProbability)
+        {
+            maxProbability = probabilities[i];
+            maxIndex = i;
+        }
+    }
+
+    Digit newDigit;
+    newDigit.probability = maxProbability; // the probability
+    newDigit.value = maxIndex; // the number in the array represents the picture received
+
+    return newDigit;
+}
+
+/**
+ * @brief Gets a vector representing an image, checks its size once and classifies it
+ * @param inputVector - the input vector, at size 784*1.
+ * @return digit struct with the probability and index of the number in the picture
+ */
+Digit StaticMlpNetwork::operator()(const Matrix& inputVector) const
+{
+    if (inputVector.getRows() * inputVector.getCols() != weightsDims[0].cols)
+    {
+        std::cerr << ERROR_WRONG_SIZE_INPUT << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (inputVector.isPacked())
+    {
+        return (*this)(inputVector.data());
+    }
+
+    // the rows of a padded image are copied one after the other
+    float input[weightsDims[0].cols];
+    for (int i = 0; i < inputVector.getRows(); i++)
+    {
+        for (int j = 0; j < inputVector.getCols(); j++)
+        {
+            input[i * inputVector.getCols() + j] = inputVector(i, j);
+        }
+    }
+    return (*this)(input);
+}
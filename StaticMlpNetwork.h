@@ -0,0 +1,48 @@
+
+//StaticMlpNetwork.h
+
+#ifndef STATICMLPNETWORK_H
+#define STATICMLPNETWORK_H
+
+#include "MlpNetwork.h"
+#include "StaticDense.h"
+
+/**
+ * @brief class that represents the mlpnetwork with its topology (weightsDims) fixed at compile
+ *        time. it gives the same results as MlpNetwork without any size check on the way.
+ *        it holds all the weights inside the object (about 450KB), so allocate it with new
+ */
+class StaticMlpNetwork
+{
+public:
+    /**
+     * @brief constructor for static mlpnetwork, copies the weights and biases
+     * @param weights an array of weights matrices, at the sizes of weightsDims
+     * @param biases an array of biases matrices, at the sizes of biasDims
+     */
+    StaticMlpNetwork(Matrix weights[], Matrix biases[]);
+
+    /**
+     * @brief Gets a vector representing an image
+     *        performs the mlpnetwork's functions on the input vector
+     *        returns a digit struct with the number on the picture
+     * @param inputVector - the input vector, 784 floats
+     * @return digit struct with the probability and index of the number in the picture
+     */
+    Digit operator()(const float* inputVector) const;
+
+    /**
+     * @brief Gets a vector representing an image, checks its size once and classifies it
+     * @param inputVector - the input vector, at size 784*1.
+     * @return digit struct with the probability and index of the number in the picture
+     */
+    Digit operator()(const Matrix& inputVector) const;
+
+private:
+    StaticDense<weightsDims[0].cols, weightsDims[0].rows, Relu> _dense0;
+    StaticDense<weightsDims[1].cols, weightsDims[1].rows, Relu> _dense1;
+    StaticDense<weightsDims[2].cols, weightsDims[2].rows, Relu> _dense2;
+    StaticDense<weightsDims[3].cols, weightsDims[3].rows, Softmax> _dense3;
+};
+
+#endif //STATICMLPNETWORK_H
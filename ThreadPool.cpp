@@ -0,0 +1,267 @@
+/**
+* @file   ThreadPool.cpp
+* @brief a program that implements ThreadPool.h. a pool of worker threads with a queue per worker
+ *       and work stealing, used to run the network on many images or many rows at once.
+* @section DESCRIPTION a program that implements ThreadPool.h.
+*/
+
+// -------------------------------------- includes ------------------------------------------------
+
+#include "ThreadPool.h"
+#include <iostream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#define STR_PIN_THREAD_ERR "Error: could not pin thread to core "
+#define WAIT_SPINS 64 // empty tries before a waiting parallelFor sleeps until its loop is done
+
+// the pool and the queue of the current thread, if it is a worker
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local int currentIndex = -1;
+
+// ------------------------------------------- function declaration -------------------------------
+
+/**
+ * @brief constructor for thread pool
+ * @param numThreads - the number of threads that run tasks, including the thread that calls
+ *                     parallelFor. 0 means one per core
+ * @param pinThreads - true to pin every worker thread to its own core
+ */
+ThreadPool::ThreadPool(int numThreads, bool pinThreads): _pendingTasks(0), _nextQueue(0),
+                                                          _stop(false)
+{
+    int cores = (int)std::thread::hardware_concurrency();
+    if (cores <= 0)
+    {
+        cores = 1;
+    }
+    if (numThreads <= 0)
+    {
+        numThreads = cores;
+    }
+
+    // the calling thread is one of the threads, so there is one worker less
+    for (int i = 0; i < numThreads - 1; i++)
+    {
+        _queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+    for (int i = 0; i < numThreads - 1; i++)
+    {
+        _threads.emplace_back(&ThreadPool::_workerLoop, this, i);
+        if (pinThreads)
+        {
+            // core 0 is left free for the threads that call parallelFor, which are not pinned
+            _pinThread(_threads.back(), (i + 1) % cores);
+        }
+    }
+}
+
+/**
+ * @brief destructor for thread pool, waits for the workers to finish
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(_sleepLock);
+        _stop = true;
+    }
+    _wakeUp.notify_all();
+
+    for (std::thread& thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+/**
+ * @brief returns the number of threads that run tasks, including the calling thread
+ * @return the number of threads
+ */
+int ThreadPool::getNumThreads() const
+{
+    return (int)_threads.size() + 1;
+}
+
+/**
+ * @brief splits [begin, end) into chunks of grain indices and runs body on every chunk,
+ *        in parallel. the calling thread runs chunks too, and returns when all are done
+ *        (it sleeps while the last ones run on other threads). may be called from inside a
+ *        task (nested loops do not deadlock)
+ * @param begin - the first index
+ * @param end - one after the last index
+ * @param grain - the number of indices in a chunk
+ * @param body - the function to run, gets the range [from, to) of a chunk
+ */
+void ThreadPool::parallelFor(int begin, int end, int grain,
+                             const std::function<void(int, int)>& body)
+{
+    if (grain <= 0)
+    {
+        grain = 1;
+    }
+    int chunks = (end - begin + grain - 1) / grain;
+
+    if (chunks <= 0)
+    {
+        return;
+    }
+    if ((chunks == 1) || _queues.empty())
+    {
+        body(begin, end);
+        return;
+    }
+
+    int self = (currentPool == this) ? currentIndex : -1;
+    int remaining = chunks - 1;  // guarded by doneLock
+    std::mutex doneLock;
+    std::condition_variable done;
+
+    // Queues every chunk but the first, a worker keeps them in its own queue so the others
+    // steal them, an outside caller spreads them over all the queues. the last chunk to end
+    // wakes the caller if it sleeps
+    for (int c = 1; c < chunks; c++)
+    {
+        int from = begin + c * grain;
+        int to = (from + grain < end) ? (from + grain) : end;
+        int queue = (self >= 0) ? self : (int)(_nextQueue++ % _queues.size());
+        {
+            std::lock_guard<std::mutex> guard(_queues[queue]->lock);
+            _queues[queue]->tasks.emplace_back([&body, &remaining, &doneLock, &done, from, to]()
+                                               {
+                                                   body(from, to);
+                                                   std::lock_guard<std::mutex> guard(doneLock);
+                                                   if (--remaining == 0)
+                                                   {
+                                                       done.notify_one();
+                                                   }
+                                               });
+        }
+        _pendingTasks.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> guard(_sleepLock);
+    }
+    _wakeUp.notify_all();
+
+    body(begin, (begin + grain < end) ? (begin + grain) : end);
+
+    // Helps with the queued tasks (these or others) while there are any, and sleeps once the
+    // queues stay empty, while the last chunks run on other threads. the lock is always taken
+    // before returning, so no chunk still touches doneLock when it goes out of scope
+    int tries = 0;
+    std::unique_lock<std::mutex> wait(doneLock);
+    while (remaining > 0)
+    {
+        wait.unlock();
+        bool ran = _runOneTask(self);
+        if (!ran)
+        {
+            std::this_thread::yield();
+        }
+        wait.lock();
+        if (ran)
+        {
+            tries = 0;
+        }
+        else if (++tries >= WAIT_SPINS)
+        {
+            done.wait(wait, [&remaining]()
+                            {
+                                return remaining == 0;
+                            });
+        }
+    }
+}
+
+/**
+ * @brief the loop of a worker thread: runs tasks, and sleeps when there are none
+ * @param index - the index of the worker's queue
+ */
+void ThreadPool::_workerLoop(int index)
+{
+    currentPool = this;
+    currentIndex = index;
+
+    while (true)
+    {
+        if (_runOneTask(index))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> sleep(_sleepLock);
+        _wakeUp.wait(sleep, [this]()
+                            {
+                                return _stop || (_pendingTasks.load() > 0);
+                            });
+        if (_stop && (_pendingTasks.load() == 0))
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief runs one task: the newest of the thread's own queue, or else the oldest of another one
+ * @param index - the index of the thread's queue, -1 if it is not a worker
+ * @return true if a task was run, false if all the queues were empty
+ */
+bool ThreadPool::_runOneTask(int index)
+{
+    std::function<void()> task;
+    int numQueues = (int)_queues.size();
+
+    if (index >= 0)
+    {
+        std::lock_guard<std::mutex> guard(_queues[index]->lock);
+        if (!_queues[index]->tasks.empty())
+        {
+            task = std::move(_queues[index]->tasks.back());
+            _queues[index]->tasks.pop_back();
+        }
+    }
+
+    // Goes over the other queues and steals from the first one that is not empty
+    for (int i = 1; (i <= numQueues) && !task; i++)
+    {
+        int victim = (index + i + numQueues) % numQueues;
+        std::lock_guard<std::mutex> guard(_queues[victim]->lock);
+        if (!_queues[victim]->tasks.empty())
+        {
+            task = std::move(_queues[victim]->tasks.front());
+            _queues[victim]->tasks.pop_front();
+        }
+    }
+
+    if (!task)
+    {
+        return false;
+    }
+    _pendingTasks.fetch_sub(1);
+    task();
+    return true;
+}
+
+/**
+ * @brief pins a thread to a core (linux only, ignored elsewhere)
+ * @param thread - the thread
+ * @param core - the index of the core
+ */
+void ThreadPool::_pinThread(std::thread& thread, int core)
+{
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpus) != 0)
+    {
+        std::cerr << STR_PIN_THREAD_ERR << core << std::endl;
+    }
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
@@ -0,0 +1,81 @@
+
+//ThreadPool.h
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief class that represents a pool of worker threads with work stealing: every worker has
+ *        its own queue of tasks, and an idle worker steals from the queues of the others
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief constructor for thread pool
+     * @param numThreads - the number of threads that run tasks, including the thread that calls
+     *                     parallelFor. 0 means one per core
+     * @param pinThreads - true to pin every worker thread to its own core
+     */
+    explicit ThreadPool(int numThreads = 0, bool pinThreads = false);
+
+    /**
+     * @brief destructor for thread pool, waits for the workers to finish
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief returns the number of threads that run tasks, including the calling thread
+     * @return the number of threads
+     */
+    int getNumThreads() const;
+
+    /**
+     * @brief splits [begin, end) into chunks of grain indices and runs body on every chunk,
+     *        in parallel. the calling thread runs chunks too, and returns when all are done
+     *        (it sleeps while the last ones run on other threads). may be called from inside a
+     *        task (nested loops do not deadlock)
+     * @param begin - the first index
+     * @param end - one after the last index
+     * @param grain - the number of indices in a chunk
+     * @param body - the function to run, gets the range [from, to) of a chunk
+     */
+    void parallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body);
+
+private:
+    /**
+     * @struct WorkQueue
+     * @brief the tasks of one worker, its owner takes from the back and thieves from the front
+     */
+    typedef struct WorkQueue
+    {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    } WorkQueue;
+
+    void _workerLoop(int index);
+    bool _runOneTask(int index);
+    void _pinThread(std::thread& thread, int core);
+
+    std::vector<std::thread> _threads;                // the worker threads
+    std::vector<std::unique_ptr<WorkQueue>> _queues;  // one queue per worker
+    std::mutex _sleepLock;                            // guards the sleep of idle workers
+    std::condition_variable _wakeUp;                  // wakes the idle workers
+    std::atomic<int> _pendingTasks;                   // the number of tasks waiting in queues
+    std::atomic<unsigned int> _nextQueue;             // round robin for outside callers
+    bool _stop;                                       // guarded by _sleepLock
+};
+
+#endif //THREADPOOL_H